@@ -0,0 +1,172 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "core.h"
+
+
+    /* this benchmark measures the overhead of the AG_TRY, ag_assert() and
+     * ag_try() macros against plain return code checks, on both the success
+     * and failure paths of a call chain; it exits with a non-zero status if
+     * the overhead exceeds the threshold ratio given as its first argument */
+
+
+#define BENCH_ITERS  (10000000)
+#define BENCH_TRIALS (7)
+#define BENCH_ERNO   ((ag_erno) 0x100)
+
+
+static volatile int bench_sink;
+
+
+    /* plain return code chain, hinted the same way as the macros */
+static __attribute__((noinline)) int
+plain_leaf(int x)
+{
+    if (ag_unlikely (x < 0))
+        return (int) BENCH_ERNO;
+
+    bench_sink = x;
+    return 0;
+}
+
+
+static __attribute__((noinline)) int
+plain_mid(int x)
+{
+    int rc;
+
+    if (ag_unlikely (rc = plain_leaf(x)))
+        return rc;
+
+    return plain_leaf(x + 1);
+}
+
+
+static __attribute__((noinline)) int
+plain_top(int x)
+{
+    int rc;
+
+    if (ag_unlikely (rc = plain_mid(x)))
+        return rc;
+
+    return plain_mid(x + 2);
+}
+
+
+    /* AG_TRY chain */
+static __attribute__((noinline)) ag_erno
+ag_leaf(int x)
+{
+AG_TRY:
+    ag_assert(x >= 0, BENCH_ERNO);
+    bench_sink = x;
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+static __attribute__((noinline)) ag_erno
+ag_mid(int x)
+{
+AG_TRY:
+    ag_try(ag_leaf(x));
+    ag_try(ag_leaf(x + 1));
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+static __attribute__((noinline)) ag_erno
+ag_top(int x)
+{
+AG_TRY:
+    ag_try(ag_mid(x));
+    ag_try(ag_mid(x + 2));
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+static double
+bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+    /* returns the best time per call in nanoseconds over several trials */
+static double
+bench_plain(int x)
+{
+    register int i, t;
+    double start, elapsed, best = 0;
+
+    for (t = 0; t < BENCH_TRIALS; t++) {
+        start = bench_now();
+        for (i = 0; i < BENCH_ITERS; i++)
+            bench_sink = plain_top(x);
+
+        elapsed = bench_now() - start;
+        if (!t || elapsed < best)
+            best = elapsed;
+    }
+
+    return best / BENCH_ITERS;
+}
+
+
+static double
+bench_ag(int x)
+{
+    register int i, t;
+    double start, elapsed, best = 0;
+
+    for (t = 0; t < BENCH_TRIALS; t++) {
+        start = bench_now();
+        for (i = 0; i < BENCH_ITERS; i++)
+            bench_sink = (int) ag_top(x);
+
+        elapsed = bench_now() - start;
+        if (!t || elapsed < best)
+            best = elapsed;
+    }
+
+    return best / BENCH_ITERS;
+}
+
+
+static int
+bench_report(const char *path, double plain, double ag, double threshold)
+{
+    double ratio = ag / plain;
+
+    printf("%-8s plain %6.2f ns  AG_TRY %6.2f ns  ratio %.3f  %s\n", path,
+            plain, ag, ratio, ratio <= threshold ? "ok" : "FAIL");
+
+    return ratio <= threshold;
+}
+
+
+int
+main(int argc, char **argv)
+{
+    double threshold = argc > 1 ? atof(argv[1]) : 1.10;
+    int ok = 1;
+
+    ok &= bench_report("success", bench_plain(1), bench_ag(1), threshold);
+    ok &= bench_report("failure", bench_plain(-1), bench_ag(-1), threshold);
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
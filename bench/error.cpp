@@ -0,0 +1,136 @@
+#include <cstdio>
+#include <ctime>
+#include <stdexcept>
+
+
+    /* this benchmark measures C++ exceptions against plain return code checks
+     * over the same call chain as error.c, as a point of reference for the
+     * cost of the alternative to the Argent Core error handling macros */
+
+
+#define BENCH_ITERS  (10000000)
+#define BENCH_TRIALS (7)
+#define BENCH_ERNO   (0x100)
+
+
+static volatile int bench_sink;
+
+
+    /* plain return code chain, hinted the same way as the macros */
+static __attribute__((noinline)) int
+plain_leaf(int x)
+{
+    if (__builtin_expect(x < 0, 0))
+        return BENCH_ERNO;
+
+    bench_sink = x;
+    return 0;
+}
+
+
+static __attribute__((noinline)) int
+plain_mid(int x)
+{
+    int rc;
+
+    if (__builtin_expect(!!(rc = plain_leaf(x)), 0))
+        return rc;
+
+    return plain_leaf(x + 1);
+}
+
+
+static __attribute__((noinline)) int
+plain_top(int x)
+{
+    int rc;
+
+    if (__builtin_expect(!!(rc = plain_mid(x)), 0))
+        return rc;
+
+    return plain_mid(x + 2);
+}
+
+
+    /* exception chain */
+static __attribute__((noinline)) void
+exc_leaf(int x)
+{
+    if (__builtin_expect(x < 0, 0))
+        throw std::runtime_error("bench");
+
+    bench_sink = x;
+}
+
+
+static __attribute__((noinline)) void
+exc_mid(int x)
+{
+    exc_leaf(x);
+    exc_leaf(x + 1);
+}
+
+
+static __attribute__((noinline)) int
+exc_top(int x)
+{
+    try {
+        exc_mid(x);
+        exc_mid(x + 2);
+    } catch (const std::runtime_error &) {
+        return BENCH_ERNO;
+    }
+
+    return 0;
+}
+
+
+static double
+bench_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+template <typename F> static double
+bench_run(F f, int x, int iters)
+{
+    double start, elapsed, best = 0;
+
+    for (int t = 0; t < BENCH_TRIALS; t++) {
+        start = bench_now();
+        for (int i = 0; i < iters; i++)
+            bench_sink = f(x);
+
+        elapsed = bench_now() - start;
+        if (!t || elapsed < best)
+            best = elapsed;
+    }
+
+    return best / iters;
+}
+
+
+int
+main(void)
+{
+        /* throwing is orders of magnitude slower, so the failure path runs
+         * fewer iterations to keep the benchmark short */
+    const int fail_iters = BENCH_ITERS / 100;
+    double plain, exc;
+
+    plain = bench_run(plain_top, 1, BENCH_ITERS);
+    exc = bench_run(exc_top, 1, BENCH_ITERS);
+    std::printf("success  plain %6.2f ns  throw  %6.2f ns  ratio %.3f\n",
+            plain, exc, exc / plain);
+
+    plain = bench_run(plain_top, -1, fail_iters);
+    exc = bench_run(exc_top, -1, fail_iters);
+    std::printf("failure  plain %6.2f ns  throw  %6.2f ns  ratio %.3f\n",
+            plain, exc, exc / plain);
+
+    return 0;
+}
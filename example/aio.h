@@ -0,0 +1,95 @@
+#if !defined _GNU_SOURCE
+#   define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <argent/aio.h>
+
+
+    /* this is the state shared by the completion callbacks below */
+struct stats {
+    ag_size bytes;
+    ag_size errors;
+};
+
+
+    /* this completion callback shows how you would check the outcome of a
+     * request; the ctx member of the request carries caller state */
+static void
+on_done(ag_aio_req *req, ag_erno e, ag_size n)
+{
+    struct stats *st = (struct stats *) req->ctx;
+
+    if (e)
+        st->errors++;
+    else
+        st->bytes += n;
+}
+
+
+    /* this function shows how you would batch requests: they are queued
+     * without system calls, and submitted and reaped together */
+static ag_erno
+run(int flags)
+{
+    static char blocks[64][4096];
+    static ag_aio_req reqs[64];
+    struct iovec reg = {blocks, sizeof blocks};
+    struct stats st = {0, 0};
+    ag_aio *aio = NULL;
+    char path[] = "/tmp/argent-aio-XXXXXX";
+    int fd = -1;
+    ag_index i;
+
+AG_TRY:
+    fd = mkstemp(path);
+    ag_assert(fd >= 0, AG_ERNO_SYSTEM);
+    (void) unlink(path);
+
+    ag_try(ag_aio_create(&aio, 64, flags));
+    printf("%s engine\n", ag_aio_fallback(aio) ? "fallback" : "io_uring");
+
+    for (i = 0; i < 64; i++) {
+        memset(blocks[i], 'a' + (int) (i % 26), sizeof blocks[i]);
+        reqs[i].ctx = &st;
+        ag_try(ag_aio_write(aio, &reqs[i], fd, blocks[i], sizeof blocks[i],
+                (ag_int_64) (i * sizeof blocks[i]), on_done));
+    }
+    ag_try(ag_aio_poll(aio, 64, NULL));
+    printf("wrote %lu bytes, %lu errors\n", (unsigned long) st.bytes,
+            (unsigned long) st.errors);
+
+        /* reads through a registered buffer avoid mapping its pages for
+         * each request */
+    memset(blocks, 0, sizeof blocks);
+    ag_try(ag_aio_register(aio, &reg, 1));
+    st.bytes = 0;
+    for (i = 0; i < 64; i++) {
+        reqs[i].ctx = &st;
+        ag_try(ag_aio_read_fixed(aio, &reqs[i], fd, blocks[63 - i],
+                sizeof blocks[i], (ag_int_64) (i * sizeof blocks[i]), 0,
+                on_done));
+    }
+    ag_try(ag_aio_poll(aio, 64, NULL));
+    printf("read %lu bytes, last block holds '%c'\n",
+            (unsigned long) st.bytes, blocks[63][0]);
+
+AG_CATCH:
+    printf("error: %s\n", ag_erno_message(ag_erno_get()));
+
+AG_FINALLY:
+    ag_aio_destroy(aio);
+    if (fd >= 0)
+        (void) close(fd);
+
+    return ag_erno_get();
+}
+
+
+int
+main(void)
+{
+    return run(0) || run(AG_AIO_FALLBACK);
+}
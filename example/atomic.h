@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <pthread.h>
+#include <argent/atomic.h>
+
+
+    /* this is a counter shared between threads; it is cache line aligned so
+     * that it does not share a cache line with the flag below */
+static ag_cacheline_aligned ag_word hits;
+
+
+    /* this is a flag used to publish a message from one thread to another */
+static ag_bool ready;
+static const ag_string *message;
+
+
+    /* this thread function shows how you would use a relaxed fetch-and-add
+     * for a statistic that needs no ordering */
+static void *
+count(void *arg)
+{
+    register ag_index i;
+
+    (void) arg;
+    for (i = 0; i < 1000000; i++)
+        (void) ag_atomic_word_fetch_add_explicit(&hits, 1, AG_ATOMIC_RELAXED);
+
+    return NULL;
+}
+
+
+    /* these thread functions show how you would publish data with a release
+     * store, and consume it with an acquire load */
+static void *
+publish(void *arg)
+{
+    (void) arg;
+    message = "Hello, world!";
+    ag_atomic_bool_store_explicit(&ready, AG_BOOL_TRUE, AG_ATOMIC_RELEASE);
+
+    return NULL;
+}
+
+
+static void *
+consume(void *arg)
+{
+    (void) arg;
+    while (!ag_atomic_bool_load_explicit(&ready, AG_ATOMIC_ACQUIRE))
+        ag_atomic_pause();
+
+    printf("%s\n", message);
+    return NULL;
+}
+
+
+    /* this function shows how you would use compare-and-swap to atomically
+     * raise a maximum */
+static void
+max_update(ag_int_64 *max, ag_int_64 v)
+{
+    ag_int_64 cur = ag_atomic_int_64_load_explicit(max, AG_ATOMIC_RELAXED);
+
+    while (cur < v && !ag_atomic_int_64_cas_weak_explicit(max, &cur, v,
+            AG_ATOMIC_RELAXED, AG_ATOMIC_RELAXED))
+        ;
+}
+
+
+int
+main(void)
+{
+    pthread_t t[4];
+    ag_int_64 max = 0;
+
+    pthread_create(&t[0], NULL, count, NULL);
+    pthread_create(&t[1], NULL, count, NULL);
+    pthread_create(&t[2], NULL, consume, NULL);
+    pthread_create(&t[3], NULL, publish, NULL);
+
+    pthread_join(t[0], NULL);
+    pthread_join(t[1], NULL);
+    pthread_join(t[2], NULL);
+    pthread_join(t[3], NULL);
+
+    max_update(&max, 42);
+    printf("hits = %lu, max = %ld\n", (unsigned long) hits, (long) max);
+
+    return 0;
+}
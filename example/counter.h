@@ -0,0 +1,58 @@
+#if !defined _GNU_SOURCE
+#   define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <pthread.h>
+#include <argent/counter.h>
+
+
+    /* these are statistics counters updated by every thread; one is sharded
+     * by processor and the other by thread */
+static ag_counter *requests;
+static ag_counter *bytes;
+
+
+    /* this thread function shows how you would update the counters; each
+     * update only touches the cache line of the calling processor or thread */
+static void *
+work(void *arg)
+{
+    ag_index i;
+
+    (void) arg;
+    for (i = 0; i < 1000000; i++) {
+        ag_counter_inc(requests);
+        ag_counter_add(bytes, 512);
+    }
+
+    return NULL;
+}
+
+
+int
+main(void)
+{
+    pthread_t t[4];
+    ag_index i;
+    ag_erno e;
+
+    if ((e = ag_counter_create(&requests, 0, AG_COUNTER_CPU))
+            || (e = ag_counter_create(&bytes, 0, AG_COUNTER_THREAD))) {
+        printf("error: %s\n", ag_erno_message(e));
+        return 1;
+    }
+
+    for (i = 0; i < 4; i++)
+        pthread_create(&t[i], NULL, work, NULL);
+    for (i = 0; i < 4; i++)
+        pthread_join(t[i], NULL);
+
+        /* reading a counter sums its shards */
+    printf("%lld requests, %lld bytes\n", (long long) ag_counter_read(requests),
+            (long long) ag_counter_reset(bytes));
+    printf("%lld bytes after reset\n", (long long) ag_counter_read(bytes));
+
+    ag_counter_destroy(requests);
+    ag_counter_destroy(bytes);
+    return 0;
+}
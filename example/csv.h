@@ -0,0 +1,71 @@
+#include <stdio.h>
+#include <string.h>
+#include <argent/csv.h>
+
+
+static const ag_string text[] =
+        "id,name,price,quantity\r\n"
+        "1,\"Widget, large\",12.50,3\r\n"
+        "2,\"The \"\"best\"\" gadget\",7.25,10\r\n"
+        "3,Sprocket,0.99,250\r\n";
+
+
+    /* this function shows how you would iterate over the fields of delimited
+     * text as string views */
+static void
+fields(void)
+{
+    ag_string_view v = {text, sizeof text - 1}, f;
+    ag_string buf[64];
+    ag_bool eol;
+    ag_csv c;
+
+    ag_csv_init(&c, v, ',', '"');
+    (void) ag_csv_skip(&c);
+
+    while (ag_csv_field(&c, &f, &eol)) {
+        printf("[%.*s]%s", (int) ag_csv_unescape(f, '"', buf), buf,
+                eol ? "\n" : " ");
+    }
+}
+
+
+    /* this function shows how you would load typed columns, skipping those
+     * that are not needed */
+static void
+columns(void)
+{
+    static const int types[] = {AG_CSV_INT, AG_CSV_SKIP, AG_CSV_FLOAT,
+            AG_CSV_INT};
+    ag_string_view v = {text, sizeof text - 1};
+    ag_int_64 id[8], qty[8];
+    ag_float_64 price[8];
+    void *cols[] = {id, NULL, price, qty};
+    ag_float_64 total = 0;
+    ag_size n, i;
+    ag_erno e;
+    ag_csv c;
+
+    ag_csv_init(&c, v, ',', '"');
+    (void) ag_csv_skip(&c);
+
+    if ((e = ag_csv_load(&c, types, cols, 4, 8, &n))) {
+        printf("%s\n", ag_erno_message(e));
+        return;
+    }
+
+    for (i = 0; i < n; i++)
+        total += price[i] * (ag_float_64) qty[i];
+
+    printf("%zu rows, total %.2f\n", n, total);
+}
+
+
+int
+main(void)
+{
+    fields();
+    columns();
+
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <argent/ebr.h>
+
+
+    /* this is a read-mostly table that is replaced as a whole by writers;
+     * the retire node is embedded so that retiring it does not allocate */
+struct table {
+    ag_ebr_node node;
+    ag_word version;
+    ag_word routes[8];
+};
+
+static ag_ebr domain = AG_EBR_INIT;
+static struct table *current;
+static ag_word freed;
+
+
+    /* this is the reclamation callback, which recovers the table from its
+     * embedded node */
+static void
+table_free(ag_ebr_node *node)
+{
+    free((char *) node - offsetof(struct table, node));
+    ag_atomic_word_add_fetch(&freed, 1);
+}
+
+
+    /* this thread function shows how you would read a shared structure
+     * within a critical section, without taking any lock */
+static void *
+reader(void *arg)
+{
+    ag_ebr_thread *t;
+    struct table *tab;
+    ag_word sum = 0;
+    ag_index i;
+
+    (void) arg;
+    if (ag_ebr_register(&domain, &t))
+        return NULL;
+
+    for (i = 0; i < 100000; i++) {
+        ag_ebr_enter(t);
+        tab = (struct table *) ag_atomic_ptr_load_explicit(&current,
+                AG_ATOMIC_ACQUIRE);
+        sum += tab->routes[i % 8] - tab->version;
+        ag_ebr_exit(t);
+    }
+
+    ag_ebr_unregister(t);
+    return (void *) (ag_word) sum;
+}
+
+
+    /* this thread function shows how you would replace a shared structure,
+     * retiring the old one so that it is freed once no reader can see it */
+static void *
+writer(void *arg)
+{
+    ag_ebr_thread *t;
+    struct table *tab, *old;
+    ag_index i, j;
+
+    (void) arg;
+    if (ag_ebr_register(&domain, &t))
+        return NULL;
+
+    for (i = 1; i <= 1000; i++) {
+        tab = (struct table *) malloc(sizeof *tab);
+        tab->version = i;
+        for (j = 0; j < 8; j++)
+            tab->routes[j] = i;
+
+        old = (struct table *) ag_atomic_ptr_exchange_explicit(&current, tab,
+                AG_ATOMIC_ACQ_REL);
+        ag_ebr_retire(t, &old->node, table_free);
+    }
+
+    ag_ebr_unregister(t);
+    return NULL;
+}
+
+
+int
+main(void)
+{
+    pthread_t t[4];
+    void *sum;
+    ag_word bad = 0;
+    ag_index i;
+
+    current = (struct table *) calloc(1, sizeof *current);
+
+    for (i = 0; i < 3; i++)
+        pthread_create(&t[i], NULL, reader, NULL);
+    pthread_create(&t[3], NULL, writer, NULL);
+
+    for (i = 0; i < 4; i++) {
+        pthread_join(t[i], &sum);
+        bad += (ag_word) sum;
+    }
+
+        /* objects still pending are freed along with the domain */
+    printf("freed %lu before destroy, mismatches %lu\n",
+            (unsigned long) freed, (unsigned long) bad);
+    ag_ebr_destroy(&domain);
+    printf("freed %lu after destroy\n", (unsigned long) freed);
+
+    free(current);
+    return 0;
+}
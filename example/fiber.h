@@ -0,0 +1,86 @@
+#if !defined _GNU_SOURCE
+#   define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <argent/fiber.h>
+
+
+    /* this is the state of a session handled by its own fiber */
+struct session {
+    ag_index id;
+    ag_size steps;
+};
+
+
+    /* this fiber function shows how you would give up the processor to the
+     * other fibers of the scheduler at each step of a session */
+static ag_erno
+session_run(void *arg)
+{
+    struct session *s = (struct session *) arg;
+    ag_index i;
+
+    for (i = 0; i < s->steps; i++)
+        (void) ag_fiber_yield();
+
+        /* the result of a fiber is reported when it is joined */
+    return s->id % 1000 ? AG_ERNO_NULL : AG_ERNO_STATE;
+}
+
+
+    /* this fiber function shows how you would spawn and join fibers from
+     * within another fiber */
+static ag_erno
+parent_run(void *arg)
+{
+    ag_fiber_sched *sched = (ag_fiber_sched *) arg;
+    struct session s = {1, 10};
+    ag_fiber *child;
+
+    if (ag_fiber_spawn(sched, &child, session_run, &s))
+        return AG_ERNO_SYSTEM;
+
+    return ag_fiber_join(child);
+}
+
+
+int
+main(void)
+{
+    static struct session sessions[10000];
+    static ag_fiber *fibers[10000];
+    ag_fiber_sched sched;
+    ag_fiber *parent;
+    ag_size failed = 0;
+    ag_index i;
+    ag_erno e;
+
+    (void) ag_fiber_sched_init(&sched, 0);
+
+        /* ten thousand concurrent fibers are spawned, and then run to
+         * completion by joining them from the main thread */
+    for (i = 0; i < 10000; i++) {
+        sessions[i].id = i;
+        sessions[i].steps = 100;
+        if ((e = ag_fiber_spawn(&sched, &fibers[i], session_run,
+                &sessions[i]))) {
+            printf("error: %s\n", ag_erno_message(e));
+            return 1;
+        }
+    }
+
+    for (i = 0; i < 10000; i++) {
+        if (ag_fiber_join(fibers[i]))
+            failed++;
+    }
+
+    printf("%lu sessions failed\n", (unsigned long) failed);
+
+        /* stacks of finished fibers are reused by newly spawned ones */
+    if (!ag_fiber_spawn(&sched, &parent, parent_run, &sched))
+        printf("parent: %s\n", ag_erno_message(ag_fiber_join(parent)));
+
+    ag_fiber_sched_destroy(&sched);
+    return 0;
+}
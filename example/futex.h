@@ -0,0 +1,90 @@
+#if !defined _GNU_SOURCE
+#   define _GNU_SOURCE
+#endif
+
+
+#include <stdio.h>
+#include <pthread.h>
+#include <argent/futex.h>
+
+
+    /* this is a simple bounded queue guarded by a mutex, with a condition
+     * variable signalling that items are available; each primitive takes a
+     * single word, and all are statically initialised */
+static ag_mutex lock = AG_MUTEX_INIT;
+static ag_cond ready = AG_COND_INIT;
+static ag_event start = AG_EVENT_INIT;
+
+static ag_word queue[16];
+static ag_size head, tail;
+static ag_word total;
+
+
+    /* this thread function shows how you would wait on an event, and then on
+     * a condition variable; note that the condition is checked in a loop, as
+     * the thread may wake spuriously */
+static void *
+consume(void *arg)
+{
+    ag_word item;
+
+    (void) arg;
+    ag_event_wait(&start);
+
+    for (;;) {
+        ag_mutex_acquire(&lock);
+        while (head == tail)
+            ag_cond_wait(&ready, &lock);
+
+        item = queue[head++ % 16];
+        total += item;
+        ag_mutex_release(&lock);
+
+        if (!item)
+            return NULL;
+    }
+}
+
+
+    /* this function shows how you would signal a condition variable after
+     * updating the state that it guards */
+static void
+produce(ag_word item)
+{
+    ag_bool full;
+
+    do {
+        ag_mutex_acquire(&lock);
+        full = tail - head == 16;
+        if (!full) {
+            queue[tail++ % 16] = item;
+            ag_cond_signal(&ready);
+        }
+        ag_mutex_release(&lock);
+    } while (full);
+}
+
+
+int
+main(void)
+{
+    pthread_t t[4];
+    ag_index i;
+
+    for (i = 0; i < 4; i++)
+        pthread_create(&t[i], NULL, consume, NULL);
+
+        /* the consumers block until the event is set */
+    ag_event_set(&start);
+
+    for (i = 1; i <= 10000; i++)
+        produce(i);
+    for (i = 0; i < 4; i++)
+        produce(0);
+
+    for (i = 0; i < 4; i++)
+        pthread_join(t[i], NULL);
+
+    printf("%lu\n", (unsigned long) total);
+    return 0;
+}
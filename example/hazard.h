@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <argent/hazard.h>
+
+
+    /* this is a node of a lock-free stack; the retire node is embedded so
+     * that retiring a popped node does not allocate */
+struct item {
+    struct item *next;
+    ag_word value;
+    ag_hazard_node node;
+};
+
+static ag_hazard domain = AG_HAZARD_INIT;
+static struct item *top;
+
+
+static void
+item_free(ag_hazard_node *node)
+{
+    free((char *) node - offsetof(struct item, node));
+}
+
+
+static void
+push(ag_word value)
+{
+    struct item *it = (struct item *) malloc(sizeof *it);
+
+    it->value = value;
+    it->next = (struct item *) ag_atomic_ptr_load_explicit(&top,
+            AG_ATOMIC_RELAXED);
+    while (!ag_atomic_ptr_cas_weak_explicit(&top, &it->next, it,
+            AG_ATOMIC_RELEASE, AG_ATOMIC_RELAXED))
+        ;
+}
+
+
+    /* this function shows how you would protect a shared pointer before
+     * dereferencing it, and retire the object once it has been unlinked */
+static ag_bool
+pop(ag_hazard_thread *t, ag_word *value)
+{
+    struct item *it, *next;
+
+    for (;;) {
+        it = (struct item *) ag_hazard_protect(t, 0, (void **) &top);
+        if (!it)
+            return false;
+
+        next = it->next;
+        if (ag_atomic_ptr_cas_explicit(&top, &it, next, AG_ATOMIC_ACQ_REL,
+                AG_ATOMIC_RELAXED))
+            break;
+    }
+
+    ag_hazard_clear(t, 0);
+    *value = it->value;
+    ag_hazard_retire(t, it, &it->node, item_free);
+
+    return true;
+}
+
+
+    /* this thread function registers with the domain, and then pushes and
+     * pops items concurrently with other threads */
+static void *
+work(void *arg)
+{
+    ag_hazard_thread *t;
+    ag_word v, sum = 0;
+    ag_index i;
+
+    (void) arg;
+    if (ag_hazard_register(&domain, &t))
+        return NULL;
+
+    for (i = 1; i <= 100000; i++) {
+        push(i);
+        if (pop(t, &v))
+            sum += v;
+    }
+
+    ag_hazard_unregister(t);
+    return (void *) (ag_word) sum;
+}
+
+
+int
+main(void)
+{
+    pthread_t t[4];
+    void *sum;
+    ag_word total = 0;
+    ag_index i;
+
+    for (i = 0; i < 4; i++)
+        pthread_create(&t[i], NULL, work, NULL);
+    for (i = 0; i < 4; i++) {
+        pthread_join(t[i], &sum);
+        total += (ag_word) sum;
+    }
+
+    printf("%lu\n", (unsigned long) total);
+    ag_hazard_destroy(&domain);
+
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <argent/json.h>
+
+
+static const ag_string text[] =
+        "{\"service\": \"gateway\", \"version\": 3, \"ratio\": 0.75,"
+        " \"enabled\": true, \"owner\": null,"
+        " \"routes\": [{\"path\": \"/users\", \"weight\": 10},"
+        " {\"path\": \"/caf\\u00e9\", \"weight\": 5}]}";
+
+
+    /* this function shows how you would look up fields by key; only the
+     * fields up to those found are examined */
+static ag_erno
+fields(ag_json_value root)
+{
+    ag_json_value v;
+    ag_string_view s;
+    ag_float ratio;
+    ag_bool enabled;
+    ag_int version;
+    ag_erno e;
+
+    if ((e = ag_json_find(root, "service", &v))
+            || (e = ag_json_get_string(v, &s))
+            || (e = ag_json_find(root, "version", &v))
+            || (e = ag_json_get_int(v, &version))
+            || (e = ag_json_find(root, "ratio", &v))
+            || (e = ag_json_get_float(v, &ratio))
+            || (e = ag_json_find(root, "enabled", &v))
+            || (e = ag_json_get_bool(v, &enabled))
+            || (e = ag_json_find(root, "owner", &v)))
+        return e;
+
+    printf("%.*s v%ld ratio %g %s, owner %s\n", (int) s.len, s.str,
+            (long) version, ratio, enabled ? "enabled" : "disabled",
+            ag_json_is_null(v) ? "unset" : "set");
+
+    return AG_ERNO_NULL;
+}
+
+
+    /* this function shows how you would iterate over an array of objects,
+     * decoding escape sequences where strings have them */
+static ag_erno
+routes(ag_json_value root)
+{
+    ag_json_value arr, r, v;
+    ag_json_iter it;
+    ag_string_view s;
+    ag_string path[64];
+    ag_size n;
+    ag_int w;
+    ag_erno e;
+
+    if ((e = ag_json_find(root, "routes", &arr))
+            || (e = ag_json_iter_init(arr, &it)))
+        return e;
+
+    while (ag_json_iter_next(&it, NULL, &r)) {
+        if ((e = ag_json_find(r, "path", &v))
+                || (e = ag_json_get_string(v, &s))
+                || s.len > sizeof path
+                || (e = ag_json_unescape(s, path, &n))
+                || (e = ag_json_find(r, "weight", &v))
+                || (e = ag_json_get_int(v, &w)))
+            return e ? e : AG_ERNO_RANGE;
+
+        printf("route %.*s weight %ld\n", (int) n, path, (long) w);
+    }
+
+    return ag_json_iter_error(&it);
+}
+
+
+    /* this function shows how you would write a document, with strings
+     * escaped and numbers formatted as they are written */
+static ag_erno
+report(void)
+{
+    static const ag_string name[] = "tab\there \"quoted\"";
+    ag_json_writer *w;
+    ag_string_view v;
+    ag_erno e;
+
+    if ((e = ag_json_writer_create(&w, 0)))
+        return e;
+
+    if (!(e = ag_json_write_object(w))
+            && !(e = ag_json_write_key(w, "name", 4))
+            && !(e = ag_json_write_string(w, name, sizeof name - 1))
+            && !(e = ag_json_write_key(w, "samples", 7))
+            && !(e = ag_json_write_array(w))
+            && !(e = ag_json_write_int(w, -42))
+            && !(e = ag_json_write_float(w, 0.1))
+            && !(e = ag_json_write_float(w, 6.02214076e23))
+            && !(e = ag_json_write_bool(w, true))
+            && !(e = ag_json_write_null(w))
+            && !(e = ag_json_write_array_end(w))
+            && !(e = ag_json_write_object_end(w))) {
+        v = ag_json_writer_view(w);
+        printf("%.*s\n", (int) v.len, v.str);
+    }
+
+    ag_json_writer_destroy(w);
+    return e;
+}
+
+
+    /* this function shows how malformed documents are rejected as they are
+     * parsed, whether their brackets are left open or mismatched */
+static void
+malformed(ag_json *j)
+{
+    static const ag_string *const bad[] = {"[", "[[1]", "{\"a\": 1", "[}",
+            "{\"a\": [1}]", "[1]]", "\"open"};
+    ag_json_value root;
+    ag_string_view v;
+    ag_size i;
+
+    for (i = 0; i < sizeof bad / sizeof *bad; i++) {
+        v.str = bad[i];
+        v.len = strlen(bad[i]);
+        printf("%-12s %s\n", bad[i], ag_erno_message(ag_json_parse(j, v,
+                &root)));
+    }
+}
+
+
+int
+main(void)
+{
+    ag_string_view v = {text, sizeof text - 1};
+    ag_json_value root;
+    ag_json *j;
+    ag_erno e;
+
+    if ((e = ag_json_create(&j))) {
+        printf("%s\n", ag_erno_message(e));
+        return EXIT_FAILURE;
+    }
+
+    if ((e = ag_json_parse(j, v, &root)) || (e = fields(root))
+            || (e = routes(root)) || (e = report()))
+        printf("%s\n", ag_erno_message(e));
+    else
+        malformed(j);
+
+    ag_json_destroy(j);
+    return e ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,71 @@
+#include <stdio.h>
+#include <pthread.h>
+#include <argent/lock.h>
+
+
+    /* these are the locks guarding the counters below; each lock is cache
+     * line aligned, so it can be statically initialised alongside its data */
+static ag_spinlock spin = AG_SPINLOCK_INIT;
+static ag_ticketlock ticket = AG_TICKETLOCK_INIT;
+static ag_mcslock mcs = AG_MCSLOCK_INIT;
+
+static ag_word spin_count, ticket_count, mcs_count;
+
+
+    /* this thread function shows how you would use each kind of lock; note
+     * that the MCS lock requires a queue node, which is usually placed on the
+     * stack of the calling thread */
+static void *
+work(void *arg)
+{
+    ag_mcsnode node;
+    ag_index i;
+
+    (void) arg;
+    for (i = 0; i < 100000; i++) {
+        ag_spinlock_acquire(&spin);
+        spin_count++;
+        ag_spinlock_release(&spin);
+
+        ag_ticketlock_acquire(&ticket);
+        ticket_count++;
+        ag_ticketlock_release(&ticket);
+
+        ag_mcslock_acquire(&mcs, &node);
+        mcs_count++;
+        ag_mcslock_release(&mcs, &node);
+    }
+
+    return NULL;
+}
+
+
+    /* this function shows how you would attempt to take a lock without
+     * waiting */
+static void
+try_example(void)
+{
+    if (ag_spinlock_try_acquire(&spin)) {
+        printf("spinlock taken without waiting\n");
+        ag_spinlock_release(&spin);
+    }
+}
+
+
+int
+main(void)
+{
+    pthread_t t[4];
+    ag_index i;
+
+    for (i = 0; i < 4; i++)
+        pthread_create(&t[i], NULL, work, NULL);
+    for (i = 0; i < 4; i++)
+        pthread_join(t[i], NULL);
+
+    try_example();
+    printf("%lu %lu %lu\n", (unsigned long) spin_count,
+            (unsigned long) ticket_count, (unsigned long) mcs_count);
+
+    return 0;
+}
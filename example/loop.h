@@ -0,0 +1,124 @@
+#if !defined _GNU_SOURCE
+#   define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <argent/loop.h>
+
+
+    /* this is the state of the example; the loop echoes what it reads from
+     * one end of a socket pair back to the sender */
+static ag_loop *loop;
+static ag_loop_watch server;
+static ag_loop_timer tick = AG_LOOP_TIMER_INIT;
+static ag_loop_task tasks[1000];
+static int ticks, posted;
+
+
+    /* this I/O callback shows how you would drain a socket in edge-triggered
+     * mode: it reads until the operation would block */
+static void
+on_read(ag_loop_watch *w, ag_word_32 events)
+{
+    char buf[256];
+    ssize_t n = -1;
+
+    if (events & AG_LOOP_READ) {
+        while ((n = read(w->fd, buf, sizeof buf)) > 0)
+            (void) !write(w->fd, buf, (size_t) n);
+    }
+
+    if (events & AG_LOOP_ERROR || !n) {
+        (void) ag_loop_del(w);
+        ag_loop_stop(w->loop);
+    }
+}
+
+
+    /* this timer callback shows how you would stop a periodic timer from
+     * within itself */
+static void
+on_tick(ag_loop_timer *t)
+{
+    if (++ticks == 3)
+        ag_loop_timer_stop(t);
+}
+
+
+static void
+on_task(ag_loop_task *t)
+{
+    (void) t;
+    posted++;
+}
+
+
+    /* this thread function shows how you would hand work to a loop from
+     * another thread, and talk to it through its socket */
+static void *
+client(void *arg)
+{
+    int fd = *(int *) arg;
+    char buf[6];
+    ag_index i;
+
+    for (i = 0; i < 1000; i++)
+        ag_loop_post(loop, &tasks[i], on_task);
+
+    (void) !write(fd, "hello", 6);
+    (void) !read(fd, buf, sizeof buf);
+    printf("echoed: %s\n", buf);
+
+    usleep(50000);
+    shutdown(fd, SHUT_WR);
+    return NULL;
+}
+
+
+    /* this initialiser shows how you would set up each loop of a group on
+     * its own thread */
+static ag_erno
+init(ag_loop *l, ag_index index, void *ctx)
+{
+    (void) l;
+    (void) ctx;
+    printf("loop %lu ready\n", (unsigned long) index);
+    return AG_ERNO_NULL;
+}
+
+
+int
+main(void)
+{
+    ag_loop_group *group;
+    pthread_t thread;
+    int sv[2];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv)
+            || ag_loop_create(&loop))
+        return 1;
+
+    (void) ag_loop_add(loop, &server, sv[0], AG_LOOP_READ, on_read);
+    (void) ag_loop_timer_start(loop, &tick, 10, 10, on_tick);
+
+        /* only the end watched by the loop needs to be non-blocking */
+    (void) fcntl(sv[1], F_SETFL, 0);
+    pthread_create(&thread, NULL, client, &sv[1]);
+    (void) ag_loop_run(loop);
+    pthread_join(thread, NULL);
+
+    printf("%d ticks, %d tasks\n", ticks, posted);
+    ag_loop_destroy(loop);
+    (void) close(sv[0]);
+    (void) close(sv[1]);
+
+        /* a group runs one loop per processor, each on a pinned thread */
+    if (!ag_loop_group_create(&group, 2, init, NULL))
+        ag_loop_group_destroy(group);
+
+    return 0;
+}
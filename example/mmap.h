@@ -0,0 +1,82 @@
+#if !defined _GNU_SOURCE
+#   define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <argent/mmap.h>
+
+
+    /* this function writes a small log file to read back through a mapping */
+static ag_erno
+log_write(const char *path)
+{
+    FILE *f = fopen(path, "w");
+    int i;
+
+    if (!f)
+        return AG_ERNO_SYSTEM;
+
+    for (i = 0; i < 1000; i++)
+        fprintf(f, "%d\t%s\t%d\r\n", i, i % 10 ? "INFO" : "WARN", i * 3);
+    fputs("done", f);
+
+    return fclose(f) ? AG_ERNO_SYSTEM : AG_ERNO_NULL;
+}
+
+
+    /* this function shows how you would iterate the lines of a mapped file,
+     * and split each of them into tab-delimited fields without copying */
+static void
+log_scan(const ag_mmap *m)
+{
+    ag_string_view it = ag_mmap_view(m), line, field, cur;
+    ag_size lines = 0, warns = 0;
+
+    while (ag_mmap_line(&it, &line)) {
+        lines++;
+
+        cur = line;
+        (void) ag_mmap_record(&cur, '\t', &field);
+        if (ag_mmap_record(&cur, '\t', &field) && field.len == 4
+                && !memcmp(field.str, "WARN", 4))
+            warns++;
+    }
+
+    printf("%zu lines, %zu warnings\n", lines, warns);
+}
+
+
+int
+main(int argc, char **argv)
+{
+    char path[] = "/tmp/argent-mmap-XXXXXX";
+    ag_mmap m;
+    ag_erno e;
+    int fd;
+
+    if (argc > 1) {
+        if ((e = ag_mmap_open(&m, argv[1], AG_MMAP_SEQUENTIAL
+                | AG_MMAP_WILLNEED | AG_MMAP_HUGE))) {
+            printf("%s\n", ag_erno_message(e));
+            return EXIT_FAILURE;
+        }
+    } else {
+        if ((fd = mkstemp(path)) < 0)
+            return EXIT_FAILURE;
+        (void) close(fd);
+
+        if ((e = log_write(path)) || (e = ag_mmap_open(&m, path,
+                AG_MMAP_SEQUENTIAL | AG_MMAP_HUGE))) {
+            printf("%s\n", ag_erno_message(e));
+            (void) unlink(path);
+            return EXIT_FAILURE;
+        }
+        (void) unlink(path);
+    }
+
+    log_scan(&m);
+    ag_mmap_close(&m);
+
+    return EXIT_SUCCESS;
+}
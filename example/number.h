@@ -0,0 +1,39 @@
+#include <stdio.h>
+#include <string.h>
+#include <argent/number.h>
+
+
+    /* this function shows how you would parse numbers in place from a string
+     * view, without copying them into null-terminated strings */
+static void
+parse(const ag_string *s, ag_size len)
+{
+    ag_string_view v = {s, len};
+    ag_float_64 f;
+    ag_int_64 i;
+    ag_erno e;
+
+    if (!(e = ag_number_parse_int(v, &i)))
+        printf("%.*s is the integer %lld\n", (int) len, s, (long long) i);
+    else if (!(e = ag_number_parse_float(v, &f)))
+        printf("%.*s is the number %g\n", (int) len, s, f);
+    else
+        printf("%.*s: %s\n", (int) len, s, ag_erno_message(e));
+}
+
+
+int
+main(void)
+{
+    static const ag_string text[] = "-1234567890123 2.5e-3 0.1 12x "
+            "99999999999999999999";
+    const ag_string *s = text, *end;
+
+    while ((end = strchr(s, ' '))) {
+        parse(s, (ag_size) (end - s));
+        s = end + 1;
+    }
+    parse(s, strlen(s));
+
+    return 0;
+}
@@ -0,0 +1,96 @@
+#if !defined _GNU_SOURCE
+#   define _GNU_SOURCE
+#endif
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <argent/parallel.h>
+
+
+    /* this loop body shows how you would fill an array in parallel; each call
+     * processes a chunk of indices */
+static ag_erno
+square(void *ctx, ag_index begin, ag_index end)
+{
+    ag_uint_64 *v = (ag_uint_64 *) ctx;
+    ag_index i;
+
+    for (i = begin; i < end; i++)
+        v[i] = (ag_uint_64) i * i;
+
+    return AG_ERNO_NULL;
+}
+
+
+    /* these functions show how you would sum an array in parallel; the body
+     * folds a chunk into its accumulator, and the join combines two
+     * accumulators */
+static ag_erno
+sum(void *ctx, ag_index begin, ag_index end, void *acc)
+{
+    const ag_uint_64 *v = (const ag_uint_64 *) ctx;
+    ag_uint_64 s = 0;
+    ag_index i;
+
+    for (i = begin; i < end; i++)
+        s += v[i];
+
+    *(ag_uint_64 *) acc += s;
+    return AG_ERNO_NULL;
+}
+
+
+static void
+sum_join(void *ctx, void *acc, const void *right)
+{
+    (void) ctx;
+    *(ag_uint_64 *) acc += *(const ag_uint_64 *) right;
+}
+
+
+    /* this loop body shows how an error raised by one chunk cancels the rest
+     * of the loop */
+static ag_erno
+find_zero(void *ctx, ag_index begin, ag_index end)
+{
+    const ag_uint_64 *v = (const ag_uint_64 *) ctx;
+    ag_index i;
+
+AG_TRY:
+    for (i = begin; i < end; i++)
+        ag_assert_state(v[i]);
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+int
+main(void)
+{
+    const ag_index n = 10000000;
+    ag_uint_64 *v, total = 0;
+    ag_pool *pool = NULL;
+    ag_erno e;
+
+    if (!(v = (ag_uint_64 *) malloc(n * sizeof *v)))
+        return 1;
+
+    if (ag_pool_create(&pool, 0))
+        return 1;
+
+    (void) ag_parallel_for(pool, n, 0, square, v);
+    (void) ag_parallel_reduce(pool, n, 0, sum, sum_join, v, &total,
+            sizeof total);
+    printf("sum of squares = %lu\n", (unsigned long) total);
+
+    e = ag_parallel_for(pool, n, 4096, find_zero, v);
+    printf("find_zero: %s\n", ag_erno_message(e));
+
+    ag_pool_destroy(pool);
+    free(v);
+
+    return 0;
+}
@@ -0,0 +1,96 @@
+#if !defined _GNU_SOURCE
+#   define _GNU_SOURCE
+#endif
+
+
+#include <stdio.h>
+#include <argent/pool.h>
+
+
+    /* this is the argument passed to the recursive task below */
+struct fib {
+    ag_pool *pool;
+    int n;
+    long result;
+};
+
+
+    /* this task function shows how you would spawn child tasks from within a
+     * task and wait for them; the waiting worker runs other tasks meanwhile */
+static ag_erno
+fib_task(void *arg)
+{
+    struct fib *f = (struct fib *) arg, left, right;
+    ag_pool_task lt, rt;
+    ag_erno e1, e2;
+
+    if (f->n < 2) {
+        f->result = f->n;
+        return AG_ERNO_NULL;
+    }
+
+    left.pool = right.pool = f->pool;
+    left.n = f->n - 1;
+    right.n = f->n - 2;
+
+    ag_pool_task_init(&lt, fib_task, &left);
+    ag_pool_task_init(&rt, fib_task, &right);
+    ag_pool_submit(f->pool, &lt);
+    ag_pool_submit(f->pool, &rt);
+
+    e1 = ag_pool_wait(f->pool, &lt);
+    e2 = ag_pool_wait(f->pool, &rt);
+
+    f->result = left.result + right.result;
+    return e1 ? e1 : e2;
+}
+
+
+    /* this task function shows how a task reports an error code as its
+     * completion status */
+static ag_erno
+failing_task(void *arg)
+{
+    (void) arg;
+    return AG_ERNO_STATE;
+}
+
+
+    /* this function shows how you would create a pool, submit tasks to it
+     * from outside, and wait for their completion statuses */
+static ag_erno
+pool_example(void)
+{
+    ag_pool *pool = NULL;
+    ag_pool_task t1, t2;
+    struct fib f;
+
+AG_TRY:
+    ag_try(ag_pool_create(&pool, 4));
+
+    f.pool = pool;
+    f.n = 20;
+    ag_pool_task_init(&t1, fib_task, &f);
+    ag_pool_task_init(&t2, failing_task, NULL);
+    ag_pool_submit(pool, &t1);
+    ag_pool_submit(pool, &t2);
+
+    ag_try(ag_pool_wait(pool, &t1));
+    printf("fib(%d) = %ld\n", f.n, f.result);
+
+    ag_try(ag_pool_wait(pool, &t2));
+
+AG_CATCH:
+    printf("error: %s\n", ag_erno_message(ag_erno_get()));
+
+AG_FINALLY:
+    ag_pool_destroy(pool);
+    return ag_erno_get();
+}
+
+
+int
+main(void)
+{
+    return pool_example() == AG_ERNO_STATE ? 0 : 1;
+}
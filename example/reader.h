@@ -0,0 +1,46 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <argent/reader.h>
+
+
+    /* this function shows how you would read the lines of a stream, counting
+     * them along with the length of the longest one */
+static ag_erno
+scan(int fd)
+{
+    ag_string_view line;
+    ag_size lines = 0, longest = 0;
+    ag_reader *r;
+    ag_erno e;
+
+    if ((e = ag_reader_create(&r, fd, '\n', 0)))
+        return e;
+
+    while (ag_reader_line(r, &line)) {
+        lines++;
+        if (line.len > longest)
+            longest = line.len;
+    }
+
+    if (!(e = ag_reader_error(r)))
+        printf("%zu lines, longest %zu bytes\n", lines, longest);
+
+    ag_reader_destroy(r);
+    return e;
+}
+
+
+int
+main(void)
+{
+    ag_erno e;
+
+        /* try for instance: seq 1000000 | ./reader */
+    if ((e = scan(STDIN_FILENO))) {
+        printf("%s\n", ag_erno_message(e));
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
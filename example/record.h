@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <argent/record.h>
+
+
+    /* the first version of a trade record, and the second one, which appends
+     * a venue; field indices never change between versions */
+enum {
+    TRADE_ID, TRADE_PRICE, TRADE_QTY, TRADE_BUY, TRADE_SYMBOL, TRADE_VENUE
+};
+
+static const int trade_v1[] = {AG_RECORD_WORD_64, AG_RECORD_FLOAT_64,
+        AG_RECORD_INT_32, AG_RECORD_BOOL, AG_RECORD_STRING};
+
+static const int trade_v2[] = {AG_RECORD_WORD_64, AG_RECORD_FLOAT_64,
+        AG_RECORD_INT_32, AG_RECORD_BOOL, AG_RECORD_STRING, AG_RECORD_STRING};
+
+
+    /* this function shows how you would encode a record, and append the
+     * encoded bytes, which may be sent or written as they are, to a buffer;
+     * a string field that is not set reads as an empty string */
+static ag_erno
+encode(ag_record_builder *b, ag_word_64 id, const ag_string *symbol,
+        ag_bool buy, const ag_string *venue, ag_word_8 *buf, ag_size *used)
+{
+    const void *data;
+    ag_size len;
+    ag_erno e;
+
+    ag_record_builder_reset(b);
+
+    if ((e = ag_record_set_word_64(b, TRADE_ID, id))
+            || (e = ag_record_set_float_64(b, TRADE_PRICE, 101.25))
+            || (e = ag_record_set_int_32(b, TRADE_QTY, 300))
+            || (e = ag_record_set_bool(b, TRADE_BUY, buy))
+            || (e = ag_record_set_string(b, TRADE_SYMBOL, symbol, 4))
+            || (venue && (e = ag_record_set_string(b, TRADE_VENUE, venue,
+            strlen(venue))))
+            || (e = ag_record_builder_finish(b, &data, &len)))
+        return e;
+
+    memcpy(buf + *used, data, len);
+    *used += len;
+
+    return AG_ERNO_NULL;
+}
+
+
+    /* this function shows how you would read records laid out back to back
+     * in a buffer, through an older version of their schema; the fields are
+     * read in place, and the venue the reader does not know of is skipped */
+static ag_erno
+decode(const ag_record_schema *s, const ag_word_8 *buf, ag_size len)
+{
+    ag_string_view sym, venue;
+    ag_record r;
+    ag_size pos;
+    ag_erno e;
+
+    for (pos = 0; pos < len; pos += ag_record_size(&r)) {
+        if ((e = ag_record_open(&r, s, buf + pos, len - pos)))
+            return e;
+
+        sym = ag_record_get_string(&r, TRADE_SYMBOL);
+        venue = ag_record_get_string(&r, TRADE_VENUE);
+        printf("v%u #%llu %s %ld %.*s at %.2f, venue %s\n",
+                (unsigned) ag_record_version(&r),
+                (unsigned long long) ag_record_get_word_64(&r, TRADE_ID),
+                ag_record_get_bool(&r, TRADE_BUY) ? "buy" : "sell",
+                (long) ag_record_get_int_32(&r, TRADE_QTY), (int) sym.len,
+                sym.str, ag_record_get_float_64(&r, TRADE_PRICE),
+                !ag_record_has(&r, TRADE_VENUE) ? "unknown"
+                : venue.len ? venue.str : "unset");
+    }
+
+    return AG_ERNO_NULL;
+}
+
+
+int
+main(void)
+{
+        /* records must be read from memory aligned to eight bytes */
+    static ag_word_64 buf[64];
+    ag_record_schema v1, v2;
+    ag_record_builder *b = NULL;
+    ag_size used = 0;
+    ag_erno e;
+
+    if ((e = ag_record_schema_init(&v1, 0x7452, 1, trade_v1, 5))
+            || (e = ag_record_schema_init(&v2, 0x7452, 2, trade_v2, 6))
+            || (e = ag_record_builder_create(&b, &v2))
+            || (e = encode(b, 1, "ACME", true, NULL, (ag_word_8 *) buf, &used))
+            || (e = encode(b, 2, "INIT", false, "XNAS", (ag_word_8 *) buf,
+            &used))
+            || (e = decode(&v1, (const ag_word_8 *) buf, used))
+            || (e = decode(&v2, (const ag_word_8 *) buf, used)))
+        printf("%s\n", ag_erno_message(e));
+
+    ag_record_builder_destroy(b);
+    return e ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,69 @@
+#include <cstdio>
+#include <argent/result.hpp>
+
+
+    /* this is a C function that reports its output through a pointer, as is
+     * usual for code that uses the Argent Core Error Handling Module */
+extern "C" ag_erno
+parse_digit(char c, int *out)
+{
+AG_TRY:
+    ag_assert_range(c >= '0' && c <= '9');
+    *out = c - '0';
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+    /* this is how you would return a result from a C++ function */
+static ag::result<int>
+half(int x)
+{
+    if (x % 2)
+        return ag::fail(AG_ERNO_STATE);
+
+    return x / 2;
+}
+
+
+    /* this is how you would chain results, adapting the C function through
+     * ag::call() */
+static ag::result<int>
+parse_half(char c)
+{
+    return ag::call<int>(parse_digit, c)
+        .and_then(half)
+        .map([](int x) { return x * 10; });
+}
+
+
+    /* this is how you would use results within an AG_TRY block; note that
+     * the variables are declared before the try block */
+static ag_erno
+print_half(char c)
+{
+    int v = 0;
+
+AG_TRY:
+    ag_try_result(parse_half(c), v);
+    std::printf("%c -> %d\n", c, v);
+
+AG_CATCH:
+    std::printf("%c -> error %lu\n", c, (unsigned long) ag_erno_get());
+
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+int
+main(void)
+{
+    (void) print_half('8');
+    (void) print_half('7');
+    (void) print_half('x');
+
+    return ag::check(print_half('4')).ok() ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <pthread.h>
+#include <argent/seqlock.h>
+
+
+    /* this is a small configuration record that is read far more often than
+     * it is written; its fields are always updated together */
+struct config {
+    ag_word version;
+    ag_word limit;
+    ag_word timeout;
+};
+
+static ag_seqlock lock = AG_SEQLOCK_INIT;
+static struct config shared;
+
+
+    /* this thread function shows how you would read a consistent snapshot of
+     * the record without writing to any shared cache line */
+static void *
+reader(void *arg)
+{
+    struct config c;
+    ag_word torn = 0;
+    ag_index i;
+
+    (void) arg;
+    for (i = 0; i < 1000000; i++) {
+        ag_seqlock_read(&lock, &c, &shared, sizeof c);
+        if (c.limit != c.version * 2 || c.timeout != c.version * 3)
+            torn++;
+    }
+
+    return (void *) torn;
+}
+
+
+    /* this thread function shows how you would update the record; writers
+     * exclude each other through the lock */
+static void *
+writer(void *arg)
+{
+    struct config c;
+    ag_index i;
+
+    (void) arg;
+    for (i = 1; i <= 100000; i++) {
+        c.version = i;
+        c.limit = i * 2;
+        c.timeout = i * 3;
+        ag_seqlock_write(&lock, &shared, &c, sizeof c);
+    }
+
+    return NULL;
+}
+
+
+    /* this function shows how you would read a single field through the
+     * lower-level interface */
+static ag_word
+version(void)
+{
+    ag_word_32 seq;
+    ag_word v;
+
+    do {
+        seq = ag_seqlock_read_begin(&lock);
+        v = ag_atomic_word_load_explicit(&shared.version, AG_ATOMIC_RELAXED);
+    } while (ag_seqlock_read_retry(&lock, seq));
+
+    return v;
+}
+
+
+int
+main(void)
+{
+    pthread_t t[4];
+    void *torn;
+    ag_word total = 0;
+    ag_index i;
+
+    for (i = 0; i < 2; i++)
+        pthread_create(&t[i], NULL, reader, NULL);
+    for (; i < 4; i++)
+        pthread_create(&t[i], NULL, writer, NULL);
+
+    for (i = 0; i < 4; i++) {
+        pthread_join(t[i], &torn);
+        total += (ag_word) torn;
+    }
+
+    printf("version %lu, torn reads %lu\n", (unsigned long) version(),
+            (unsigned long) total);
+    return 0;
+}
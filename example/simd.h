@@ -0,0 +1,54 @@
+#include <stdio.h>
+#include <argent/simd.h>
+
+
+    /* this function shows how you would count the occurrences of a byte in a
+     * buffer, a whole block at a time */
+static ag_size
+count(const ag_string *s, ag_size len, ag_word_8 c)
+{
+    ag_simd_block b;
+    ag_size n = 0, i;
+
+    for (i = 0; i + AG_SIMD_BLOCK <= len; i += AG_SIMD_BLOCK) {
+        ag_simd_load(&b, s + i);
+        n += (ag_size) __builtin_popcountll(ag_simd_eq(&b, c));
+    }
+
+    if (i < len) {
+        ag_simd_load_partial(&b, s + i, len - i, 0);
+        n += (ag_size) __builtin_popcountll(ag_simd_eq(&b, c));
+    }
+
+    return n;
+}
+
+
+    /* this function shows how you would find the commas of a block that lie
+     * outside of quoted regions */
+static void
+commas(const ag_string *s)
+{
+    ag_simd_block b;
+    ag_simd_mask quoted, m;
+
+    ag_simd_load_partial(&b, s, strlen(s), 0);
+    quoted = ag_simd_prefix_xor(ag_simd_eq(&b, '"'));
+    m = ag_simd_eq(&b, ',') & ~quoted;
+
+    while (m)
+        printf("comma at %zu\n", ag_simd_next(&m));
+}
+
+
+int
+main(void)
+{
+    static const ag_string text[] = "the quick brown fox jumps over the lazy "
+            "dog, then the quick brown fox jumps over the lazy dog again";
+
+    printf("%zu spaces\n", count(text, sizeof text - 1, ' '));
+    commas("a,\"b,c\",d");
+
+    return 0;
+}
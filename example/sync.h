@@ -0,0 +1,86 @@
+#if !defined _GNU_SOURCE
+#   define _GNU_SOURCE
+#endif
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <argent/sync.h>
+
+
+    /* these are the primitives shared by the threads below; all of them are
+     * statically initialised */
+static ag_barrier phase = AG_BARRIER_INIT(4);
+static ag_latch started = AG_LATCH_INIT(4);
+static ag_once table_once = AG_ONCE_INIT;
+
+static ag_word *table;
+static ag_word sums[4];
+
+
+    /* this function initialises a lazy global; it is run exactly once, by
+     * whichever thread first needs the table */
+static ag_erno
+table_init(void *arg)
+{
+    ag_index i;
+
+    (void) arg;
+    if (!(table = (ag_word *) malloc(1024 * sizeof *table)))
+        return AG_ERNO_MEMORY;
+
+    for (i = 0; i < 1024; i++)
+        table[i] = i;
+
+    return AG_ERNO_NULL;
+}
+
+
+    /* this thread function shows how you would access a lazy global, and
+     * synchronise successive parallel phases through a barrier */
+static void *
+work(void *arg)
+{
+    ag_index id = (ag_index) arg, p, i;
+
+    ag_latch_count_down(&started, 1);
+
+    if (ag_once_call(&table_once, table_init, NULL))
+        return NULL;
+
+    for (p = 0; p < 1000; p++) {
+        for (i = id; i < 1024; i += 4)
+            sums[id] += table[i];
+
+            /* one thread updates the shared table between phases */
+        if (ag_barrier_wait(&phase))
+            table[p % 1024]++;
+        (void) ag_barrier_wait(&phase);
+    }
+
+    return NULL;
+}
+
+
+int
+main(void)
+{
+    pthread_t t[4];
+    ag_index i;
+
+    for (i = 0; i < 4; i++)
+        pthread_create(&t[i], NULL, work, (void *) i);
+
+        /* the latch is released once all threads have started */
+    ag_latch_wait(&started);
+    printf("all threads started\n");
+
+    for (i = 0; i < 4; i++)
+        pthread_join(t[i], NULL);
+
+    printf("%lu\n", (unsigned long) (sums[0] + sums[1] + sums[2] + sums[3]));
+    free(table);
+
+    return 0;
+}
@@ -113,3 +113,12 @@ string_example(void)
 }
 
 
+    /* this function gives an example of how to use the ag_string_view type */
+static void
+string_view_example(void)
+{
+    ag_string_view v = {"Hello, world!", 5};
+    printf ("%.*s\n", (int) v.len, v.str);
+}
+
+
@@ -0,0 +1,57 @@
+#if !defined _GNU_SOURCE
+#   define _GNU_SOURCE
+#endif
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <argent/writer.h>
+
+
+    /* this function shows how you would assemble a response from small copied
+     * fragments and a large body added by reference, so that all of it is
+     * sent through a single system call */
+static ag_erno
+respond(ag_writer *w, const ag_string *body, ag_size len)
+{
+    char hdr[64];
+    ag_erno e;
+
+    (void) snprintf(hdr, sizeof hdr, "Content-Length: %zu\r\n\r\n", len);
+
+    if ((e = ag_writer_string(w, "HTTP/1.1 200 OK\r\n"))
+            || (e = ag_writer_string(w, "Content-Type: text/plain\r\n"))
+            || (e = ag_writer_string(w, hdr))
+            || (e = ag_writer_ref(w, body, len)))
+        return e;
+
+        /* the body must stay valid until the writer is flushed */
+    return ag_writer_flush(w);
+}
+
+
+int
+main(void)
+{
+    static ag_string body[1024];
+    ag_writer *w;
+    ag_erno e;
+    ag_index i;
+
+    for (i = 0; i < sizeof body - 1; i++)
+        body[i] = (ag_string) ('a' + i % 26);
+    body[sizeof body - 1] = '\n';
+
+    if ((e = ag_writer_create(&w, STDOUT_FILENO, 0))) {
+        printf("%s\n", ag_erno_message(e));
+        return EXIT_FAILURE;
+    }
+
+    if ((e = respond(w, body, sizeof body)))
+        printf("%s\n", ag_erno_message(e));
+
+    ag_writer_destroy(w);
+
+    return e ? EXIT_FAILURE : EXIT_SUCCESS;
+}
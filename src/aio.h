@@ -0,0 +1,784 @@
+#if !defined ARGENT_CORE_AIO
+#define ARGENT_CORE_AIO
+
+
+/**************************************************************************//**
+ * @defgroup aio Argent Core AIO Module
+ * Asynchronous file I/O.
+ *
+ * The AIO Module provides asynchronous reads and writes of files over the
+ * Linux io_uring interface. Requests are queued into the submission ring
+ * without a system call, and are submitted in batches through a single system
+ * call, which may also reap the completions of earlier requests. Buffers may
+ * be registered with the kernel once, so that reads and writes through them
+ * do not pin and unpin their pages on each request.
+ *
+ * Kernels without io_uring, or whose io_uring lacks the plain read and write
+ * operations, are served by a thread pool issuing blocking @c pread() and @c
+ * pwrite() calls instead, with the same interface and completion semantics.
+ *
+ * Requests are described by @c ag_aio_req objects provided by the caller, so
+ * queueing a request does not allocate memory. Each request carries a
+ * completion callback, which reports the outcome of the request as an @c
+ * ag_erno error code; callbacks are always run on the thread reaping
+ * completions through @c ag_aio_poll().
+ *
+ * @note This module is specific to Linux, and requires the GNU C dialect or
+ * @c _GNU_SOURCE to be defined; client code must be linked with @c -pthread.
+ *
+ * @warning An engine is owned by a single thread, which alone may queue,
+ * submit and reap its requests.
+ * @{
+ */
+
+
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#include "pool.h"
+
+
+/**
+ * Fallback thread count.
+ *
+ * The @c AG_AIO_THREADS symbolic constant sets the number of threads of the
+ * pool serving requests when io_uring is not available. The default may be
+ * overridden by defining this constant before including this header.
+ */
+#if !defined AG_AIO_THREADS
+#   define AG_AIO_THREADS 4
+#endif
+
+
+/**
+ * Force fallback.
+ *
+ * The @c AG_AIO_FALLBACK symbolic constant is a flag requesting that an
+ * engine use its thread pool fallback even if io_uring is available.
+ *
+ * @see ag_aio_create()
+ */
+#define AG_AIO_FALLBACK 0x1
+
+
+struct ag_aio_req;
+
+
+/**
+ * Completion callback.
+ *
+ * The @c ag_aio_fn type is the signature of the function called once a request
+ * completes. A request that transfers fewer bytes than requested, such as a
+ * read reaching the end of a file, still completes successfully.
+ *
+ * @param req Completed request.
+ * @param e AG_ERNO_NULL if the request succeeded, or AG_ERNO_SYSTEM with @c
+ * errno set to the cause of failure.
+ * @param n Number of bytes transferred.
+ *
+ * @see ag_aio_read()
+ */
+typedef void (*ag_aio_fn)(struct ag_aio_req *req, ag_erno e, ag_size n);
+
+
+/**
+ * Request.
+ *
+ * The @c ag_aio_req type describes a read or write request. It is filled in by
+ * the functions queueing requests, and must remain valid until its completion
+ * callback has been called. The @c ctx member is free for use by the caller.
+ *
+ * @see ag_aio_read()
+ */
+typedef struct ag_aio_req {
+    ag_aio_fn fn;
+    void *ctx;
+    void *buf;
+    ag_size len;
+    ag_int_64 off;
+    long res;
+    int fd;
+    int op;
+    int index;
+    struct ag_aio *aio;
+    struct ag_aio_req *next;
+    ag_pool_task task;
+} ag_aio_req;
+
+
+    /* mapped rings of an io_uring instance */
+struct ag__aio_ring__ {
+    void *sq_map;
+    void *cq_map;
+    struct io_uring_sqe *sqes;
+    ag_size sq_size;
+    ag_size cq_size;
+    ag_word_32 *sq_head;
+    ag_word_32 *sq_tail;
+    ag_word_32 *sq_array;
+    ag_word_32 sq_mask;
+    ag_word_32 sq_entries;
+    ag_word_32 *cq_head;
+    ag_word_32 *cq_tail;
+    struct io_uring_cqe *cqes;
+    ag_word_32 cq_mask;
+    ag_word_32 cq_entries;
+};
+
+
+/**
+ * Asynchronous I/O engine.
+ *
+ * The @c ag_aio type is an engine issuing asynchronous reads and writes, over
+ * io_uring or its thread pool fallback. Engines are created through @c
+ * ag_aio_create().
+ *
+ * @see ag_aio_create()
+ */
+typedef struct ag_aio {
+    struct ag__aio_ring__ ring;
+    int fd;
+    ag_word_32 tail;
+    ag_size depth;
+    ag_size queued;
+    ag_size inflight;
+    ag_pool *pool;
+    ag_aio_req *head;
+    ag_aio_req *last;
+    const struct iovec *bufs;
+    ag_size nbufs;
+    ag_cacheline_aligned ag_aio_req *done;
+    ag_event ready;
+} ag_aio;
+
+
+static inline long
+ag__aio_setup__(unsigned entries, struct io_uring_params *p)
+{
+    return syscall(__NR_io_uring_setup, entries, p);
+}
+
+
+static inline long
+ag__aio_enter__(int fd, unsigned submit, unsigned wait, unsigned flags)
+{
+    return syscall(__NR_io_uring_enter, fd, submit, wait, flags, NULL, 0);
+}
+
+
+static inline long
+ag__aio_register__(int fd, unsigned op, const void *arg, unsigned n)
+{
+    return syscall(__NR_io_uring_register, fd, op, arg, n);
+}
+
+
+static inline void
+ag__aio_unmap__(ag_aio *a)
+{
+    struct ag__aio_ring__ *r = &a->ring;
+
+    if (r->sqes)
+        (void) munmap(r->sqes, r->sq_entries * sizeof *r->sqes);
+    if (r->cq_map && r->cq_map != r->sq_map)
+        (void) munmap(r->cq_map, r->cq_size);
+    if (r->sq_map)
+        (void) munmap(r->sq_map, r->sq_size);
+}
+
+
+    /* sets up an io_uring instance with at least the given number of entries,
+     * returning false if io_uring is not available */
+static inline ag_bool
+ag__aio_ring_init__(ag_aio *a, ag_size depth)
+{
+    struct ag__aio_ring__ *r = &a->ring;
+    struct io_uring_params p;
+    char *sq, *cq;
+
+    memset(&p, 0, sizeof p);
+    memset(r, 0, sizeof *r);
+
+    a->fd = (int) ag__aio_setup__((unsigned) depth, &p);
+    if (a->fd < 0)
+        return false;
+
+        /* plain reads and writes arrived along with this feature */
+    if (!(p.features & IORING_FEAT_RW_CUR_POS))
+        goto fail;
+
+    r->sq_size = p.sq_off.array + p.sq_entries * sizeof (ag_word_32);
+    r->cq_size = p.cq_off.cqes + p.cq_entries * sizeof (struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP && r->cq_size > r->sq_size)
+        r->sq_size = r->cq_size;
+
+    r->sq_map = mmap(NULL, r->sq_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, a->fd, IORING_OFF_SQ_RING);
+    if (r->sq_map == MAP_FAILED) {
+        r->sq_map = NULL;
+        goto fail;
+    }
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        r->cq_map = r->sq_map;
+    else {
+        r->cq_map = mmap(NULL, r->cq_size, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, a->fd, IORING_OFF_CQ_RING);
+        if (r->cq_map == MAP_FAILED) {
+            r->cq_map = NULL;
+            goto fail;
+        }
+    }
+
+    r->sq_entries = p.sq_entries;
+    r->sqes = (struct io_uring_sqe *) mmap(NULL, p.sq_entries
+            * sizeof *r->sqes, PROT_READ | PROT_WRITE, MAP_SHARED
+            | MAP_POPULATE, a->fd, IORING_OFF_SQES);
+    if ((void *) r->sqes == MAP_FAILED) {
+        r->sqes = NULL;
+        goto fail;
+    }
+
+    sq = (char *) r->sq_map;
+    cq = (char *) r->cq_map;
+    r->sq_head = (ag_word_32 *) (sq + p.sq_off.head);
+    r->sq_tail = (ag_word_32 *) (sq + p.sq_off.tail);
+    r->sq_array = (ag_word_32 *) (sq + p.sq_off.array);
+    r->sq_mask = *(ag_word_32 *) (sq + p.sq_off.ring_mask);
+    r->cq_head = (ag_word_32 *) (cq + p.cq_off.head);
+    r->cq_tail = (ag_word_32 *) (cq + p.cq_off.tail);
+    r->cqes = (struct io_uring_cqe *) (cq + p.cq_off.cqes);
+    r->cq_mask = *(ag_word_32 *) (cq + p.cq_off.ring_mask);
+    r->cq_entries = p.cq_entries;
+
+    a->tail = *r->sq_tail;
+    a->depth = p.sq_entries;
+    return true;
+
+fail:
+    ag__aio_unmap__(a);
+    (void) close(a->fd);
+    a->fd = -1;
+    return false;
+}
+
+
+    /* runs a request on a fallback pool thread, and hands it back to the
+     * thread reaping completions */
+static inline ag_erno
+ag__aio_task__(void *arg)
+{
+    ag_aio_req *req = (ag_aio_req *) arg;
+    ag_aio *a = req->aio;
+    ag_aio_req *head;
+
+    req->res = req->op == IORING_OP_READ || req->op == IORING_OP_READ_FIXED
+            ? (long) pread(req->fd, req->buf, req->len, (off_t) req->off)
+            : (long) pwrite(req->fd, req->buf, req->len, (off_t) req->off);
+    if (req->res < 0)
+        req->res = -errno;
+
+    head = (ag_aio_req *) ag_atomic_ptr_load_explicit(&a->done,
+            AG_ATOMIC_RELAXED);
+    do {
+        req->next = head;
+    } while (!ag_atomic_ptr_cas_weak_explicit(&a->done, &head, req,
+            AG_ATOMIC_RELEASE, AG_ATOMIC_RELAXED));
+
+    ag_event_set(&a->ready);
+    return AG_ERNO_NULL;
+}
+
+
+static inline void
+ag__aio_complete__(ag_aio_req *req)
+{
+    if (req->res < 0) {
+        errno = (int) -req->res;
+        req->fn(req, AG_ERNO_SYSTEM, 0);
+    } else
+        req->fn(req, AG_ERNO_NULL, (ag_size) req->res);
+}
+
+
+/**
+ * Create engine.
+ *
+ * The @c ag_aio_create() function creates an asynchronous I/O engine @p a
+ * that can have up to @p depth requests in flight. The engine uses io_uring if
+ * it is available and @p flags does not include @c AG_AIO_FALLBACK, and a
+ * thread pool otherwise.
+ *
+ * @param a Engine to create.
+ * @param depth Maximum number of requests in flight.
+ * @param flags Zero or @c AG_AIO_FALLBACK.
+ *
+ * @return AG_ERNO_NULL if the engine has been created.
+ * @return AG_ERNO_HANDLE if @p a is a null pointer.
+ * @return AG_ERNO_RANGE if @p depth is zero.
+ * @return AG_ERNO_MEMORY if the engine could not be allocated.
+ * @return AG_ERNO_SYSTEM if the fallback pool could not be started.
+ *
+ * @see ag_aio_destroy()
+ */
+static inline ag_erno
+ag_aio_create(ag_aio **a, ag_size depth, int flags)
+{
+    ag_aio *aio = NULL;
+
+AG_TRY:
+    ag_assert_handle(a);
+    ag_assert_range(depth);
+
+    aio = (ag_aio *) aligned_alloc(AG_CACHELINE_SIZE, sizeof *aio);
+    ag_assert(aio, AG_ERNO_MEMORY);
+
+    aio->fd = -1;
+    aio->queued = aio->inflight = 0;
+    aio->pool = NULL;
+    aio->head = aio->last = aio->done = NULL;
+    aio->bufs = NULL;
+    aio->nbufs = 0;
+    aio->ready = AG_EVENT_INIT;
+
+    if ((flags & AG_AIO_FALLBACK) || !ag__aio_ring_init__(aio, depth)) {
+        aio->depth = depth;
+        ag_try(ag_pool_create(&aio->pool, AG_AIO_THREADS));
+    }
+
+    *a = aio;
+
+AG_CATCH:
+    free(aio);
+
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Destroy engine.
+ *
+ * The @c ag_aio_destroy() function releases an engine @p a. All requests
+ * queued on @p a must have completed before calling this function.
+ *
+ * @param a Engine to destroy; may be a null pointer.
+ *
+ * @see ag_aio_create()
+ */
+static inline void
+ag_aio_destroy(ag_aio *a)
+{
+    if (ag_unlikely (!a))
+        return;
+
+    if (a->pool)
+        ag_pool_destroy(a->pool);
+    else {
+        ag__aio_unmap__(a);
+        (void) close(a->fd);
+    }
+
+    free(a);
+}
+
+
+/**
+ * Check fallback.
+ *
+ * The @c ag_aio_fallback() function checks whether an engine @p a serves its
+ * requests through its thread pool fallback rather than io_uring.
+ *
+ * @param a Engine to check.
+ *
+ * @return @c true if @p a uses its fallback.
+ */
+static inline ag_bool
+ag_aio_fallback(const ag_aio *a)
+{
+    return !!a->pool;
+}
+
+
+/**
+ * Register buffers.
+ *
+ * The @c ag_aio_register() function registers @p n buffers described by @p
+ * bufs with an engine @p a, for use by @c ag_aio_read_fixed() and @c
+ * ag_aio_write_fixed(). The buffers and their descriptors must remain valid
+ * while they are registered, and no request may be in flight. Registering a
+ * new set of buffers replaces the previous one.
+ *
+ * @param a Engine to register buffers with.
+ * @param bufs Buffer descriptors.
+ * @param n Number of buffers.
+ *
+ * @return AG_ERNO_NULL if the buffers have been registered.
+ * @return AG_ERNO_HANDLE if @p a or @p bufs is a null pointer.
+ * @return AG_ERNO_STATE if requests are in flight.
+ * @return AG_ERNO_SYSTEM if the kernel failed to register the buffers.
+ */
+static inline ag_erno
+ag_aio_register(ag_aio *a, const struct iovec *bufs, ag_size n)
+{
+AG_TRY:
+    ag_assert_handle(a && bufs);
+    ag_assert_state(!a->inflight && !a->queued);
+
+    if (!a->pool) {
+        if (a->nbufs)
+            (void) ag__aio_register__(a->fd, IORING_UNREGISTER_BUFFERS, NULL,
+                    0);
+        a->nbufs = 0;
+
+        ag_assert(ag__aio_register__(a->fd, IORING_REGISTER_BUFFERS, bufs,
+                (unsigned) n) >= 0, AG_ERNO_SYSTEM);
+    }
+
+    a->bufs = bufs;
+    a->nbufs = n;
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Submit queued requests.
+ *
+ * The @c ag_aio_submit() function submits all requests queued on an engine @p
+ * a through a single system call.
+ *
+ * @param a Engine to submit requests of.
+ *
+ * @return AG_ERNO_NULL if the requests have been submitted.
+ * @return AG_ERNO_HANDLE if @p a is a null pointer.
+ * @return AG_ERNO_SYSTEM if the kernel failed to accept the requests.
+ *
+ * @see ag_aio_poll()
+ */
+static inline ag_erno
+ag_aio_submit(ag_aio *a)
+{
+    ag_aio_req *req, *next;
+    long n;
+
+AG_TRY:
+    ag_assert_handle(a);
+
+    if (a->pool) {
+        for (req = a->head; req; req = next) {
+            next = req->next;
+            ag_pool_submit(a->pool, &req->task);
+        }
+
+        a->head = a->last = NULL;
+        a->inflight += a->queued;
+        a->queued = 0;
+    } else if (a->queued) {
+        ag_atomic_word_32_store_explicit(a->ring.sq_tail, a->tail,
+                AG_ATOMIC_RELEASE);
+        do {
+            n = ag__aio_enter__(a->fd, (unsigned) a->queued, 0, 0);
+        } while (n < 0 && errno == EINTR);
+        ag_assert(n >= 0, AG_ERNO_SYSTEM);
+
+        a->queued -= (ag_size) n;
+        a->inflight += (ag_size) n;
+    }
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+    /* queues a request, submitting the queued requests first if the
+     * submission ring is full */
+static inline ag_erno
+ag__aio_queue__(ag_aio *a, ag_aio_req *req, int op, int fd, void *buf,
+        ag_size len, ag_int_64 off, int index, ag_aio_fn fn)
+{
+    struct io_uring_sqe *sqe;
+    ag_word_32 i;
+
+AG_TRY:
+    ag_assert_handle(a && req && fn && (buf || !len));
+    ag_assert_range(index < 0 || (ag_size) index < a->nbufs);
+    ag_assert_state(a->queued + a->inflight < a->depth);
+
+    req->fn = fn;
+    req->buf = buf;
+    req->len = len;
+    req->off = off;
+    req->fd = fd;
+    req->op = op;
+    req->index = index;
+    req->aio = a;
+    req->res = 0;
+
+    if (a->pool) {
+        ag_pool_task_init(&req->task, ag__aio_task__, req);
+        req->next = NULL;
+        if (a->last)
+            a->last->next = req;
+        else
+            a->head = req;
+        a->last = req;
+    } else {
+        if (a->tail - ag_atomic_word_32_load_explicit(a->ring.sq_head,
+                AG_ATOMIC_ACQUIRE) >= a->ring.sq_entries)
+            ag_try(ag_aio_submit(a));
+
+        i = a->tail & a->ring.sq_mask;
+        sqe = &a->ring.sqes[i];
+        memset(sqe, 0, sizeof *sqe);
+        sqe->opcode = (ag_word_8) op;
+        sqe->fd = fd;
+        sqe->off = (ag_word_64) off;
+        sqe->addr = (ag_word_64) (ag_word) buf;
+        sqe->len = (ag_word_32) len;
+        sqe->user_data = (ag_word_64) (ag_word) req;
+        if (index >= 0)
+            sqe->buf_index = (ag_word_16) index;
+
+        a->ring.sq_array[i] = i;
+        a->tail++;
+    }
+
+    a->queued++;
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Queue read.
+ *
+ * The @c ag_aio_read() function queues a request @p req on an engine @p a to
+ * read up to @p len bytes at offset @p off of file @p fd into @p buf, and
+ * call @p fn on completion. The request is issued by the next call to @c
+ * ag_aio_submit(), or earlier if the submission queue is full.
+ *
+ * @param a Engine to queue request on.
+ * @param req Request to queue.
+ * @param fd File descriptor.
+ * @param buf Buffer to read into.
+ * @param len Number of bytes to read.
+ * @param off File offset to read from.
+ * @param fn Completion callback.
+ *
+ * @return AG_ERNO_NULL if the request has been queued.
+ * @return AG_ERNO_HANDLE if @p a, @p req, @p fn or @p buf is a null pointer.
+ * @return AG_ERNO_STATE if @p a already has as many requests in flight as
+ * its depth.
+ * @return AG_ERNO_SYSTEM if a full submission queue could not be submitted.
+ *
+ * @see ag_aio_write()
+ * @see ag_aio_submit()
+ */
+static inline ag_erno
+ag_aio_read(ag_aio *a, ag_aio_req *req, int fd, void *buf, ag_size len,
+        ag_int_64 off, ag_aio_fn fn)
+{
+    return ag__aio_queue__(a, req, IORING_OP_READ, fd, buf, len, off, -1, fn);
+}
+
+
+/**
+ * Queue write.
+ *
+ * The @c ag_aio_write() function queues a request @p req on an engine @p a to
+ * write @p len bytes from @p buf at offset @p off of file @p fd, and call @p
+ * fn on completion.
+ *
+ * @param a Engine to queue request on.
+ * @param req Request to queue.
+ * @param fd File descriptor.
+ * @param buf Buffer to write from.
+ * @param len Number of bytes to write.
+ * @param off File offset to write at.
+ * @param fn Completion callback.
+ *
+ * @return See @c ag_aio_read().
+ *
+ * @see ag_aio_read()
+ */
+static inline ag_erno
+ag_aio_write(ag_aio *a, ag_aio_req *req, int fd, const void *buf,
+        ag_size len, ag_int_64 off, ag_aio_fn fn)
+{
+    return ag__aio_queue__(a, req, IORING_OP_WRITE, fd, (void *) buf, len,
+            off, -1, fn);
+}
+
+
+/**
+ * Queue read into registered buffer.
+ *
+ * The @c ag_aio_read_fixed() function works as @c ag_aio_read(), reading into
+ * @p buf within the registered buffer @p index.
+ *
+ * @param a Engine to queue request on.
+ * @param req Request to queue.
+ * @param fd File descriptor.
+ * @param buf Address within registered buffer to read into.
+ * @param len Number of bytes to read.
+ * @param off File offset to read from.
+ * @param index Index of registered buffer.
+ * @param fn Completion callback.
+ *
+ * @return See @c ag_aio_read().
+ * @return AG_ERNO_RANGE if @p index is not that of a registered buffer.
+ *
+ * @see ag_aio_register()
+ */
+static inline ag_erno
+ag_aio_read_fixed(ag_aio *a, ag_aio_req *req, int fd, void *buf,
+        ag_size len, ag_int_64 off, int index, ag_aio_fn fn)
+{
+    return ag__aio_queue__(a, req, IORING_OP_READ_FIXED, fd, buf, len, off,
+            index, fn);
+}
+
+
+/**
+ * Queue write from registered buffer.
+ *
+ * The @c ag_aio_write_fixed() function works as @c ag_aio_write(), writing
+ * from @p buf within the registered buffer @p index.
+ *
+ * @param a Engine to queue request on.
+ * @param req Request to queue.
+ * @param fd File descriptor.
+ * @param buf Address within registered buffer to write from.
+ * @param len Number of bytes to write.
+ * @param off File offset to write at.
+ * @param index Index of registered buffer.
+ * @param fn Completion callback.
+ *
+ * @return See @c ag_aio_read_fixed().
+ *
+ * @see ag_aio_register()
+ */
+static inline ag_erno
+ag_aio_write_fixed(ag_aio *a, ag_aio_req *req, int fd, const void *buf,
+        ag_size len, ag_int_64 off, int index, ag_aio_fn fn)
+{
+    return ag__aio_queue__(a, req, IORING_OP_WRITE_FIXED, fd, (void *) buf,
+            len, off, index, fn);
+}
+
+
+/**
+ * Reap completions.
+ *
+ * The @c ag_aio_poll() function submits any requests queued on an engine @p
+ * a, waits until at least @p min requests have completed, and calls the
+ * completion callbacks of all completed requests on the calling thread.
+ * Callbacks may queue further requests, but must not call this function.
+ *
+ * @param a Engine to reap completions of.
+ * @param min Minimum number of completions to wait for, which is capped at
+ * the number of requests in flight.
+ * @param n Contextual number of completions reaped; may be a null pointer.
+ *
+ * @return AG_ERNO_NULL if completions have been reaped.
+ * @return AG_ERNO_HANDLE if @p a is a null pointer.
+ * @return AG_ERNO_SYSTEM if waiting for completions failed.
+ *
+ * @see ag_aio_submit()
+ */
+static inline ag_erno
+ag_aio_poll(ag_aio *a, ag_size min, ag_size *n)
+{
+    struct io_uring_cqe *cqe;
+    ag_aio_req *req, *list, *next;
+    ag_word_32 head, tail;
+    ag_size count = 0;
+    long r;
+
+AG_TRY:
+    ag_assert_handle(a);
+    ag_try(ag_aio_submit(a));
+
+    if (min > a->inflight)
+        min = a->inflight;
+
+    do {
+        if (a->pool) {
+                /* the event is reset before the list is taken, so that a
+                 * completion pushed in between is not slept through */
+            ag_event_reset(&a->ready);
+            list = (ag_aio_req *) ag_atomic_ptr_exchange_explicit(&a->done,
+                    NULL, AG_ATOMIC_ACQUIRE);
+
+            if (!list && count < min) {
+                ag_event_wait(&a->ready);
+                continue;
+            }
+
+                /* completions are pushed in reverse order */
+            for (req = NULL; list; list = next) {
+                next = list->next;
+                list->next = req;
+                req = list;
+            }
+
+            for (; req; req = next) {
+                next = req->next;
+                (void) ag_pool_wait(a->pool, &req->task);
+                a->inflight--;
+                count++;
+                ag__aio_complete__(req);
+            }
+        } else {
+            head = *a->ring.cq_head;
+            tail = ag_atomic_word_32_load_explicit(a->ring.cq_tail,
+                    AG_ATOMIC_ACQUIRE);
+
+            if (head == tail && count < min) {
+                r = ag__aio_enter__(a->fd, 0, (unsigned) (min - count),
+                        IORING_ENTER_GETEVENTS);
+                ag_assert(r >= 0 || errno == EINTR, AG_ERNO_SYSTEM);
+                continue;
+            }
+
+            for (; head != tail; head++) {
+                cqe = &a->ring.cqes[head & a->ring.cq_mask];
+                req = (ag_aio_req *) (ag_word) cqe->user_data;
+                req->res = cqe->res;
+
+                    /* the entry is released before the callback runs, so
+                     * that the callback may queue further requests */
+                ag_atomic_word_32_store_explicit(a->ring.cq_head, head + 1,
+                        AG_ATOMIC_RELEASE);
+                a->inflight--;
+                count++;
+                ag__aio_complete__(req);
+            }
+        }
+    } while (count < min);
+
+    if (n)
+        *n = count;
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * @example aio.h
+ * This is an example showing how to code against the Argent Core AIO Module
+ * interface.
+ * @}
+ */
+
+
+#endif /* !defined ARGENT_CORE_AIO */
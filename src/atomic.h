@@ -0,0 +1,483 @@
+#if !defined ARGENT_CORE_ATOMIC
+#define ARGENT_CORE_ATOMIC
+
+
+/**************************************************************************//**
+ * @defgroup atomic Argent Core Atomic Module
+ * Typed atomic operations.
+ *
+ * The Atomic Module provides atomic operations over the primitive data types
+ * of the Type Module, with explicit control over memory ordering. These
+ * operations are the building blocks of the lock-free data structures and
+ * synchronisation primitives provided by the Argent Core Library.
+ *
+ * The operations are implemented over the @c __atomic family of builtins that
+ * are common to GNU C and Clang, so that concurrent code written against this
+ * module is portable between both compilers. The operations work on plain
+ * (non-@c _Atomic) objects, which must be naturally aligned.
+ *
+ * For each type @c T in the table below, the following operations are defined
+ * as inline functions, where @c name is the type suffix:
+ *
+ * | Operation                            | Returns                        |
+ * |--------------------------------------|--------------------------------|
+ * | @c ag_atomic_name_load(p)            | value of @c *p                 |
+ * | @c ag_atomic_name_store(p, v)        | nothing                        |
+ * | @c ag_atomic_name_exchange(p, v)     | previous value of @c *p        |
+ * | @c ag_atomic_name_cas(p, e, v)       | @c true if @c *p was @c *e     |
+ * | @c ag_atomic_name_cas_weak(p, e, v)  | as above, may fail spuriously  |
+ * | @c ag_atomic_name_fetch_add(p, v)    | previous value of @c *p        |
+ * | @c ag_atomic_name_fetch_sub(p, v)    | previous value of @c *p        |
+ * | @c ag_atomic_name_fetch_and(p, v)    | previous value of @c *p        |
+ * | @c ag_atomic_name_fetch_or(p, v)     | previous value of @c *p        |
+ * | @c ag_atomic_name_fetch_xor(p, v)    | previous value of @c *p        |
+ * | @c ag_atomic_name_add_fetch(p, v)    | new value of @c *p             |
+ * | @c ag_atomic_name_sub_fetch(p, v)    | new value of @c *p             |
+ *
+ * | Suffix      | Type          | Suffix      | Type          |
+ * |-------------|---------------|-------------|---------------|
+ * | @c word     | @c ag_word    | @c int      | @c ag_int     |
+ * | @c word_8   | @c ag_word_8  | @c int_8    | @c ag_int_8   |
+ * | @c word_16  | @c ag_word_16 | @c int_16   | @c ag_int_16  |
+ * | @c word_32  | @c ag_word_32 | @c int_32   | @c ag_int_32  |
+ * | @c word_64  | @c ag_word_64 | @c int_64   | @c ag_int_64  |
+ * | @c uint     | @c ag_uint    | @c size     | @c ag_size    |
+ * | @c uint_8   | @c ag_uint_8  | @c bool     | @c ag_bool    |
+ * | @c uint_16  | @c ag_uint_16 |             |               |
+ * | @c uint_32  | @c ag_uint_32 |             |               |
+ * | @c uint_64  | @c ag_uint_64 |             |               |
+ *
+ * The @c ag_bool operations are limited to load, store, exchange and
+ * compare-and-swap. The operations listed above are sequentially consistent;
+ * each also has an @c _explicit variant that takes the memory ordering as an
+ * extra trailing argument (two for compare-and-swap, for success and failure),
+ * which should be one of the @c AG_ATOMIC_* ordering constants. Load, store,
+ * exchange and compare-and-swap over pointers are provided as type-generic
+ * macros following the same naming, with the suffix @c ptr.
+ * @{
+ */
+
+
+#include "core.h"
+
+
+/**
+ * Memory ordering.
+ *
+ * The @c ag_atomic_order type holds one of the @c AG_ATOMIC_* memory ordering
+ * constants that are passed to the @c _explicit variants of the atomic
+ * operations. Orderings should be passed as constants so that they resolve at
+ * compile-time.
+ */
+typedef int ag_atomic_order;
+
+
+/**
+ * Relaxed ordering.
+ *
+ * The @c AG_ATOMIC_RELAXED symbolic constant indicates that an atomic
+ * operation imposes no ordering on other memory accesses.
+ */
+#define AG_ATOMIC_RELAXED __ATOMIC_RELAXED
+
+
+/**
+ * Consume ordering.
+ *
+ * The @c AG_ATOMIC_CONSUME symbolic constant indicates that an atomic load
+ * orders subsequent accesses that depend on the value loaded. Both GNU C and
+ * Clang currently treat this ordering as @c AG_ATOMIC_ACQUIRE.
+ */
+#define AG_ATOMIC_CONSUME __ATOMIC_CONSUME
+
+
+/**
+ * Acquire ordering.
+ *
+ * The @c AG_ATOMIC_ACQUIRE symbolic constant indicates that no memory access
+ * that follows an atomic load may be reordered before it.
+ */
+#define AG_ATOMIC_ACQUIRE __ATOMIC_ACQUIRE
+
+
+/**
+ * Release ordering.
+ *
+ * The @c AG_ATOMIC_RELEASE symbolic constant indicates that no memory access
+ * that precedes an atomic store may be reordered after it.
+ */
+#define AG_ATOMIC_RELEASE __ATOMIC_RELEASE
+
+
+/**
+ * Acquire-release ordering.
+ *
+ * The @c AG_ATOMIC_ACQ_REL symbolic constant combines @c AG_ATOMIC_ACQUIRE and
+ * @c AG_ATOMIC_RELEASE for read-modify-write operations.
+ */
+#define AG_ATOMIC_ACQ_REL __ATOMIC_ACQ_REL
+
+
+/**
+ * Sequentially consistent ordering.
+ *
+ * The @c AG_ATOMIC_SEQ_CST symbolic constant indicates that an atomic
+ * operation takes part in a single total order with all other sequentially
+ * consistent operations. This is the ordering used by the atomic operations
+ * that do not take an explicit ordering.
+ */
+#define AG_ATOMIC_SEQ_CST __ATOMIC_SEQ_CST
+
+
+/**
+ * Cache line size.
+ *
+ * The @c AG_CACHELINE_SIZE symbolic constant is the size in bytes of the
+ * destructive interference range of the host processor, and is used to pad
+ * shared objects so that they do not share cache lines. This is 128 bytes on
+ * AArch64, which covers the larger cache lines of some implementations, and 64
+ * bytes elsewhere. The default may be overridden by defining this constant
+ * before including this header.
+ *
+ * @see ag_cacheline_aligned
+ */
+#if !defined AG_CACHELINE_SIZE
+#   if (defined __aarch64__)
+#       define AG_CACHELINE_SIZE 128
+#   else
+#       define AG_CACHELINE_SIZE 64
+#   endif
+#endif
+
+
+/**
+ * Hints that an object is cache line aligned.
+ *
+ * The @c ag_cacheline_aligned macro is used to decorate a structure or object
+ * declaration so that it is aligned to @c AG_CACHELINE_SIZE bytes. A structure
+ * so decorated is also padded to a multiple of @c AG_CACHELINE_SIZE bytes, and
+ * so never shares a cache line with another object.
+ *
+ * @see AG_CACHELINE_SIZE
+ */
+#define ag_cacheline_aligned __attribute__((aligned(AG_CACHELINE_SIZE)))
+
+
+/**
+ * Hints that a thread is spinning.
+ *
+ * The @c ag_atomic_pause() macro is called within the body of a busy-wait loop
+ * to let the host processor know that the thread is spinning. This reduces
+ * the power consumed and the penalty paid on leaving the loop, and on
+ * processors with simultaneous multithreading, yields resources to the sibling
+ * thread. On processors without such an instruction, this macro acts as a
+ * compiler barrier.
+ */
+#if (defined __x86_64__ || defined __i386__)
+#   define ag_atomic_pause() __builtin_ia32_pause()
+#elif (defined __aarch64__ || defined __arm__)
+#   define ag_atomic_pause() __asm__ __volatile__ ("yield" ::: "memory")
+#else
+#   define ag_atomic_pause() __asm__ __volatile__ ("" ::: "memory")
+#endif
+
+
+/**
+ * Issue memory fence.
+ *
+ * The @c ag_atomic_fence() macro issues a memory fence with the ordering @p o,
+ * which synchronises with other threads.
+ *
+ * @param o Memory ordering of the fence.
+ *
+ * @see ag_atomic_signal_fence()
+ */
+#define ag_atomic_fence(o) __atomic_thread_fence(o)
+
+
+/**
+ * Issue compiler fence.
+ *
+ * The @c ag_atomic_signal_fence() macro issues a fence with the ordering @p o
+ * that synchronises only with a signal handler executed on the same thread,
+ * and so only constrains the compiler.
+ *
+ * @param o Memory ordering of the fence.
+ *
+ * @see ag_atomic_fence()
+ */
+#define ag_atomic_signal_fence(o) __atomic_signal_fence(o)
+
+
+    /* the operations are forced inline so that the memory ordering arguments
+     * are always seen as constants by the builtins */
+#define AG__ATOMIC_INLINE__ static inline __attribute__((always_inline))
+
+
+#define AG__ATOMIC_BASE__(n, t)                                             \
+    AG__ATOMIC_INLINE__ t                                                   \
+    ag_atomic_##n##_load_explicit(const t *p, ag_atomic_order o)            \
+    {                                                                       \
+        return __atomic_load_n(p, o);                                       \
+    }                                                                       \
+                                                                            \
+    AG__ATOMIC_INLINE__ t                                                   \
+    ag_atomic_##n##_load(const t *p)                                        \
+    {                                                                       \
+        return __atomic_load_n(p, __ATOMIC_SEQ_CST);                        \
+    }                                                                       \
+                                                                            \
+    AG__ATOMIC_INLINE__ void                                                \
+    ag_atomic_##n##_store_explicit(t *p, t v, ag_atomic_order o)            \
+    {                                                                       \
+        __atomic_store_n(p, v, o);                                          \
+    }                                                                       \
+                                                                            \
+    AG__ATOMIC_INLINE__ void                                                \
+    ag_atomic_##n##_store(t *p, t v)                                        \
+    {                                                                       \
+        __atomic_store_n(p, v, __ATOMIC_SEQ_CST);                           \
+    }                                                                       \
+                                                                            \
+    AG__ATOMIC_INLINE__ t                                                   \
+    ag_atomic_##n##_exchange_explicit(t *p, t v, ag_atomic_order o)         \
+    {                                                                       \
+        return __atomic_exchange_n(p, v, o);                                \
+    }                                                                       \
+                                                                            \
+    AG__ATOMIC_INLINE__ t                                                   \
+    ag_atomic_##n##_exchange(t *p, t v)                                     \
+    {                                                                       \
+        return __atomic_exchange_n(p, v, __ATOMIC_SEQ_CST);                 \
+    }                                                                       \
+                                                                            \
+    AG__ATOMIC_INLINE__ ag_bool                                             \
+    ag_atomic_##n##_cas_explicit(t *p, t *e, t v, ag_atomic_order s,        \
+            ag_atomic_order f)                                              \
+    {                                                                       \
+        return __atomic_compare_exchange_n(p, e, v, 0, s, f);               \
+    }                                                                       \
+                                                                            \
+    AG__ATOMIC_INLINE__ ag_bool                                             \
+    ag_atomic_##n##_cas(t *p, t *e, t v)                                    \
+    {                                                                       \
+        return __atomic_compare_exchange_n(p, e, v, 0, __ATOMIC_SEQ_CST,    \
+                __ATOMIC_SEQ_CST);                                          \
+    }                                                                       \
+                                                                            \
+    AG__ATOMIC_INLINE__ ag_bool                                             \
+    ag_atomic_##n##_cas_weak_explicit(t *p, t *e, t v, ag_atomic_order s,   \
+            ag_atomic_order f)                                              \
+    {                                                                       \
+        return __atomic_compare_exchange_n(p, e, v, 1, s, f);               \
+    }                                                                       \
+                                                                            \
+    AG__ATOMIC_INLINE__ ag_bool                                             \
+    ag_atomic_##n##_cas_weak(t *p, t *e, t v)                               \
+    {                                                                       \
+        return __atomic_compare_exchange_n(p, e, v, 1, __ATOMIC_SEQ_CST,    \
+                __ATOMIC_SEQ_CST);                                          \
+    }
+
+
+#define AG__ATOMIC_FETCH__(n, t, op)                                        \
+    AG__ATOMIC_INLINE__ t                                                   \
+    ag_atomic_##n##_##op##_explicit(t *p, t v, ag_atomic_order o)           \
+    {                                                                       \
+        return __atomic_##op(p, v, o);                                      \
+    }                                                                       \
+                                                                            \
+    AG__ATOMIC_INLINE__ t                                                   \
+    ag_atomic_##n##_##op(t *p, t v)                                         \
+    {                                                                       \
+        return __atomic_##op(p, v, __ATOMIC_SEQ_CST);                       \
+    }
+
+
+#define AG__ATOMIC_ARITH__(n, t)            \
+    AG__ATOMIC_BASE__(n, t)                 \
+    AG__ATOMIC_FETCH__(n, t, fetch_add)     \
+    AG__ATOMIC_FETCH__(n, t, fetch_sub)     \
+    AG__ATOMIC_FETCH__(n, t, fetch_and)     \
+    AG__ATOMIC_FETCH__(n, t, fetch_or)      \
+    AG__ATOMIC_FETCH__(n, t, fetch_xor)     \
+    AG__ATOMIC_FETCH__(n, t, add_fetch)     \
+    AG__ATOMIC_FETCH__(n, t, sub_fetch)
+
+
+AG__ATOMIC_ARITH__(word, ag_word)
+AG__ATOMIC_ARITH__(word_8, ag_word_8)
+AG__ATOMIC_ARITH__(word_16, ag_word_16)
+AG__ATOMIC_ARITH__(word_32, ag_word_32)
+AG__ATOMIC_ARITH__(word_64, ag_word_64)
+AG__ATOMIC_ARITH__(int, ag_int)
+AG__ATOMIC_ARITH__(int_8, ag_int_8)
+AG__ATOMIC_ARITH__(int_16, ag_int_16)
+AG__ATOMIC_ARITH__(int_32, ag_int_32)
+AG__ATOMIC_ARITH__(int_64, ag_int_64)
+AG__ATOMIC_ARITH__(uint, ag_uint)
+AG__ATOMIC_ARITH__(uint_8, ag_uint_8)
+AG__ATOMIC_ARITH__(uint_16, ag_uint_16)
+AG__ATOMIC_ARITH__(uint_32, ag_uint_32)
+AG__ATOMIC_ARITH__(uint_64, ag_uint_64)
+AG__ATOMIC_ARITH__(size, ag_size)
+AG__ATOMIC_BASE__(bool, ag_bool)
+
+
+/**
+ * Load pointer atomically.
+ *
+ * The @c ag_atomic_ptr_load_explicit() macro atomically loads the pointer held
+ * by the object pointed to by @p p, with the memory ordering @p o. This macro
+ * is type-generic over the type of the pointer loaded.
+ *
+ * @param p Address of pointer to load.
+ * @param o Memory ordering.
+ *
+ * @return Pointer loaded.
+ *
+ * @see ag_atomic_ptr_load()
+ */
+#define ag_atomic_ptr_load_explicit(p, o) __atomic_load_n((p), (o))
+
+
+/**
+ * Store pointer atomically.
+ *
+ * The @c ag_atomic_ptr_store_explicit() macro atomically stores the pointer @p
+ * v in the object pointed to by @p p, with the memory ordering @p o. This
+ * macro is type-generic over the type of the pointer stored.
+ *
+ * @param p Address of pointer to store to.
+ * @param v Pointer to store.
+ * @param o Memory ordering.
+ *
+ * @see ag_atomic_ptr_store()
+ */
+#define ag_atomic_ptr_store_explicit(p, v, o) __atomic_store_n((p), (v), (o))
+
+
+/**
+ * Exchange pointer atomically.
+ *
+ * The @c ag_atomic_ptr_exchange_explicit() macro atomically replaces the
+ * pointer held by the object pointed to by @p p with @p v, with the memory
+ * ordering @p o. This macro is type-generic over the type of the pointer
+ * exchanged.
+ *
+ * @param p Address of pointer to exchange.
+ * @param v Pointer to store.
+ * @param o Memory ordering.
+ *
+ * @return Pointer previously held.
+ *
+ * @see ag_atomic_ptr_exchange()
+ */
+#define ag_atomic_ptr_exchange_explicit(p, v, o) \
+    __atomic_exchange_n((p), (v), (o))
+
+
+/**
+ * Compare and swap pointer atomically.
+ *
+ * The @c ag_atomic_ptr_cas_explicit() macro atomically replaces the pointer
+ * held by the object pointed to by @p p with @p v if it is equal to the
+ * pointer pointed to by @p e, with the memory ordering @p s; otherwise, the
+ * pointer held is written to @p e with the memory ordering @p f. This macro is
+ * type-generic over the type of the pointer swapped.
+ *
+ * @param p Address of pointer to swap.
+ * @param e Address of expected pointer.
+ * @param v Pointer to store.
+ * @param s Memory ordering on success.
+ * @param f Memory ordering on failure.
+ *
+ * @return @c true if the pointer was replaced.
+ *
+ * @see ag_atomic_ptr_cas()
+ * @see ag_atomic_ptr_cas_weak_explicit()
+ */
+#define ag_atomic_ptr_cas_explicit(p, e, v, s, f) \
+    __atomic_compare_exchange_n((p), (e), (v), 0, (s), (f))
+
+
+/**
+ * Compare and swap pointer atomically, allowing spurious failure.
+ *
+ * The @c ag_atomic_ptr_cas_weak_explicit() macro is the same as @c
+ * ag_atomic_ptr_cas_explicit(), except that it may fail even if the pointers
+ * are equal. This allows a more efficient implementation on some processors
+ * when called in a loop.
+ *
+ * @param p Address of pointer to swap.
+ * @param e Address of expected pointer.
+ * @param v Pointer to store.
+ * @param s Memory ordering on success.
+ * @param f Memory ordering on failure.
+ *
+ * @return @c true if the pointer was replaced.
+ *
+ * @see ag_atomic_ptr_cas_weak()
+ * @see ag_atomic_ptr_cas_explicit()
+ */
+#define ag_atomic_ptr_cas_weak_explicit(p, e, v, s, f) \
+    __atomic_compare_exchange_n((p), (e), (v), 1, (s), (f))
+
+
+/**
+ * Load pointer atomically with sequential consistency.
+ *
+ * @see ag_atomic_ptr_load_explicit()
+ */
+#define ag_atomic_ptr_load(p) \
+    ag_atomic_ptr_load_explicit((p), AG_ATOMIC_SEQ_CST)
+
+
+/**
+ * Store pointer atomically with sequential consistency.
+ *
+ * @see ag_atomic_ptr_store_explicit()
+ */
+#define ag_atomic_ptr_store(p, v) \
+    ag_atomic_ptr_store_explicit((p), (v), AG_ATOMIC_SEQ_CST)
+
+
+/**
+ * Exchange pointer atomically with sequential consistency.
+ *
+ * @see ag_atomic_ptr_exchange_explicit()
+ */
+#define ag_atomic_ptr_exchange(p, v) \
+    ag_atomic_ptr_exchange_explicit((p), (v), AG_ATOMIC_SEQ_CST)
+
+
+/**
+ * Compare and swap pointer atomically with sequential consistency.
+ *
+ * @see ag_atomic_ptr_cas_explicit()
+ */
+#define ag_atomic_ptr_cas(p, e, v) \
+    ag_atomic_ptr_cas_explicit((p), (e), (v), AG_ATOMIC_SEQ_CST, \
+            AG_ATOMIC_SEQ_CST)
+
+
+/**
+ * Compare and swap pointer atomically with sequential consistency, allowing
+ * spurious failure.
+ *
+ * @see ag_atomic_ptr_cas_weak_explicit()
+ */
+#define ag_atomic_ptr_cas_weak(p, e, v) \
+    ag_atomic_ptr_cas_weak_explicit((p), (e), (v), AG_ATOMIC_SEQ_CST, \
+            AG_ATOMIC_SEQ_CST)
+
+
+/**
+ * @example atomic.h
+ * This is an example showing how to code against the Argent Core Atomic
+ * Module interface.
+ * @}
+ */
+
+
+#endif /* !defined ARGENT_CORE_ATOMIC */
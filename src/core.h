@@ -569,6 +569,19 @@ typedef double ag_float_64;
 typedef char ag_string;
 
 
+/**
+ * UTF-8 string view.
+ *
+ * The @c ag_string_view type refers to a run of @p len bytes of ag_string data
+ * starting at @p str, without owning it. The data need not be null-terminated,
+ * and remains owned by whichever object provided the view.
+ */
+typedef struct ag_string_view {
+    const ag_string *str;
+    ag_size len;
+} ag_string_view;
+
+
 /**
  * @example type.h
  * This is an example showing how to code against the Argent Core Type Module
@@ -597,10 +610,13 @@ typedef char ag_string;
  * Generic error code.
  *
  * The @c ag_erno type is used to hold error codes. Error codes may be defined
- * by client code as unsigned integers, with the exception of the error codes
- * defined below. This type aligns itself to the native word size of the host
- * environment. Any function returning this type can take advantage of the error
- * handling features provided by this module.
+ * by client code as unsigned integers starting from @c AG_ERNO_CLIENT; the
+ * codes below it are reserved for those defined below. This type aligns itself
+ * to the native word size of the host environment. Any function returning this
+ * type can take advantage of the error handling features provided by this
+ * module.
+ *
+ * @see AG_ERNO_CLIENT
  */
 typedef ag_word ag_erno;
 
@@ -675,6 +691,173 @@ typedef ag_word ag_erno;
 #define AG_ERNO_STRING ((ag_erno) 0x4)
 
 
+/**
+ * Out of memory error.
+ *
+ * The @c AG_ERNO_MEMORY symbolic constant indicates that memory could not be
+ * allocated. This error code is reserved by the Argent Core Library, and
+ * should @b not be redefined by client code.
+ *
+ * @see AG_TRY
+ */
+#define AG_ERNO_MEMORY ((ag_erno) 0x5)
+
+
+/**
+ * System call error.
+ *
+ * The @c AG_ERNO_SYSTEM symbolic constant indicates that a call to the
+ * operating system has failed. The cause of the failure is held by @c errno.
+ * This error code is reserved by the Argent Core Library, and should @b not be
+ * redefined by client code.
+ *
+ * @see AG_TRY
+ */
+#define AG_ERNO_SYSTEM ((ag_erno) 0x6)
+
+
+/**
+ * First client error code.
+ *
+ * The @c AG_ERNO_CLIENT symbolic constant is the lowest error code that is
+ * available to client code. All error codes below this constant are reserved
+ * by the Argent Core Library.
+ *
+ * @see AG_ERNO_CLIENT_LIST
+ */
+#define AG_ERNO_CLIENT ((ag_erno) 0x10)
+
+
+/**
+ * Reserved error code list.
+ *
+ * The @c AG_ERNO_LIST() macro lists the error codes reserved by the Argent Core
+ * Library in ascending order of their values, along with their messages. Each
+ * entry is expanded through @p X, which receives the symbolic constant of the
+ * error code and its message string. This list is used to build the constant
+ * tables looked up by @c ag_erno_name() and @c ag_erno_message().
+ *
+ * @param X Macro to expand for each entry.
+ *
+ * @see AG_ERNO_CLIENT_LIST
+ */
+#define AG_ERNO_LIST(X)                             \
+    X(AG_ERNO_NULL, "no error")                     \
+    X(AG_ERNO_HANDLE, "invalid pointer")            \
+    X(AG_ERNO_STATE, "invalid state")               \
+    X(AG_ERNO_RANGE, "value out of range")          \
+    X(AG_ERNO_STRING, "invalid string")             \
+    X(AG_ERNO_MEMORY, "out of memory")              \
+    X(AG_ERNO_SYSTEM, "system call failed")
+
+
+/**
+ * Client error code list.
+ *
+ * The @c AG_ERNO_CLIENT_LIST() macro may be defined by client code before
+ * including this header to list its own error codes in the same form as @c
+ * AG_ERNO_LIST(). The entries must be listed in ascending order of their
+ * values, with the first being @c AG_ERNO_CLIENT and the rest following
+ * without gaps, so that their names and messages can be looked up in constant
+ * time by @c ag_erno_name() and @c ag_erno_message(); an entry out of place
+ * fails to compile.
+ *
+ * @param X Macro to expand for each entry.
+ *
+ * @see AG_ERNO_CLIENT
+ * @see AG_ERNO_LIST
+ */
+#if !defined AG_ERNO_CLIENT_LIST
+#   define AG_ERNO_CLIENT_LIST(X)
+#endif
+
+
+    /* the lookup tables are indexed by error code, with the reserved and
+     * client codes in separate tables; a trailing null entry keeps the tables
+     * non-empty when there are no client codes */
+#define AG__ERNO_NAME__(c, m) #c,
+#define AG__ERNO_MESSAGE__(c, m) m,
+
+
+    /* the tables are indexed by position, so each entry is checked at compile
+     * time against its position in an enumeration of the lists, with the
+     * client list starting at AG_ERNO_CLIENT */
+#if (defined __cplusplus)
+#   define AG__ERNO_ASSERT__(p, m) static_assert(p, m)
+#else
+#   define AG__ERNO_ASSERT__(p, m) _Static_assert(p, m)
+#endif
+
+#define AG__ERNO_ORDER__(c, m) ag__erno_order_##c##__,
+#define AG__ERNO_CHECK__(c, m)                                              \
+    AG__ERNO_ASSERT__((c) == ag__erno_order_##c##__,                        \
+            #c " is out of order in its error code list");
+
+enum {
+    AG_ERNO_LIST(AG__ERNO_ORDER__)
+    ag__erno_order_client__ = AG_ERNO_CLIENT - 1,
+    AG_ERNO_CLIENT_LIST(AG__ERNO_ORDER__)
+    ag__erno_order_end__
+};
+
+AG_ERNO_LIST(AG__ERNO_CHECK__)
+AG_ERNO_CLIENT_LIST(AG__ERNO_CHECK__)
+
+#define AG__ERNO_LOOKUP__(e, X, unknown)                                    \
+    static const ag_string *const reserved[] = {AG_ERNO_LIST(X) 0};         \
+    static const ag_string *const client[] = {AG_ERNO_CLIENT_LIST(X) 0};    \
+    const ag_size nreserved = sizeof reserved / sizeof *reserved - 1;       \
+    const ag_size nclient = sizeof client / sizeof *client - 1;             \
+                                                                            \
+    if (ag_likely ((e) < nreserved))                                        \
+        return reserved[(e)];                                               \
+    if (ag_likely ((e) >= AG_ERNO_CLIENT && (e) - AG_ERNO_CLIENT < nclient))\
+        return client[(e) - AG_ERNO_CLIENT];                                \
+    return (unknown)
+
+
+/**
+ * Get error code name.
+ *
+ * The @c ag_erno_name() function returns the name of the symbolic constant of
+ * an error code @p e, as listed in @c AG_ERNO_LIST() or @c
+ * AG_ERNO_CLIENT_LIST(). The name is looked up in a constant table indexed by
+ * @p e, so no search takes place.
+ *
+ * @param e Error code to look up.
+ *
+ * @return Name of @p e, or @c "AG_ERNO_UNKNOWN" if @p e is not listed.
+ *
+ * @see ag_erno_message()
+ */
+static inline ag_pure const ag_string *
+ag_erno_name(ag_erno e)
+{
+    AG__ERNO_LOOKUP__(e, AG__ERNO_NAME__, "AG_ERNO_UNKNOWN");
+}
+
+
+/**
+ * Get error code message.
+ *
+ * The @c ag_erno_message() function returns the message describing an error
+ * code @p e, as listed in @c AG_ERNO_LIST() or @c AG_ERNO_CLIENT_LIST(). The
+ * message is looked up in a constant table indexed by @p e, so no search takes
+ * place.
+ *
+ * @param e Error code to look up.
+ *
+ * @return Message for @p e, or @c "unknown error" if @p e is not listed.
+ *
+ * @see ag_erno_name()
+ */
+static inline ag_pure const ag_string *
+ag_erno_message(ag_erno e)
+{
+    AG__ERNO_LOOKUP__(e, AG__ERNO_MESSAGE__, "unknown error");
+}
+
+
 /**
  * Get current error code.
  *
@@ -689,7 +872,7 @@ typedef ag_word ag_erno;
  * @see AG_TRY
  */
 #define ag_erno_get() \
-    ((const ag_erno) ag__erno__)
+    ((ag_erno) ag__erno__)
 
 
 /**
@@ -709,6 +892,15 @@ typedef ag_word ag_erno;
     (ag__erno__ = (e))
 
 
+    /* the register storage class is removed in C++17, so it is only used
+     * when compiling as C */
+#if (defined __cplusplus)
+#   define AG__REGISTER__
+#else
+#   define AG__REGISTER__ register
+#endif
+
+
 /**
  * Start try block.
  *
@@ -729,14 +921,21 @@ typedef ag_word ag_erno;
  * @warning Be sure to include the @c AG_CATCH and @c AG_FINALLY blocks if
  * using @c AG_TRY.
  *
+ * @note When compiling as C++, a jump from an @c ag_try() or @c ag_assert()
+ * macro to the @c AG_CATCH block must not cross the initialisation of a
+ * variable, so variables declared in the try block should be enclosed within
+ * braces.
+ *
  * @see AG_CATCH
  * @see AG_FINALLY
  * @see ag_try()
  * @see ag_assert()
  */
-#define AG_TRY                                  \
-    register ag_erno ag__erno__ = AG_ERNO_NULL; \
-    goto AG__TRY__;                             \
+#define AG_TRY                                        \
+    AG__REGISTER__ ag_erno ag__erno__ = AG_ERNO_NULL; \
+    struct ag_defer_entry ag__defer__[AG_DEFER_MAX];  \
+    AG__REGISTER__ ag_size ag__defer_top__ = 0;       \
+    goto AG__TRY__;                                   \
     AG__TRY__
 
 
@@ -778,16 +977,29 @@ typedef ag_word ag_erno;
  * The @c AG_FINALLY block must be terminated by returning the current error
  * code provided by the @c ag_erno_get() macro defined above.
  *
+ * Any cleanup actions registered through @c ag_defer() in the @c AG_TRY block
+ * are run in reverse order of registration on entry to the @c AG_FINALLY
+ * block, before the code written in the block itself.
+ *
  * @warning At no point should the @c ag_try() and @c ag_assert() family of
  * macros be used in the @c AG_FINALLY block as this could potentially lead to
  * an infinite loop.
  *
  * @see AG_TRY
  * @see AG_CATCH
+ * @see ag_defer()
  * @see ag_try()
  * @see ag_assert()
  */
-#define AG_FINALLY AG__FINALLY__
+#define AG_FINALLY                                          \
+    AG__FINALLY__:                                          \
+    while (ag__defer_top__) {                               \
+        ag__defer_top__--;                                  \
+        ag__defer__[ag__defer_top__].fn                     \
+                (ag__defer__[ag__defer_top__].arg);         \
+    }                                                       \
+    goto AG__FINALLY_BODY__;                                \
+    AG__FINALLY_BODY__
 
 
 /**
@@ -812,12 +1024,13 @@ typedef ag_word ag_erno;
  * @see ag_assert_range()
  * @see ag_assert_string()
  */
-#define ag_assert(p, e)       \
-do {                          \
-    if (ag_unlikely (!(p))) { \
-        ag__erno__ = (e);     \
-        goto AG__CATCH__;     \
-    }                         \
+#define ag_assert(p, e)                      \
+do {                                         \
+    if (ag_unlikely (!(p))) {                \
+        ag__erno__ = (e);                    \
+        AG__ERNO_RAISED__ (ag__erno__);      \
+        goto AG__CATCH__;                    \
+    }                                        \
 } while (0)
 
 
@@ -939,12 +1152,242 @@ do {                          \
  * @see AG_TRY
  * @see ag_assert()
  */
-#define ag_try(p)                       \
-do {                                    \
-    if (ag_unlikely (ag__erno__ = (p))) \
-        goto AG__CATCH__ ;              \
+#define ag_try(p)                             \
+do {                                          \
+    if (ag_unlikely (ag__erno__ = (p))) {     \
+        AG__ERNO_PROPAGATED__ (ag__erno__);   \
+        goto AG__CATCH__;                     \
+    }                                         \
+} while (0)
+
+
+/**
+ * Maximum deferred cleanup actions.
+ *
+ * The @c AG_DEFER_MAX symbolic constant sets the capacity of the fixed-size
+ * stack of cleanup actions that is reserved by each @c AG_TRY block. The stack
+ * lives in the frame of the function, so no heap allocation takes place. The
+ * default capacity may be overridden by defining this constant before
+ * including this header.
+ *
+ * @see ag_defer()
+ */
+#if !defined AG_DEFER_MAX
+#   define AG_DEFER_MAX 8
+#endif
+
+
+/**
+ * Deferred cleanup action.
+ *
+ * The @c ag_defer_fn type is the signature of a cleanup action registered
+ * through @c ag_defer(). The action receives the argument that was passed
+ * along with it when it was registered.
+ *
+ * @see ag_defer()
+ */
+typedef void (*ag_defer_fn)(void *arg);
+
+
+/**
+ * Deferred cleanup entry.
+ *
+ * The @c ag_defer_entry structure holds a single cleanup action along with its
+ * argument on the stack reserved by @c AG_TRY. It is an implementation detail
+ * of @c ag_defer(), and need not be used directly by client code.
+ *
+ * @see ag_defer()
+ */
+struct ag_defer_entry {
+    ag_defer_fn fn;
+    void *arg;
+};
+
+
+/**
+ * Defer cleanup action.
+ *
+ * The @c ag_defer() macro registers a cleanup action @p f to be called with
+ * the argument @p a when control reaches the @c AG_FINALLY block, whether or
+ * not an error has been raised. Registered actions are run in the reverse
+ * order of their registration, so that resources are released in the reverse
+ * order of their acquisition.
+ *
+ * If the stack of cleanup actions is already full, then @p f is called
+ * immediately with @p a so that the resource is not leaked, and @c
+ * AG_ERNO_RANGE is raised in the current context.
+ *
+ * @param f Cleanup action of type @c ag_defer_fn.
+ * @param a Argument to pass to @p f.
+ *
+ * @warning This macro can only be called within an @c AG_TRY block; it should
+ * @b never be called within an @c AG_CATCH or @c AG_FINALLY block as the
+ * action would never be run.
+ *
+ * @see AG_DEFER_MAX
+ * @see AG_FINALLY
+ */
+#define ag_defer(f, a)                                          \
+do {                                                            \
+    if (ag_unlikely (ag__defer_top__ >= AG_DEFER_MAX)) {        \
+        (f) (a);                                                \
+        ag__erno__ = AG_ERNO_RANGE;                             \
+        AG__ERNO_RAISED__ (ag__erno__);                         \
+        goto AG__CATCH__;                                       \
+    }                                                           \
+    ag__defer__[ag__defer_top__].fn = (f);                      \
+    ag__defer__[ag__defer_top__].arg = (a);                     \
+    ag__defer_top__++;                                          \
 } while (0)
 
 
+/**
+ * Number of error codes counted.
+ *
+ * The @c AG_ERNO_STATS_MAX symbolic constant sets the number of distinct error
+ * codes for which error rate counters are maintained when @c AG_ERNO_STATS is
+ * defined. Error codes greater than or equal to @c AG_ERNO_STATS_MAX - 1 are
+ * all counted in the last slot. The default may be overridden by defining this
+ * constant before including this header.
+ *
+ * @see AG_ERNO_STATS_SHARDS
+ * @see ag_erno_stats_snapshot()
+ */
+#if !defined AG_ERNO_STATS_MAX
+#   define AG_ERNO_STATS_MAX 32
+#endif
+
+
+/**
+ * Number of error counter shards.
+ *
+ * The @c AG_ERNO_STATS_SHARDS symbolic constant sets the number of cache line
+ * aligned shards across which the error rate counters are spread when @c
+ * AG_ERNO_STATS is defined. Each thread is assigned a shard on the first error
+ * it raises, in round-robin order, so that threads do not contend on the same
+ * cache line unless there are more threads than shards. The default may be
+ * overridden by defining this constant before including this header.
+ *
+ * @see AG_ERNO_STATS_MAX
+ * @see ag_erno_stats_snapshot()
+ */
+#if !defined AG_ERNO_STATS_SHARDS
+#   define AG_ERNO_STATS_SHARDS 16
+#endif
+
+
+/**
+ * Error rate snapshot.
+ *
+ * The @c ag_erno_stats structure holds the aggregated error counts returned by
+ * @c ag_erno_stats_snapshot(). The @c raised array counts the errors raised at
+ * their point of origin through the @c ag_assert() family of macros and @c
+ * ag_defer(), and the @c propagated array counts the errors passed on from a
+ * callee through @c ag_try(). Both arrays are indexed by error code.
+ *
+ * @see ag_erno_stats_snapshot()
+ */
+struct ag_erno_stats {
+    ag_word raised[AG_ERNO_STATS_MAX];
+    ag_word propagated[AG_ERNO_STATS_MAX];
+};
+
+
+#if defined AG_ERNO_STATS
+    /* each shard is padded to its own cache line; the shards, the shard
+     * assignment counter and the shard of each thread are weak so that every
+     * translation unit including this header shares the same storage */
+    struct ag__erno_shard__ {
+        struct ag_erno_stats stats;
+    } __attribute__((aligned(64)));
+
+    __attribute__((weak)) struct ag__erno_shard__
+    ag__erno_shards__[AG_ERNO_STATS_SHARDS];
+
+    __attribute__((weak)) ag_size ag__erno_shard_next__;
+
+    __attribute__((weak)) __thread ag_size ag__erno_shard_id__;
+
+
+    static inline struct ag_erno_stats *
+    ag__erno_shard__(void)
+    {
+        if (ag_unlikely (!ag__erno_shard_id__)) {
+            ag__erno_shard_id__ = 1 + __atomic_fetch_add(
+                    &ag__erno_shard_next__, 1, __ATOMIC_RELAXED)
+                    % AG_ERNO_STATS_SHARDS;
+        }
+
+        return &ag__erno_shards__[ag__erno_shard_id__ - 1].stats;
+    }
+
+
+    static inline ag_index
+    ag__erno_slot__(ag_erno e)
+    {
+        return e < AG_ERNO_STATS_MAX ? e : AG_ERNO_STATS_MAX - 1;
+    }
+
+
+#   define AG__ERNO_RAISED__(e)                                            \
+        ((void) __atomic_fetch_add(                                         \
+                &ag__erno_shard__ ()->raised[ag__erno_slot__ (e)], 1,       \
+                __ATOMIC_RELAXED))
+
+#   define AG__ERNO_PROPAGATED__(e)                                        \
+        ((void) __atomic_fetch_add(                                         \
+                &ag__erno_shard__ ()->propagated[ag__erno_slot__ (e)], 1,   \
+                __ATOMIC_RELAXED))
+#else
+#   define AG__ERNO_RAISED__(e) ((void) 0)
+#   define AG__ERNO_PROPAGATED__(e) ((void) 0)
+#endif
+
+
+/**
+ * Take snapshot of error rates.
+ *
+ * The @c ag_erno_stats_snapshot() function aggregates the per-shard error
+ * counters into @p s. The counters are read without any locking, so the
+ * snapshot is not an atomic view across all error codes, but each individual
+ * count is exact as of the time it was read. Error rates may be derived by
+ * differencing two snapshots taken at a known interval.
+ *
+ * Error counting is enabled by defining @c AG_ERNO_STATS before including this
+ * header in @b every translation unit. When it is not defined, the @c
+ * ag_assert() and @c ag_try() macros carry no counting overhead, and this
+ * function returns a zeroed snapshot.
+ *
+ * @param s Snapshot to fill.
+ *
+ * @see AG_ERNO_STATS_MAX
+ * @see AG_ERNO_STATS_SHARDS
+ */
+static inline void
+ag_erno_stats_snapshot(struct ag_erno_stats *s)
+{
+    ag_index i, j;
+
+    for (i = 0; i < AG_ERNO_STATS_MAX; i++) {
+        s->raised[i] = 0;
+        s->propagated[i] = 0;
+    }
+
+#if defined AG_ERNO_STATS
+    for (i = 0; i < AG_ERNO_STATS_SHARDS; i++) {
+        for (j = 0; j < AG_ERNO_STATS_MAX; j++) {
+            s->raised[j] += __atomic_load_n(
+                    &ag__erno_shards__[i].stats.raised[j], __ATOMIC_RELAXED);
+            s->propagated[j] += __atomic_load_n(
+                    &ag__erno_shards__[i].stats.propagated[j],
+                    __ATOMIC_RELAXED);
+        }
+    }
+#else
+    (void) j;
+#endif
+}
+
+
 #endif /* !defined ARGENT_CORE */
 
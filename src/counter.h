@@ -0,0 +1,293 @@
+#if !defined ARGENT_CORE_COUNTER
+#define ARGENT_CORE_COUNTER
+
+
+/**************************************************************************//**
+ * @defgroup counter Argent Core Counter Module
+ * Sharded statistics counters.
+ *
+ * The Counter Module provides counters that are split into shards, each on its
+ * own cache line, so that threads incrementing the same counter on different
+ * processors do not contend for a single cache line. Reading a counter sums
+ * its shards, which makes reads more costly than increments; these counters
+ * are therefore suited to statistics that are updated far more often than
+ * they are read.
+ *
+ * Counters are sharded either by processor, through @c sched_getcpu(), which
+ * recent C libraries serve from the restartable sequence area of the calling
+ * thread without a system call; or by thread, in which case each thread is
+ * assigned a shard once in round-robin order. Since a thread may migrate
+ * between processors, and several threads may share a shard, shards are
+ * updated through relaxed atomic additions; these remain cheap as the cache
+ * line of a shard normally stays with a single processor.
+ *
+ * @note This module is specific to Linux, and requires the GNU C dialect or
+ * @c _GNU_SOURCE to be defined.
+ * @{
+ */
+
+
+#include <sched.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "atomic.h"
+
+
+/**
+ * Shard by processor.
+ *
+ * The @c AG_COUNTER_CPU symbolic constant selects counters sharded by the
+ * processor on which the incrementing thread runs.
+ *
+ * @see ag_counter_create()
+ */
+#define AG_COUNTER_CPU 0
+
+
+/**
+ * Shard by thread.
+ *
+ * The @c AG_COUNTER_THREAD symbolic constant selects counters sharded by the
+ * incrementing thread.
+ *
+ * @see ag_counter_create()
+ */
+#define AG_COUNTER_THREAD 1
+
+
+/**
+ * Maximum shards.
+ *
+ * The @c AG_COUNTER_SHARDS symbolic constant sets the largest number of shards
+ * that a counter may be created with. The default may be overridden by
+ * defining this constant before including this header.
+ *
+ * @see ag_counter_create()
+ */
+#if !defined AG_COUNTER_SHARDS
+#   define AG_COUNTER_SHARDS 65536
+#endif
+
+
+struct ag__counter_shard__ {
+    ag_cacheline_aligned ag_int_64 value;
+};
+
+
+/**
+ * Sharded counter.
+ *
+ * The @c ag_counter type is a counter split into cache line aligned shards.
+ * Counters are created through @c ag_counter_create().
+ *
+ * @see ag_counter_create()
+ */
+typedef struct ag_counter {
+    struct ag__counter_shard__ *shards;
+    ag_size mask;
+    int mode;
+} ag_cacheline_aligned ag_counter;
+
+
+    /* the shard index of the current thread, biased by one so that zero marks
+     * an unassigned thread, and the counter from which indices are assigned;
+     * these are weak so that all translation units share them */
+__attribute__((weak)) __thread ag_size ag__counter_self__;
+__attribute__((weak)) ag_size ag__counter_next__;
+
+
+static inline ag_size
+ag__counter_shard__(const ag_counter *c)
+{
+    int cpu;
+
+    if (c->mode == AG_COUNTER_CPU) {
+        cpu = sched_getcpu();
+        if (ag_likely (cpu >= 0))
+            return (ag_size) cpu & c->mask;
+    }
+
+    if (ag_unlikely (!ag__counter_self__))
+        ag__counter_self__ = ag_atomic_size_add_fetch_explicit(
+                &ag__counter_next__, 1, AG_ATOMIC_RELAXED);
+
+    return (ag__counter_self__ - 1) & c->mask;
+}
+
+
+/**
+ * Create counter.
+ *
+ * The @c ag_counter_create() function creates a counter @p c with @p n
+ * shards, rounded up to a power of two, and sharded according to @p mode. If
+ * @p n is zero, then one shard is created for each configured processor. The
+ * counter is initially zero.
+ *
+ * @param c Counter to create.
+ * @param n Number of shards, at most @c AG_COUNTER_SHARDS, or zero.
+ * @param mode @c AG_COUNTER_CPU or @c AG_COUNTER_THREAD.
+ *
+ * @return AG_ERNO_NULL if the counter has been created.
+ * @return AG_ERNO_HANDLE if @p c is a null pointer.
+ * @return AG_ERNO_STATE if @p mode is not valid.
+ * @return AG_ERNO_RANGE if @p n exceeds @c AG_COUNTER_SHARDS.
+ * @return AG_ERNO_MEMORY if the counter could not be allocated.
+ *
+ * @see ag_counter_destroy()
+ */
+static inline ag_erno
+ag_counter_create(ag_counter **c, ag_size n, int mode)
+{
+    ag_counter *ctr;
+    ag_size shards = 1;
+    ag_index i;
+    long cpus;
+
+AG_TRY:
+    ag_assert_handle(c);
+    ag_assert_state(mode == AG_COUNTER_CPU || mode == AG_COUNTER_THREAD);
+
+    ag_assert_range(n <= AG_COUNTER_SHARDS);
+
+    if (!n) {
+        cpus = sysconf(_SC_NPROCESSORS_CONF);
+        n = cpus > 0 ? (ag_size) cpus : 1;
+        if (n > AG_COUNTER_SHARDS)
+            n = AG_COUNTER_SHARDS;
+    }
+
+    while (shards < n)
+        shards <<= 1;
+
+        /* the shards follow the counter in the same allocation */
+    ctr = (ag_counter *) aligned_alloc(AG_CACHELINE_SIZE, sizeof *ctr
+            + shards * sizeof *ctr->shards);
+    ag_assert(ctr, AG_ERNO_MEMORY);
+
+    ctr->shards = (struct ag__counter_shard__ *) (ctr + 1);
+    ctr->mask = shards - 1;
+    ctr->mode = mode;
+    for (i = 0; i < shards; i++)
+        ctr->shards[i].value = 0;
+
+    *c = ctr;
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Destroy counter.
+ *
+ * The @c ag_counter_destroy() function releases a counter @p c.
+ *
+ * @param c Counter to destroy; may be a null pointer.
+ *
+ * @see ag_counter_create()
+ */
+static inline void
+ag_counter_destroy(ag_counter *c)
+{
+    free(c);
+}
+
+
+/**
+ * Add to counter.
+ *
+ * The @c ag_counter_add() function adds @p delta to a counter @p c, updating
+ * only the shard of the calling processor or thread.
+ *
+ * @param c Counter to update.
+ * @param delta Value to add; may be negative.
+ *
+ * @see ag_counter_read()
+ */
+static inline void
+ag_counter_add(ag_counter *c, ag_int_64 delta)
+{
+    (void) ag_atomic_int_64_fetch_add_explicit(
+            &c->shards[ag__counter_shard__(c)].value, delta,
+            AG_ATOMIC_RELAXED);
+}
+
+
+/**
+ * Increment counter.
+ *
+ * The @c ag_counter_inc() function adds one to a counter @p c.
+ *
+ * @param c Counter to update.
+ *
+ * @see ag_counter_add()
+ */
+static inline void
+ag_counter_inc(ag_counter *c)
+{
+    ag_counter_add(c, 1);
+}
+
+
+/**
+ * Read counter.
+ *
+ * The @c ag_counter_read() function sums the shards of a counter @p c. The
+ * sum is not a snapshot, as shards may be updated while they are summed, but
+ * it includes every update that happened before the read began.
+ *
+ * @param c Counter to read.
+ *
+ * @return Value of @p c.
+ *
+ * @see ag_counter_add()
+ */
+static inline ag_int_64
+ag_counter_read(const ag_counter *c)
+{
+    ag_int_64 sum = 0;
+    ag_index i;
+
+    for (i = 0; i <= c->mask; i++)
+        sum += ag_atomic_int_64_load_explicit(&c->shards[i].value,
+                AG_ATOMIC_RELAXED);
+
+    return sum;
+}
+
+
+/**
+ * Reset counter.
+ *
+ * The @c ag_counter_reset() function sets a counter @p c back to zero, and
+ * returns its value before the reset. Updates made concurrently are either
+ * included in the returned value or kept in the counter, and are never lost.
+ *
+ * @param c Counter to reset.
+ *
+ * @return Value of @p c before the reset.
+ */
+static inline ag_int_64
+ag_counter_reset(ag_counter *c)
+{
+    ag_int_64 sum = 0;
+    ag_index i;
+
+    for (i = 0; i <= c->mask; i++)
+        sum += ag_atomic_int_64_exchange_explicit(&c->shards[i].value, 0,
+                AG_ATOMIC_RELAXED);
+
+    return sum;
+}
+
+
+/**
+ * @example counter.h
+ * This is an example showing how to code against the Argent Core Counter
+ * Module interface.
+ * @}
+ */
+
+
+#endif /* !defined ARGENT_CORE_COUNTER */
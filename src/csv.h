@@ -0,0 +1,320 @@
+#if !defined ARGENT_CORE_CSV
+#define ARGENT_CORE_CSV
+
+
+/**************************************************************************//**
+ * @defgroup csv Argent Core CSV Module
+ * Delimited text parser.
+ *
+ * The CSV Module parses comma-separated, tab-separated and similar delimited
+ * text held in memory, such as a file mapped through the Mmap Module. Fields
+ * are yielded as views into the text without being copied, or converted in
+ * batches into columns of integers and floating point numbers.
+ *
+ * The text is classified through the SIMD Module a 64-byte block at a time.
+ * The prefix XOR of the mask of quotes in a block flags the bytes that lie
+ * within quoted fields, with the state at the end of a block carried over to
+ * the next one; delimiters and newlines outside of quoted fields are then the
+ * field separators, which are visited by popping the lowest bit of their mask.
+ * An escaped quote, written as two quotes within a quoted field, toggles the
+ * quoted state twice, and so needs no special treatment.
+ *
+ * Lines may end with either a newline or a carriage return and newline, and
+ * the last line need not end with either.
+ * @{
+ */
+
+
+#include "number.h"
+#include "simd.h"
+
+
+/**
+ * Skipped column.
+ *
+ * The @c AG_CSV_SKIP symbolic constant marks a column that is not loaded.
+ *
+ * @see ag_csv_load()
+ */
+#define AG_CSV_SKIP 0
+
+
+/**
+ * Integer column.
+ *
+ * The @c AG_CSV_INT symbolic constant marks a column that is loaded into an
+ * array of @c ag_int_64 values.
+ *
+ * @see ag_csv_load()
+ */
+#define AG_CSV_INT 1
+
+
+/**
+ * Floating point column.
+ *
+ * The @c AG_CSV_FLOAT symbolic constant marks a column that is loaded into an
+ * array of @c ag_float_64 values.
+ *
+ * @see ag_csv_load()
+ */
+#define AG_CSV_FLOAT 2
+
+
+/**
+ * Delimited text parser.
+ *
+ * The @c ag_csv type holds the state of a parser over delimited text. Parsers
+ * are initialised through @c ag_csv_init(), and hold no resources.
+ *
+ * @see ag_csv_init()
+ */
+typedef struct ag_csv {
+    ag_string_view text;
+    ag_size pos;
+    ag_size scan;
+    ag_size base;
+    ag_simd_mask seps;
+    ag_simd_mask carry;
+    int delim;
+    int quote;
+    ag_bool eol;
+} ag_csv;
+
+
+/**
+ * Initialise parser.
+ *
+ * The @c ag_csv_init() function initialises a parser @p c over the text @p
+ * text, with fields separated by @p delim and optionally quoted by @p quote.
+ * The text must remain valid while the parser and its fields are used.
+ *
+ * @param c Parser to initialise.
+ * @param text Text to parse.
+ * @param delim Field delimiter, such as a comma or tab.
+ * @param quote Quote character, or zero for text without quoted fields.
+ */
+static inline void
+ag_csv_init(ag_csv *c, ag_string_view text, int delim, int quote)
+{
+    c->text = text;
+    c->pos = c->scan = c->base = 0;
+    c->seps = c->carry = 0;
+    c->delim = delim;
+    c->quote = quote;
+    c->eol = true;
+}
+
+
+/**
+ * Get next field.
+ *
+ * The @c ag_csv_field() function yields the next field of a parser @p c. The
+ * quotes around a quoted field are removed, but the escaped quotes within it
+ * are left doubled; @c ag_csv_unescape() collapses them.
+ *
+ * @param c Parser to read from.
+ * @param f View to receive the field.
+ * @param eol Set to @c true if the field is the last of its line; may be a
+ * null pointer.
+ *
+ * @return @c true if a field was read, or @c false at the end of the text.
+ *
+ * @see ag_csv_unescape()
+ */
+static inline ag_bool
+ag_csv_field(ag_csv *c, ag_string_view *f, ag_bool *eol)
+{
+    const ag_string *s = c->text.str;
+    ag_size len = c->text.len, n, end;
+    ag_simd_block b;
+    ag_simd_mask in;
+
+    for (;;) {
+        if (c->seps) {
+            end = c->base + ag_simd_next(&c->seps);
+            break;
+        }
+
+            /* the text ends either right after a line, or with a last field
+             * that has no line ending */
+        if (ag_unlikely (c->scan >= len)) {
+            if (c->pos == len && c->eol)
+                return false;
+
+            end = len;
+            break;
+        }
+
+        n = len - c->scan;
+        if (ag_likely (n >= AG_SIMD_BLOCK))
+            ag_simd_load(&b, s + c->scan);
+        else
+            ag_simd_load_partial(&b, s + c->scan, n, 0);
+
+        in = 0;
+        if (c->quote) {
+            in = ag_simd_prefix_xor(ag_simd_eq(&b, (ag_word_8) c->quote))
+                    ^ c->carry;
+            c->carry = (ag_simd_mask) 0 - (in >> 63);
+        }
+
+        c->seps = (ag_simd_eq(&b, (ag_word_8) c->delim) | ag_simd_eq(&b, '\n'))
+                & ~in;
+        if (n < AG_SIMD_BLOCK)
+            c->seps &= ((ag_simd_mask) 1 << n) - 1;
+
+        c->base = c->scan;
+        c->scan += n < AG_SIMD_BLOCK ? n : AG_SIMD_BLOCK;
+    }
+
+    f->str = s + c->pos;
+    f->len = end - c->pos;
+    c->eol = end == len || s[end] == '\n';
+    c->pos = end < len ? end + 1 : len;
+
+    if (c->eol && f->len && f->str[f->len - 1] == '\r')
+        f->len--;
+
+    if (c->quote && f->len >= 2 && f->str[0] == c->quote
+            && f->str[f->len - 1] == c->quote) {
+        f->str++;
+        f->len -= 2;
+    }
+
+    if (eol)
+        *eol = c->eol;
+
+    return true;
+}
+
+
+/**
+ * Skip rest of line.
+ *
+ * The @c ag_csv_skip() function skips the remaining fields of the current line
+ * of a parser @p c, or the whole of the next line if the previous field ended
+ * a line; this may be used to skip a header line.
+ *
+ * @param c Parser to advance.
+ *
+ * @return @c true if fields were skipped, or @c false at the end of the text.
+ */
+static inline ag_bool
+ag_csv_skip(ag_csv *c)
+{
+    ag_string_view f;
+    ag_bool eol = false;
+
+    while (!eol) {
+        if (!ag_csv_field(c, &f, &eol))
+            return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * Unescape field.
+ *
+ * The @c ag_csv_unescape() function copies a quoted field @p f into @p out,
+ * collapsing each pair of quotes @p quote within it into a single quote.
+ *
+ * @param f Field to unescape.
+ * @param quote Quote character.
+ * @param out Buffer to receive the field, at least as long as @p f.
+ *
+ * @return Length of the unescaped field.
+ */
+static inline ag_size
+ag_csv_unescape(ag_string_view f, int quote, ag_string *out)
+{
+    ag_size i, n = 0;
+
+    for (i = 0; i < f.len; i++) {
+        out[n++] = f.str[i];
+        if (f.str[i] == quote && i + 1 < f.len && f.str[i + 1] == quote)
+            i++;
+    }
+
+    return n;
+}
+
+
+/**
+ * Load columns.
+ *
+ * The @c ag_csv_load() function loads up to @p max lines of a parser @p c
+ * into columns. The @p k-th field of each line is converted according to @p
+ * types[k], and stored into the array @p cols[k]; fields beyond the first @p
+ * ncols, and those marked @c AG_CSV_SKIP, are ignored. This function may be
+ * called repeatedly to load the text in batches.
+ *
+ * If a field cannot be converted, then the rest of its line is skipped, so
+ * that loading may resume with the next line, and the lines loaded before it
+ * are counted in @p n.
+ *
+ * @param c Parser to read from.
+ * @param types Types of the columns.
+ * @param cols Arrays to receive the columns, each with room for @p max values.
+ * @param ncols Number of columns.
+ * @param max Maximum number of lines to load.
+ * @param n Set to the number of lines loaded.
+ *
+ * @return AG_ERNO_NULL if the lines have been loaded.
+ * @return AG_ERNO_HANDLE if @p c, @p types, @p cols or @p n is a null pointer.
+ * @return AG_ERNO_STRING if a field is missing or not a number.
+ * @return AG_ERNO_RANGE if an integer field does not fit in 64 bits.
+ */
+static inline ag_erno
+ag_csv_load(ag_csv *c, const int *types, void *const *cols, ag_size ncols,
+        ag_size max, ag_size *n)
+{
+    ag_string_view f;
+    ag_size rows = 0, k, seen;
+    ag_bool eol = true;
+
+AG_TRY:
+    ag_assert_handle(c && types && cols && n);
+
+    for (; rows < max; rows++) {
+        for (k = 0, seen = 0, eol = false; !eol
+                && ag_csv_field(c, &f, &eol); k++) {
+            if (k < ncols) {
+                seen++;
+                if (types[k] == AG_CSV_INT)
+                    ag_try(ag_number_parse_int(f, (ag_int_64 *) cols[k]
+                            + rows));
+                else if (types[k] == AG_CSV_FLOAT)
+                    ag_try(ag_number_parse_float(f, (ag_float_64 *) cols[k]
+                            + rows));
+            }
+        }
+
+        if (!k)
+            break;
+        ag_assert(seen == ncols, AG_ERNO_STRING);
+    }
+
+AG_CATCH:
+    if (!eol)
+        (void) ag_csv_skip(c);
+
+AG_FINALLY:
+    if (n)
+        *n = rows;
+
+    return ag_erno_get();
+}
+
+
+/**
+ * @example csv.h
+ * This is an example showing how to code against the Argent Core CSV Module
+ * interface.
+ * @}
+ */
+
+
+#endif /* !defined ARGENT_CORE_CSV */
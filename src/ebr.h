@@ -0,0 +1,420 @@
+#if !defined ARGENT_CORE_EBR
+#define ARGENT_CORE_EBR
+
+
+/**************************************************************************//**
+ * @defgroup ebr Argent Core EBR Module
+ * Epoch-based memory reclamation.
+ *
+ * The EBR Module provides epoch-based reclamation of memory shared through
+ * lock-free structures. Readers bracket their accesses to such structures
+ * with a critical section, which costs a store and a fence and never takes a
+ * lock or writes to a shared cache line. Writers unlink objects from a
+ * structure and retire them, and retired objects are freed only once every
+ * thread has left the critical sections that might still reference them.
+ *
+ * Each thread registers with a reclamation domain, and publishes the global
+ * epoch that it observed when entering its critical section. The global epoch
+ * advances once all active threads have observed it, and objects retired two
+ * epochs earlier are then safe to free. Retired objects are held in deferred
+ * lists private to each thread, one per epoch, and are reclaimed in batches.
+ *
+ * @warning A thread that stalls within a critical section prevents the epoch
+ * from advancing, so that retired objects accumulate until it resumes.
+ * Critical sections should therefore be kept short and must not block.
+ * @{
+ */
+
+
+#include <stdlib.h>
+#include "atomic.h"
+
+
+/**
+ * Reclamation batch size.
+ *
+ * The @c AG_EBR_BATCH symbolic constant sets the number of objects that a
+ * thread retires before it attempts to advance the epoch and reclaim its
+ * deferred lists. The default may be overridden by defining this constant
+ * before including this header.
+ *
+ * @see ag_ebr_retire()
+ */
+#if !defined AG_EBR_BATCH
+#   define AG_EBR_BATCH 64
+#endif
+
+
+struct ag_ebr_node;
+
+
+/**
+ * Reclamation callback.
+ *
+ * The @c ag_ebr_free_fn type is the signature of the function called to free
+ * a retired object once it is safe to do so.
+ *
+ * @param node Node embedded in retired object.
+ *
+ * @see ag_ebr_retire()
+ */
+typedef void (*ag_ebr_free_fn)(struct ag_ebr_node *node);
+
+
+/**
+ * Retire node.
+ *
+ * The @c ag_ebr_node type is embedded in objects that are retired through
+ * this module, so that retiring an object does not allocate memory. The
+ * object is recovered from the node by its reclamation callback.
+ *
+ * @see ag_ebr_retire()
+ */
+typedef struct ag_ebr_node {
+    struct ag_ebr_node *next;
+    ag_ebr_free_fn fn;
+} ag_ebr_node;
+
+
+/**
+ * Thread record.
+ *
+ * The @c ag_ebr_thread type is the record of a thread registered with a
+ * reclamation domain, holding its published epoch and its deferred lists. A
+ * record is owned by a single thread at a time.
+ *
+ * @see ag_ebr_register()
+ */
+typedef struct ag_ebr_thread {
+    ag_word epoch;
+    ag_word used;
+    struct ag_ebr_thread *next;
+    struct ag_ebr *domain;
+    ag_size nest;
+    ag_size count;
+    ag_word stamp[3];
+    ag_ebr_node *limbo[3];
+} ag_cacheline_aligned ag_ebr_thread;
+
+
+/**
+ * Reclamation domain.
+ *
+ * The @c ag_ebr type is a reclamation domain, holding the global epoch and
+ * the records of the threads registered with it.
+ *
+ * @see AG_EBR_INIT
+ * @see ag_ebr_register()
+ */
+typedef struct ag_ebr {
+    ag_cacheline_aligned ag_word epoch;
+    ag_cacheline_aligned ag_ebr_thread *threads;
+} ag_ebr;
+
+
+/**
+ * Static domain initialiser.
+ *
+ * The @c AG_EBR_INIT symbolic constant initialises an @c ag_ebr object with
+ * no registered threads.
+ */
+#define AG_EBR_INIT {0, NULL}
+
+
+    /* the published epoch of a thread holds the observed global epoch in its
+     * upper bits, and flags in its lowest bit that the thread is active */
+#define AG__EBR_ACTIVE__ ((ag_word) 1)
+
+
+static inline void
+ag__ebr_free__(ag_ebr_node *n)
+{
+    ag_ebr_node *next;
+
+    while (n) {
+        next = n->next;
+        n->fn(n);
+        n = next;
+    }
+}
+
+
+    /* frees the deferred lists of a thread that were retired at least two
+     * epochs before the global epoch e */
+static inline void
+ag__ebr_reclaim__(ag_ebr_thread *t, ag_word e)
+{
+    ag_ebr_node *n;
+    ag_index i;
+
+    for (i = 0; i < 3; i++) {
+        if (t->limbo[i] && t->stamp[i] + 2 <= e) {
+            n = t->limbo[i];
+            t->limbo[i] = NULL;
+            ag__ebr_free__(n);
+        }
+    }
+}
+
+
+    /* advances the global epoch if all active threads have observed it, and
+     * returns the global epoch as it stands */
+static inline ag_word
+ag__ebr_advance__(ag_ebr *d)
+{
+    ag_ebr_thread *t;
+    ag_word e, local;
+
+    ag_atomic_fence(AG_ATOMIC_SEQ_CST);
+    e = ag_atomic_word_load_explicit(&d->epoch, AG_ATOMIC_ACQUIRE);
+
+    t = (ag_ebr_thread *) ag_atomic_ptr_load_explicit(&d->threads,
+            AG_ATOMIC_ACQUIRE);
+    for (; t; t = t->next) {
+        local = ag_atomic_word_load_explicit(&t->epoch, AG_ATOMIC_ACQUIRE);
+        if ((local & AG__EBR_ACTIVE__) && (local >> 1) != e)
+            return e;
+    }
+
+    if (ag_atomic_word_cas_explicit(&d->epoch, &e, e + 1, AG_ATOMIC_ACQ_REL,
+            AG_ATOMIC_ACQUIRE))
+        return e + 1;
+
+    return e;
+}
+
+
+/**
+ * Register thread.
+ *
+ * The @c ag_ebr_register() function registers the calling thread with a
+ * reclamation domain @p d, reusing the record of a thread that has been
+ * unregistered if there is any, and allocating a new record otherwise.
+ *
+ * @param d Reclamation domain.
+ * @param t Contextual thread record.
+ *
+ * @return AG_ERNO_NULL if the thread has been registered.
+ * @return AG_ERNO_HANDLE if @p d or @p t is a null pointer.
+ * @return AG_ERNO_MEMORY if a new record could not be allocated.
+ *
+ * @see ag_ebr_unregister()
+ */
+static inline ag_erno
+ag_ebr_register(ag_ebr *d, ag_ebr_thread **t)
+{
+    ag_ebr_thread *rec, *head;
+    ag_word expect;
+
+AG_TRY:
+    ag_assert_handle(d && t);
+
+    rec = (ag_ebr_thread *) ag_atomic_ptr_load_explicit(&d->threads,
+            AG_ATOMIC_ACQUIRE);
+    for (; rec; rec = rec->next) {
+        expect = 0;
+        if (!ag_atomic_word_load_explicit(&rec->used, AG_ATOMIC_RELAXED)
+                && ag_atomic_word_cas_explicit(&rec->used, &expect, 1,
+                AG_ATOMIC_ACQUIRE, AG_ATOMIC_RELAXED))
+            break;
+    }
+
+    if (!rec) {
+        rec = (ag_ebr_thread *) aligned_alloc(AG_CACHELINE_SIZE,
+                sizeof *rec);
+        ag_assert(rec, AG_ERNO_MEMORY);
+
+        rec->epoch = 0;
+        rec->used = 1;
+        rec->domain = d;
+        rec->nest = 0;
+        rec->count = 0;
+        rec->stamp[0] = rec->stamp[1] = rec->stamp[2] = 0;
+        rec->limbo[0] = rec->limbo[1] = rec->limbo[2] = NULL;
+
+        head = (ag_ebr_thread *) ag_atomic_ptr_load_explicit(&d->threads,
+                AG_ATOMIC_RELAXED);
+        do {
+            rec->next = head;
+        } while (!ag_atomic_ptr_cas_weak_explicit(&d->threads, &head, rec,
+                AG_ATOMIC_RELEASE, AG_ATOMIC_RELAXED));
+    }
+
+    *t = rec;
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Unregister thread.
+ *
+ * The @c ag_ebr_unregister() function unregisters a thread record @p t, which
+ * must not be within a critical section. Objects retired through @p t that
+ * cannot yet be freed remain on its deferred lists, and are reclaimed by the
+ * next thread to reuse the record, or when the domain is destroyed.
+ *
+ * @param t Thread record.
+ *
+ * @see ag_ebr_register()
+ */
+static inline void
+ag_ebr_unregister(ag_ebr_thread *t)
+{
+    if (ag_likely (t)) {
+        ag__ebr_reclaim__(t, ag__ebr_advance__(t->domain));
+        ag_atomic_word_store_explicit(&t->used, 0, AG_ATOMIC_RELEASE);
+    }
+}
+
+
+/**
+ * Enter critical section.
+ *
+ * The @c ag_ebr_enter() function enters a critical section for a thread
+ * record @p t, within which the objects reachable from the lock-free
+ * structures guarded by its domain are not freed. Critical sections may be
+ * nested, in which case only the outermost one has any effect.
+ *
+ * @param t Thread record.
+ *
+ * @see ag_ebr_exit()
+ */
+static inline void
+ag_ebr_enter(ag_ebr_thread *t)
+{
+    ag_word e;
+
+    if (t->nest++)
+        return;
+
+    e = ag_atomic_word_load_explicit(&t->domain->epoch, AG_ATOMIC_RELAXED);
+    ag_atomic_word_store_explicit(&t->epoch, (e << 1) | AG__EBR_ACTIVE__,
+            AG_ATOMIC_RELAXED);
+
+        /* the published epoch must be visible to reclaimers before any
+         * shared pointer is read within the critical section */
+    ag_atomic_fence(AG_ATOMIC_SEQ_CST);
+}
+
+
+/**
+ * Exit critical section.
+ *
+ * The @c ag_ebr_exit() function exits a critical section for a thread record
+ * @p t entered through @c ag_ebr_enter(). Pointers read within the critical
+ * section must not be dereferenced afterwards.
+ *
+ * @param t Thread record.
+ *
+ * @see ag_ebr_enter()
+ */
+static inline void
+ag_ebr_exit(ag_ebr_thread *t)
+{
+    if (--t->nest)
+        return;
+
+    ag_atomic_word_store_explicit(&t->epoch, 0, AG_ATOMIC_RELEASE);
+}
+
+
+/**
+ * Reclaim retired objects.
+ *
+ * The @c ag_ebr_collect() function attempts to advance the global epoch of the
+ * domain of a thread record @p t, and frees the objects retired through @p t
+ * that are no longer reachable by any thread. This function is called
+ * automatically every @c AG_EBR_BATCH retirements, and need only be called
+ * explicitly to reclaim memory sooner.
+ *
+ * @param t Thread record.
+ *
+ * @see ag_ebr_retire()
+ */
+static inline void
+ag_ebr_collect(ag_ebr_thread *t)
+{
+    t->count = 0;
+    ag__ebr_reclaim__(t, ag__ebr_advance__(t->domain));
+}
+
+
+/**
+ * Retire object.
+ *
+ * The @c ag_ebr_retire() function retires an object that has been unlinked
+ * from a lock-free structure guarded by the domain of a thread record @p t.
+ * The reclamation callback @p fn is called with the node @p n embedded in the
+ * object once no thread can still hold a reference to it.
+ *
+ * @param t Thread record.
+ * @param n Node embedded in retired object.
+ * @param fn Reclamation callback.
+ *
+ * @see ag_ebr_collect()
+ */
+static inline void
+ag_ebr_retire(ag_ebr_thread *t, ag_ebr_node *n, ag_ebr_free_fn fn)
+{
+    ag_word e = ag_atomic_word_load_explicit(&t->domain->epoch,
+            AG_ATOMIC_ACQUIRE);
+    ag_index i = e % 3;
+
+        /* a list stamped with an older epoch than e was retired at least
+         * three epochs ago, and is safe to free before it is reused */
+    if (t->limbo[i] && t->stamp[i] != e) {
+        ag__ebr_free__(t->limbo[i]);
+        t->limbo[i] = NULL;
+    }
+
+    n->fn = fn;
+    n->next = t->limbo[i];
+    t->limbo[i] = n;
+    t->stamp[i] = e;
+
+    if (ag_unlikely (++t->count >= AG_EBR_BATCH))
+        ag_ebr_collect(t);
+}
+
+
+/**
+ * Destroy domain.
+ *
+ * The @c ag_ebr_destroy() function frees all objects retired within a
+ * reclamation domain @p d, along with the records of its threads. No thread
+ * may be registered with @p d when it is destroyed.
+ *
+ * @param d Reclamation domain.
+ */
+static inline void
+ag_ebr_destroy(ag_ebr *d)
+{
+    ag_ebr_thread *t, *next;
+    ag_index i;
+
+    if (ag_unlikely (!d))
+        return;
+
+    for (t = d->threads; t; t = next) {
+        next = t->next;
+        for (i = 0; i < 3; i++)
+            ag__ebr_free__(t->limbo[i]);
+        free(t);
+    }
+
+    d->threads = NULL;
+}
+
+
+/**
+ * @example ebr.h
+ * This is an example showing how to code against the Argent Core EBR Module
+ * interface.
+ * @}
+ */
+
+
+#endif /* !defined ARGENT_CORE_EBR */
@@ -0,0 +1,731 @@
+#if !defined ARGENT_CORE_FIBER
+#define ARGENT_CORE_FIBER
+
+
+/**************************************************************************//**
+ * @defgroup fiber Argent Core Fiber Module
+ * Stackful fibers and cooperative scheduler.
+ *
+ * The Fiber Module provides fibers, which are lightweight threads of execution
+ * with their own stacks that are scheduled cooperatively within a single
+ * operating system thread. A fiber runs until it yields, suspends itself, or
+ * waits for another fiber to finish, at which point the scheduler switches to
+ * the next runnable fiber. Switching between fibers only saves and restores
+ * the callee-saved registers, without entering the kernel, so that tens of
+ * thousands of concurrent sessions may each be given a fiber at a fraction of
+ * the memory and switching cost of a thread.
+ *
+ * Context switches are hand-written for x86-64 and AArch64, and fall back to
+ * the @c ucontext functions of the C library on other architectures, or when
+ * @c AG_FIBER_UCONTEXT is defined. Fiber stacks are mapped with a guard page
+ * below them to catch overflows, and are pooled by their scheduler so that
+ * spawning a fiber does not normally make a system call.
+ *
+ * Fibers are functions returning an @c ag_erno error code, which is reported
+ * as the result of the fiber by @c ag_fiber_join().
+ *
+ * @note This module is specific to Linux, and requires the GNU C dialect or
+ * @c _GNU_SOURCE to be defined.
+ *
+ * @warning A scheduler and its fibers belong to the thread that created the
+ * scheduler, and must not be used from any other thread.
+ * @{
+ */
+
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "core.h"
+
+
+/**
+ * Default stack size.
+ *
+ * The @c AG_FIBER_STACK_SIZE symbolic constant sets the size in bytes of the
+ * stack of a fiber, excluding its guard page, when a scheduler is initialised
+ * with a stack size of zero. The default may be overridden by defining this
+ * constant before including this header.
+ *
+ * @see ag_fiber_sched_init()
+ */
+#if !defined AG_FIBER_STACK_SIZE
+#   define AG_FIBER_STACK_SIZE (64 * 1024)
+#endif
+
+
+/**
+ * Stack pool size.
+ *
+ * The @c AG_FIBER_POOL_MAX symbolic constant sets the maximum number of stacks
+ * of finished fibers that a scheduler keeps for reuse; further stacks are
+ * unmapped. The default may be overridden by defining this constant before
+ * including this header.
+ */
+#if !defined AG_FIBER_POOL_MAX
+#   define AG_FIBER_POOL_MAX 64
+#endif
+
+
+#if !defined AG_FIBER_UCONTEXT && !defined __x86_64__ && !defined __aarch64__
+#   define AG_FIBER_UCONTEXT
+#endif
+
+
+#if defined AG_FIBER_UCONTEXT
+#   include <ucontext.h>
+
+struct ag__fiber_ctx__ {
+    ucontext_t uc;
+};
+#else
+struct ag__fiber_ctx__ {
+    void *sp;
+};
+
+
+    /* the context switch saves the callee-saved registers of the current
+     * context on its stack, stores its stack pointer in *from, and restores
+     * the context whose stack pointer is to; it is defined as a weak symbol so
+     * that every translation unit including this header may define it, and a
+     * new context starts in the entry trampoline, which calls the function in
+     * its second saved register with the argument in its first */
+#   if defined __cplusplus
+extern "C" {
+#   endif
+void ag__fiber_switch__(void **from, void *to);
+void ag__fiber_entry__(void);
+#   if defined __cplusplus
+}
+#   endif
+
+
+#   if defined __x86_64__
+__asm__(
+    ".pushsection .text\n"
+    ".weak ag__fiber_switch__\n"
+    ".hidden ag__fiber_switch__\n"
+    ".type ag__fiber_switch__, @function\n"
+    "ag__fiber_switch__:\n"
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    subq $8, %rsp\n"
+    "    stmxcsr (%rsp)\n"
+    "    fnstcw 4(%rsp)\n"
+    "    movq %rsp, (%rdi)\n"
+    "    movq %rsi, %rsp\n"
+    "    ldmxcsr (%rsp)\n"
+    "    fldcw 4(%rsp)\n"
+    "    addq $8, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    ".size ag__fiber_switch__, .-ag__fiber_switch__\n"
+    ".weak ag__fiber_entry__\n"
+    ".hidden ag__fiber_entry__\n"
+    ".type ag__fiber_entry__, @function\n"
+    "ag__fiber_entry__:\n"
+    "    movq %r12, %rdi\n"
+    "    callq *%r13\n"
+    "    ud2\n"
+    ".size ag__fiber_entry__, .-ag__fiber_entry__\n"
+    ".popsection\n"
+);
+
+
+    /* saved registers of a new context, from its stack pointer upwards */
+#       define AG__FIBER_FRAME__ 8
+#       define AG__FIBER_ARG__ 4
+#       define AG__FIBER_FN__ 3
+#       define AG__FIBER_RET__ 7
+#   elif defined __aarch64__
+__asm__(
+    ".pushsection .text\n"
+    ".weak ag__fiber_switch__\n"
+    ".hidden ag__fiber_switch__\n"
+    ".type ag__fiber_switch__, %function\n"
+    "ag__fiber_switch__:\n"
+    "    sub sp, sp, #160\n"
+    "    stp x19, x20, [sp, #0]\n"
+    "    stp x21, x22, [sp, #16]\n"
+    "    stp x23, x24, [sp, #32]\n"
+    "    stp x25, x26, [sp, #48]\n"
+    "    stp x27, x28, [sp, #64]\n"
+    "    stp x29, x30, [sp, #80]\n"
+    "    stp d8, d9, [sp, #96]\n"
+    "    stp d10, d11, [sp, #112]\n"
+    "    stp d12, d13, [sp, #128]\n"
+    "    stp d14, d15, [sp, #144]\n"
+    "    mov x2, sp\n"
+    "    str x2, [x0]\n"
+    "    mov sp, x1\n"
+    "    ldp x19, x20, [sp, #0]\n"
+    "    ldp x21, x22, [sp, #16]\n"
+    "    ldp x23, x24, [sp, #32]\n"
+    "    ldp x25, x26, [sp, #48]\n"
+    "    ldp x27, x28, [sp, #64]\n"
+    "    ldp x29, x30, [sp, #80]\n"
+    "    ldp d8, d9, [sp, #96]\n"
+    "    ldp d10, d11, [sp, #112]\n"
+    "    ldp d12, d13, [sp, #128]\n"
+    "    ldp d14, d15, [sp, #144]\n"
+    "    add sp, sp, #160\n"
+    "    ret\n"
+    ".size ag__fiber_switch__, .-ag__fiber_switch__\n"
+    ".weak ag__fiber_entry__\n"
+    ".hidden ag__fiber_entry__\n"
+    ".type ag__fiber_entry__, %function\n"
+    "ag__fiber_entry__:\n"
+    "    mov x0, x19\n"
+    "    blr x20\n"
+    "    brk #0\n"
+    ".size ag__fiber_entry__, .-ag__fiber_entry__\n"
+    ".popsection\n"
+);
+
+
+    /* saved registers of a new context, from its stack pointer upwards */
+#       define AG__FIBER_FRAME__ 20
+#       define AG__FIBER_ARG__ 0
+#       define AG__FIBER_FN__ 1
+#       define AG__FIBER_RET__ 11
+#   endif
+#endif
+
+
+/**
+ * Fiber function.
+ *
+ * The @c ag_fiber_fn type is the signature of a function run as a fiber. The
+ * function receives the argument given to @c ag_fiber_spawn(), and its return
+ * value is reported as the result of the fiber by @c ag_fiber_join().
+ *
+ * @see ag_fiber_spawn()
+ */
+typedef ag_erno (*ag_fiber_fn)(void *arg);
+
+
+    /* fiber states */
+#define AG__FIBER_READY__ 0
+#define AG__FIBER_SUSPENDED__ 1
+#define AG__FIBER_DONE__ 2
+
+
+/**
+ * Fiber.
+ *
+ * The @c ag_fiber type is a fiber, which is held at the top of its own stack.
+ * Fibers are spawned through @c ag_fiber_spawn().
+ *
+ * @see ag_fiber_spawn()
+ */
+typedef struct ag_fiber {
+    struct ag__fiber_ctx__ ctx;
+    struct ag_fiber_sched *sched;
+    struct ag_fiber *next;
+    struct ag_fiber *joiner;
+    ag_fiber_fn fn;
+    void *arg;
+    void *stack;
+    ag_erno erno;
+    int state;
+    ag_bool detached;
+} ag_fiber;
+
+
+/**
+ * Fiber scheduler.
+ *
+ * The @c ag_fiber_sched type is a cooperative scheduler, which runs its fibers
+ * in first-in first-out order on the thread that initialised it, and pools
+ * their stacks.
+ *
+ * @see ag_fiber_sched_init()
+ */
+typedef struct ag_fiber_sched {
+    struct ag__fiber_ctx__ ctx;
+    ag_fiber *current;
+    ag_fiber *head;
+    ag_fiber *tail;
+    void *pool;
+    ag_size npool;
+    ag_size size;
+    ag_size page;
+} ag_fiber_sched;
+
+
+    /* the scheduler running on the current thread, if any; this is weak so
+     * that all translation units share it */
+__attribute__((weak)) __thread ag_fiber_sched *ag__fiber_self__;
+
+
+static inline void
+ag__fiber_ready__(ag_fiber_sched *s, ag_fiber *f)
+{
+    f->state = AG__FIBER_READY__;
+    f->next = NULL;
+
+    if (s->tail)
+        s->tail->next = f;
+    else
+        s->head = f;
+    s->tail = f;
+}
+
+
+static inline void
+ag__fiber_swap__(struct ag__fiber_ctx__ *from, struct ag__fiber_ctx__ *to)
+{
+#if defined AG_FIBER_UCONTEXT
+    (void) swapcontext(&from->uc, &to->uc);
+#else
+    ag__fiber_switch__(&from->sp, to->sp);
+#endif
+}
+
+
+    /* runs the function of a fiber, and switches back to its scheduler for
+     * good once it returns */
+static inline void
+ag__fiber_main__(ag_fiber *f)
+{
+    ag_fiber_sched *s = f->sched;
+
+    f->erno = f->fn(f->arg);
+    f->state = AG__FIBER_DONE__;
+
+        /* the joiner may belong to another scheduler of the same thread, and
+         * must be resumed by its own */
+    if (f->joiner)
+        ag__fiber_ready__(f->joiner->sched, f->joiner);
+
+    ag__fiber_swap__(&f->ctx, &s->ctx);
+}
+
+
+#if defined AG_FIBER_UCONTEXT
+static inline void
+ag__fiber_uc_entry__(void)
+{
+    ag__fiber_main__(ag__fiber_self__->current);
+}
+#endif
+
+
+    /* returns the stack of a finished fiber to the pool of its scheduler, or
+     * unmaps it if the pool is full; pooled stacks are linked through their
+     * first word above the guard page */
+static inline void
+ag__fiber_release__(ag_fiber_sched *s, ag_fiber *f)
+{
+    void *stack = f->stack;
+
+    if (s->npool < AG_FIBER_POOL_MAX) {
+        *(void **) ((char *) stack + s->page) = s->pool;
+        s->pool = stack;
+        s->npool++;
+    } else
+        (void) munmap(stack, s->size + s->page);
+}
+
+
+    /* runs the fiber at the head of the run queue until it switches back to
+     * the scheduler */
+static inline void
+ag__fiber_step__(ag_fiber_sched *s)
+{
+    ag_fiber_sched *prev = ag__fiber_self__;
+    ag_fiber *f = s->head;
+
+    s->head = f->next;
+    if (!s->head)
+        s->tail = NULL;
+
+    s->current = f;
+    ag__fiber_self__ = s;
+    ag__fiber_swap__(&s->ctx, &f->ctx);
+    ag__fiber_self__ = prev;
+    s->current = NULL;
+
+    if (f->state == AG__FIBER_DONE__ && f->detached)
+        ag__fiber_release__(s, f);
+}
+
+
+    /* prepares the context of a new fiber, whose stack spans [bottom, top);
+     * this is kept apart from ag_fiber_spawn() as getcontext() returns twice,
+     * which would clobber its local variables */
+static inline ag_bool
+ag__fiber_make__(ag_fiber *f, char *bottom, char *top)
+{
+#if defined AG_FIBER_UCONTEXT
+    if (getcontext(&f->ctx.uc))
+        return false;
+
+    f->ctx.uc.uc_stack.ss_sp = bottom;
+    f->ctx.uc.uc_stack.ss_size = (ag_size) (top - bottom);
+    f->ctx.uc.uc_link = NULL;
+    makecontext(&f->ctx.uc, ag__fiber_uc_entry__, 0);
+#else
+    ag_word *sp = (ag_word *) (top - 16) - AG__FIBER_FRAME__;
+    ag_index i;
+
+        /* the initial frame is laid out as the context switch saves it, so
+         * that the first switch to the fiber returns into the trampoline with
+         * an aligned stack; on x86-64, its first word also holds the default
+         * MXCSR and x87 control word */
+    (void) bottom;
+    for (i = 0; i < AG__FIBER_FRAME__; i++)
+        sp[i] = 0;
+#   if defined __x86_64__
+    sp[0] = ((ag_word) 0x037f << 32) | 0x1f80;
+#   endif
+    sp[AG__FIBER_ARG__] = (ag_word) f;
+    sp[AG__FIBER_FN__] = (ag_word) ag__fiber_main__;
+    sp[AG__FIBER_RET__] = (ag_word) ag__fiber_entry__;
+    f->ctx.sp = sp;
+#endif
+
+    return true;
+}
+
+
+/**
+ * Initialise scheduler.
+ *
+ * The @c ag_fiber_sched_init() function initialises a scheduler @p s, whose
+ * fibers have stacks of @p size bytes, rounded up to a whole number of pages.
+ *
+ * @param s Scheduler to initialise.
+ * @param size Stack size, or zero for @c AG_FIBER_STACK_SIZE.
+ *
+ * @return AG_ERNO_NULL if the scheduler has been initialised.
+ * @return AG_ERNO_HANDLE if @p s is a null pointer.
+ *
+ * @see ag_fiber_sched_destroy()
+ */
+static inline ag_erno
+ag_fiber_sched_init(ag_fiber_sched *s, ag_size size)
+{
+    long page;
+
+AG_TRY:
+    ag_assert_handle(s);
+
+    page = sysconf(_SC_PAGESIZE);
+    s->page = page > 0 ? (ag_size) page : 4096;
+    if (!size)
+        size = AG_FIBER_STACK_SIZE;
+
+    s->size = (size + s->page - 1) / s->page * s->page;
+    s->current = s->head = s->tail = NULL;
+    s->pool = NULL;
+    s->npool = 0;
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Destroy scheduler.
+ *
+ * The @c ag_fiber_sched_destroy() function unmaps the pooled stacks of a
+ * scheduler @p s. All fibers spawned on @p s must have finished, and those
+ * that are joinable must have been joined.
+ *
+ * @param s Scheduler to destroy; may be a null pointer.
+ *
+ * @see ag_fiber_sched_init()
+ */
+static inline void
+ag_fiber_sched_destroy(ag_fiber_sched *s)
+{
+    void *stack;
+
+    if (ag_unlikely (!s))
+        return;
+
+    while ((stack = s->pool)) {
+        s->pool = *(void **) ((char *) stack + s->page);
+        (void) munmap(stack, s->size + s->page);
+    }
+
+    s->npool = 0;
+}
+
+
+/**
+ * Spawn fiber.
+ *
+ * The @c ag_fiber_spawn() function creates a fiber on a scheduler @p s that
+ * runs @p fn with the argument @p arg, and makes it runnable. If @p f is not
+ * a null pointer, then the fiber is joinable and is returned through @p f, so
+ * that it must be joined through @c ag_fiber_join(); otherwise it is detached,
+ * and its resources are reclaimed as soon as it finishes.
+ *
+ * This function may be called both from outside the scheduler and from a
+ * fiber running on it.
+ *
+ * @param s Scheduler to spawn fiber on.
+ * @param f Contextual fiber, or a null pointer to detach it.
+ * @param fn Fiber function.
+ * @param arg Argument passed to @p fn.
+ *
+ * @return AG_ERNO_NULL if the fiber has been spawned.
+ * @return AG_ERNO_HANDLE if @p s or @p fn is a null pointer.
+ * @return AG_ERNO_SYSTEM if a stack could not be mapped.
+ *
+ * @see ag_fiber_join()
+ */
+static inline ag_erno
+ag_fiber_spawn(ag_fiber_sched *s, ag_fiber **f, ag_fiber_fn fn, void *arg)
+{
+    ag_fiber *fib;
+    void *stack = MAP_FAILED;
+    char *top;
+
+AG_TRY:
+    ag_assert_handle(s && fn);
+
+    if (s->pool) {
+        stack = s->pool;
+        s->pool = *(void **) ((char *) stack + s->page);
+        s->npool--;
+    } else {
+        stack = mmap(NULL, s->size + s->page, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+        ag_assert(stack != MAP_FAILED, AG_ERNO_SYSTEM);
+        ag_assert(!mprotect(stack, s->page, PROT_NONE), AG_ERNO_SYSTEM);
+    }
+
+        /* the fiber is held at the top of its stack */
+    top = (char *) stack + s->page + s->size;
+    fib = (ag_fiber *) (((ag_word) (top - sizeof *fib)) & ~(ag_word) 63);
+    top = (char *) ((ag_word) fib & ~(ag_word) 15);
+
+    fib->sched = s;
+    fib->joiner = NULL;
+    fib->fn = fn;
+    fib->arg = arg;
+    fib->stack = stack;
+    fib->erno = AG_ERNO_NULL;
+    fib->detached = !f;
+
+    ag_assert(ag__fiber_make__(fib, (char *) stack + s->page, top),
+            AG_ERNO_SYSTEM);
+
+    ag__fiber_ready__(s, fib);
+    if (f)
+        *f = fib;
+
+AG_CATCH:
+    if (stack != MAP_FAILED)
+        (void) munmap(stack, s->size + s->page);
+
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Get current fiber.
+ *
+ * The @c ag_fiber_self() function gets the fiber running on the calling
+ * thread.
+ *
+ * @return Current fiber, or a null pointer if the calling thread is not
+ * running a fiber.
+ */
+static inline ag_fiber *
+ag_fiber_self(void)
+{
+    return ag__fiber_self__ ? ag__fiber_self__->current : NULL;
+}
+
+
+/**
+ * Yield fiber.
+ *
+ * The @c ag_fiber_yield() function moves the calling fiber to the back of the
+ * run queue of its scheduler, and switches to the next runnable fiber.
+ *
+ * @return AG_ERNO_NULL if the fiber has been resumed.
+ * @return AG_ERNO_STATE if the calling thread is not running a fiber.
+ *
+ * @see ag_fiber_suspend()
+ */
+static inline ag_erno
+ag_fiber_yield(void)
+{
+    ag_fiber *f = ag_fiber_self();
+
+AG_TRY:
+    ag_assert_state(f);
+
+    ag__fiber_ready__(f->sched, f);
+    ag__fiber_swap__(&f->ctx, &f->sched->ctx);
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Suspend fiber.
+ *
+ * The @c ag_fiber_suspend() function suspends the calling fiber until it is
+ * resumed through @c ag_fiber_resume(), and switches to the next runnable
+ * fiber. This is the building block for fibers waiting on external events,
+ * such as I/O readiness.
+ *
+ * @return AG_ERNO_NULL if the fiber has been resumed.
+ * @return AG_ERNO_STATE if the calling thread is not running a fiber.
+ *
+ * @see ag_fiber_resume()
+ */
+static inline ag_erno
+ag_fiber_suspend(void)
+{
+    ag_fiber *f = ag_fiber_self();
+
+AG_TRY:
+    ag_assert_state(f);
+
+    f->state = AG__FIBER_SUSPENDED__;
+    ag__fiber_swap__(&f->ctx, &f->sched->ctx);
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Resume fiber.
+ *
+ * The @c ag_fiber_resume() function makes a fiber @p f that is suspended
+ * through @c ag_fiber_suspend() runnable again. It must be called on the
+ * thread of the scheduler of @p f.
+ *
+ * @param f Fiber to resume.
+ *
+ * @return AG_ERNO_NULL if @p f has been made runnable.
+ * @return AG_ERNO_HANDLE if @p f is a null pointer.
+ * @return AG_ERNO_STATE if @p f is not suspended.
+ *
+ * @see ag_fiber_suspend()
+ */
+static inline ag_erno
+ag_fiber_resume(ag_fiber *f)
+{
+AG_TRY:
+    ag_assert_handle(f);
+    ag_assert_state(f->state == AG__FIBER_SUSPENDED__);
+
+    ag__fiber_ready__(f->sched, f);
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Join fiber.
+ *
+ * The @c ag_fiber_join() function waits until a joinable fiber @p f finishes,
+ * releases it, and returns its result. When called from a fiber, the calling
+ * fiber is suspended until @p f finishes, and is then readied on its own
+ * scheduler, which may differ from that of @p f; otherwise, the scheduler of
+ * @p f is run on the calling thread until @p f finishes.
+ *
+ * @param f Fiber to join.
+ *
+ * @return The error code returned by the function of @p f.
+ * @return AG_ERNO_HANDLE if @p f is a null pointer.
+ * @return AG_ERNO_STATE if @p f is detached, is the calling fiber, or cannot
+ * finish as all fibers of its scheduler are suspended.
+ *
+ * @see ag_fiber_spawn()
+ */
+static inline ag_erno
+ag_fiber_join(ag_fiber *f)
+{
+    ag_fiber *self = ag_fiber_self();
+    ag_fiber_sched *s;
+
+AG_TRY:
+    ag_assert_handle(f);
+    ag_assert_state(!f->detached && f != self && !f->joiner);
+
+    s = f->sched;
+    if (self) {
+        f->joiner = self;
+        while (f->state != AG__FIBER_DONE__) {
+            self->state = AG__FIBER_SUSPENDED__;
+            ag__fiber_swap__(&self->ctx, &self->sched->ctx);
+        }
+    } else {
+        while (f->state != AG__FIBER_DONE__ && s->head)
+            ag__fiber_step__(s);
+        ag_assert_state(f->state == AG__FIBER_DONE__);
+    }
+
+    ag_erno_set(f->erno);
+    ag__fiber_release__(s, f);
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Run scheduler.
+ *
+ * The @c ag_fiber_sched_run() function runs the fibers of a scheduler @p s on
+ * the calling thread until none of them is runnable, either because all have
+ * finished or because the remaining ones are suspended.
+ *
+ * @param s Scheduler to run.
+ *
+ * @return AG_ERNO_NULL if the run queue has been drained.
+ * @return AG_ERNO_HANDLE if @p s is a null pointer.
+ * @return AG_ERNO_STATE if called from a fiber.
+ */
+static inline ag_erno
+ag_fiber_sched_run(ag_fiber_sched *s)
+{
+AG_TRY:
+    ag_assert_handle(s);
+    ag_assert_state(!ag_fiber_self());
+
+    while (s->head)
+        ag__fiber_step__(s);
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * @example fiber.h
+ * This is an example showing how to code against the Argent Core Fiber Module
+ * interface.
+ * @}
+ */
+
+
+#endif /* !defined ARGENT_CORE_FIBER */
@@ -0,0 +1,401 @@
+#if !defined ARGENT_CORE_FUTEX
+#define ARGENT_CORE_FUTEX
+
+
+/**************************************************************************//**
+ * @defgroup futex Argent Core Futex Module
+ * Single-word sleeping locks and wait primitives.
+ *
+ * The Futex Module provides a mutex, a condition variable and an event, each
+ * of which occupies a single 32-bit word, built directly over the Linux futex
+ * system call. Compared to their POSIX threads counterparts, these primitives
+ * are small enough to be embedded in large numbers of objects, and never make
+ * a system call when they are uncontended.
+ *
+ * Each primitive spins briefly before sleeping, since most waits on a short
+ * critical section end within the time it would take to sleep and be woken.
+ * The underlying wait and wake operations are also provided for building other
+ * primitives.
+ *
+ * @note This module is specific to Linux, and requires the GNU C dialect or
+ * @c _GNU_SOURCE to be defined.
+ * @{
+ */
+
+
+#include <limits.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include "atomic.h"
+
+
+/**
+ * Spin count.
+ *
+ * The @c AG_FUTEX_SPIN symbolic constant sets the number of times that the
+ * primitives of this module poll their state before sleeping. The default may
+ * be overridden by defining this constant before including this header.
+ */
+#if !defined AG_FUTEX_SPIN
+#   define AG_FUTEX_SPIN 100
+#endif
+
+
+/**
+ * Wait on futex word.
+ *
+ * The @c ag_futex_wait() function puts the calling thread to sleep on the word
+ * @p addr if it still holds the value @p val, until it is woken through @c
+ * ag_futex_wake(). The thread may also wake spuriously, so the caller must
+ * recheck its condition on return.
+ *
+ * @param addr Futex word.
+ * @param val Value expected at @p addr.
+ *
+ * @see ag_futex_wake()
+ */
+static inline void
+ag_futex_wait(ag_word_32 *addr, ag_word_32 val)
+{
+    (void) syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+}
+
+
+/**
+ * Wake futex waiters.
+ *
+ * The @c ag_futex_wake() function wakes up to @p n threads sleeping on the
+ * word @p addr through @c ag_futex_wait().
+ *
+ * @param addr Futex word.
+ * @param n Maximum number of threads to wake, or @c INT_MAX for all.
+ *
+ * @see ag_futex_wait()
+ */
+static inline void
+ag_futex_wake(ag_word_32 *addr, int n)
+{
+    (void) syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, n, NULL, NULL, 0);
+}
+
+
+/**
+ * Futex mutex.
+ *
+ * The @c ag_mutex type is a mutual exclusion lock held in a single word. The
+ * word holds 0 when the mutex is free, 1 when it is held without waiters, and
+ * 2 when it is held with possible waiters, so that it is only released through
+ * a system call when a thread may be sleeping on it.
+ *
+ * @see AG_MUTEX_INIT
+ * @see ag_mutex_acquire()
+ */
+typedef ag_word_32 ag_mutex;
+
+
+/**
+ * Static mutex initialiser.
+ *
+ * The @c AG_MUTEX_INIT symbolic constant initialises an @c ag_mutex object in
+ * its released state.
+ */
+#define AG_MUTEX_INIT 0
+
+
+/**
+ * Try to acquire mutex.
+ *
+ * The @c ag_mutex_try_acquire() function attempts to acquire a mutex @p m
+ * without waiting.
+ *
+ * @param m Mutex to acquire.
+ *
+ * @return @c true if @p m has been acquired.
+ */
+static inline ag_bool
+ag_mutex_try_acquire(ag_mutex *m)
+{
+    ag_word_32 expect = 0;
+
+    return ag_atomic_word_32_cas_explicit(m, &expect, 1, AG_ATOMIC_ACQUIRE,
+            AG_ATOMIC_RELAXED);
+}
+
+
+/**
+ * Acquire mutex.
+ *
+ * The @c ag_mutex_acquire() function acquires a mutex @p m, spinning briefly
+ * and then sleeping until it is released.
+ *
+ * @param m Mutex to acquire.
+ *
+ * @see ag_mutex_release()
+ */
+static inline void
+ag_mutex_acquire(ag_mutex *m)
+{
+    ag_index i;
+
+    if (ag_likely (ag_mutex_try_acquire(m)))
+        return;
+
+    for (i = 0; i < AG_FUTEX_SPIN; i++) {
+        ag_atomic_pause();
+        if (!ag_atomic_word_32_load_explicit(m, AG_ATOMIC_RELAXED)
+                && ag_mutex_try_acquire(m))
+            return;
+    }
+
+    while (ag_atomic_word_32_exchange_explicit(m, 2, AG_ATOMIC_ACQUIRE))
+        ag_futex_wait(m, 2);
+}
+
+
+/**
+ * Release mutex.
+ *
+ * The @c ag_mutex_release() function releases a mutex @p m that is held by the
+ * calling thread, waking one waiter if there may be any.
+ *
+ * @param m Mutex to release.
+ *
+ * @see ag_mutex_acquire()
+ */
+static inline void
+ag_mutex_release(ag_mutex *m)
+{
+    if (ag_unlikely (ag_atomic_word_32_exchange_explicit(m, 0,
+            AG_ATOMIC_RELEASE) == 2))
+        ag_futex_wake(m, 1);
+}
+
+
+/**
+ * Futex condition variable.
+ *
+ * The @c ag_cond type is a condition variable held in a single word, used
+ * along with an @c ag_mutex. The lower half of the word counts the threads
+ * waiting on the condition variable, and the upper half holds a sequence
+ * number that is advanced on each signal. Signalling a condition variable on
+ * which no thread is waiting does not make a system call.
+ *
+ * @warning At most 65535 threads may wait on a condition variable at once.
+ *
+ * @see AG_COND_INIT
+ * @see ag_cond_wait()
+ */
+typedef ag_word_32 ag_cond;
+
+
+/**
+ * Static condition variable initialiser.
+ *
+ * The @c AG_COND_INIT symbolic constant initialises an @c ag_cond object.
+ */
+#define AG_COND_INIT 0
+
+
+/**
+ * Wait on condition variable.
+ *
+ * The @c ag_cond_wait() function atomically releases a mutex @p m held by the
+ * calling thread and waits on a condition variable @p c, and then reacquires
+ * @p m before returning. As the thread may wake spuriously, the caller must
+ * recheck its condition in a loop.
+ *
+ * @param c Condition variable to wait on.
+ * @param m Mutex held by calling thread.
+ *
+ * @see ag_cond_signal()
+ * @see ag_cond_broadcast()
+ */
+static inline void
+ag_cond_wait(ag_cond *c, ag_mutex *m)
+{
+        /* the thread counts itself as a waiter while it holds the mutex, so
+         * that a signal following a change made under the mutex sees it */
+    ag_word_32 seq = ag_atomic_word_32_add_fetch_explicit(c, 1,
+            AG_ATOMIC_RELAXED);
+
+    ag_mutex_release(m);
+    ag_futex_wait(c, seq);
+    (void) ag_atomic_word_32_fetch_sub_explicit(c, 1, AG_ATOMIC_RELAXED);
+
+        /* other threads may still be waiting, so the mutex is reacquired in
+         * its contended state to make sure that they are woken in turn */
+    while (ag_atomic_word_32_exchange_explicit(m, 2, AG_ATOMIC_ACQUIRE))
+        ag_futex_wait(m, 2);
+}
+
+
+/**
+ * Signal condition variable.
+ *
+ * The @c ag_cond_signal() function wakes one thread waiting on a condition
+ * variable @p c, if any.
+ *
+ * @param c Condition variable to signal.
+ *
+ * @see ag_cond_wait()
+ */
+static inline void
+ag_cond_signal(ag_cond *c)
+{
+    if (ag_atomic_word_32_load_explicit(c, AG_ATOMIC_RELAXED) & 0xffff) {
+        (void) ag_atomic_word_32_fetch_add_explicit(c, 0x10000,
+                AG_ATOMIC_RELEASE);
+        ag_futex_wake(c, 1);
+    }
+}
+
+
+/**
+ * Broadcast condition variable.
+ *
+ * The @c ag_cond_broadcast() function wakes all threads waiting on a condition
+ * variable @p c, if any.
+ *
+ * @param c Condition variable to broadcast.
+ *
+ * @see ag_cond_wait()
+ */
+static inline void
+ag_cond_broadcast(ag_cond *c)
+{
+        /* the sequence is advanced rather than stored, so that it never
+         * moves back over a concurrent signal and lets a waiter sleep through
+         * the broadcast */
+    if (ag_atomic_word_32_load_explicit(c, AG_ATOMIC_RELAXED) & 0xffff) {
+        (void) ag_atomic_word_32_fetch_add_explicit(c, 0x10000,
+                AG_ATOMIC_RELEASE);
+        ag_futex_wake(c, INT_MAX);
+    }
+}
+
+
+/**
+ * Futex event.
+ *
+ * The @c ag_event type is a manual-reset event held in a single word, on which
+ * threads wait until it is set. The word holds 0 when the event is clear, 1
+ * when it is set, and 2 when it is clear with possible waiters, so that it is
+ * only set through a system call when a thread may be sleeping on it.
+ *
+ * @see AG_EVENT_INIT
+ * @see ag_event_wait()
+ */
+typedef ag_word_32 ag_event;
+
+
+/**
+ * Static event initialiser.
+ *
+ * The @c AG_EVENT_INIT symbolic constant initialises an @c ag_event object in
+ * its clear state.
+ */
+#define AG_EVENT_INIT 0
+
+
+/**
+ * Check event.
+ *
+ * The @c ag_event_is_set() function checks whether an event @p e is set,
+ * without waiting.
+ *
+ * @param e Event to check.
+ *
+ * @return @c true if @p e is set.
+ */
+static inline ag_bool
+ag_event_is_set(ag_event *e)
+{
+    return ag_atomic_word_32_load_explicit(e, AG_ATOMIC_ACQUIRE) == 1;
+}
+
+
+/**
+ * Wait for event.
+ *
+ * The @c ag_event_wait() function waits until an event @p e is set, spinning
+ * briefly before sleeping.
+ *
+ * @param e Event to wait for.
+ *
+ * @see ag_event_set()
+ */
+static inline void
+ag_event_wait(ag_event *e)
+{
+    ag_word_32 v;
+    ag_index i;
+
+    for (i = 0; i < AG_FUTEX_SPIN; i++) {
+        if (ag_likely (ag_event_is_set(e)))
+            return;
+        ag_atomic_pause();
+    }
+
+    for (;;) {
+        v = ag_atomic_word_32_load_explicit(e, AG_ATOMIC_ACQUIRE);
+        if (v == 1)
+            return;
+
+        if (v == 2 || ag_atomic_word_32_cas_explicit(e, &v, 2,
+                AG_ATOMIC_ACQUIRE, AG_ATOMIC_ACQUIRE))
+            ag_futex_wait(e, 2);
+    }
+}
+
+
+/**
+ * Set event.
+ *
+ * The @c ag_event_set() function sets an event @p e, waking all threads
+ * waiting on it.
+ *
+ * @param e Event to set.
+ *
+ * @see ag_event_wait()
+ * @see ag_event_reset()
+ */
+static inline void
+ag_event_set(ag_event *e)
+{
+    if (ag_unlikely (ag_atomic_word_32_exchange_explicit(e, 1,
+            AG_ATOMIC_RELEASE) == 2))
+        ag_futex_wake(e, INT_MAX);
+}
+
+
+/**
+ * Reset event.
+ *
+ * The @c ag_event_reset() function clears an event @p e if it is set; an event
+ * that is already clear is left as it is, along with any threads waiting on
+ * it.
+ *
+ * @param e Event to reset.
+ *
+ * @see ag_event_set()
+ */
+static inline void
+ag_event_reset(ag_event *e)
+{
+    ag_word_32 expect = 1;
+
+    (void) ag_atomic_word_32_cas_explicit(e, &expect, 0, AG_ATOMIC_RELAXED,
+            AG_ATOMIC_RELAXED);
+}
+
+
+/**
+ * @example futex.h
+ * This is an example showing how to code against the Argent Core Futex Module
+ * interface.
+ * @}
+ */
+
+
+#endif /* !defined ARGENT_CORE_FUTEX */
@@ -0,0 +1,501 @@
+#if !defined ARGENT_CORE_HAZARD
+#define ARGENT_CORE_HAZARD
+
+
+/**************************************************************************//**
+ * @defgroup hazard Argent Core Hazard Module
+ * Hazard-pointer memory reclamation.
+ *
+ * The Hazard Module provides reclamation of memory shared through lock-free
+ * structures by means of hazard pointers. Before dereferencing a shared
+ * pointer, a reader publishes it in one of the hazard slots of its thread
+ * record, and a retired object is only freed once it is no longer published
+ * by any thread.
+ *
+ * Unlike epoch-based reclamation through the EBR Module, a thread that stalls
+ * only prevents the objects that it has actually published from being freed,
+ * so that the number of retired objects awaiting reclamation remains bounded
+ * regardless of the progress of other threads. This comes at the cost of a
+ * fence for each pointer protected by a reader.
+ *
+ * Retired objects are held in a list private to each thread, which is scanned
+ * against a sorted snapshot of all hazard slots once it grows past a threshold
+ * proportional to the number of slots, so that each scan frees at least as
+ * many objects as there are slots and the cost of reclamation is constant per
+ * retired object.
+ * @{
+ */
+
+
+#include <stdlib.h>
+#include "atomic.h"
+
+
+/**
+ * Slots per thread.
+ *
+ * The @c AG_HAZARD_SLOTS symbolic constant sets the number of hazard slots in
+ * each thread record, which is the number of pointers that a thread may
+ * protect at once. The default may be overridden by defining this constant
+ * before including this header.
+ */
+#if !defined AG_HAZARD_SLOTS
+#   define AG_HAZARD_SLOTS 4
+#endif
+
+
+/**
+ * Scan threshold.
+ *
+ * The @c AG_HAZARD_SCAN symbolic constant sets the number of retired objects
+ * held by a thread, in addition to twice the total number of hazard slots in
+ * its domain, beyond which the thread scans the hazard slots and frees the
+ * objects that are not protected. The default may be overridden by defining
+ * this constant before including this header.
+ *
+ * @see ag_hazard_retire()
+ */
+#if !defined AG_HAZARD_SCAN
+#   define AG_HAZARD_SCAN 64
+#endif
+
+
+struct ag_hazard_node;
+
+
+/**
+ * Reclamation callback.
+ *
+ * The @c ag_hazard_free_fn type is the signature of the function called to
+ * free a retired object once it is safe to do so.
+ *
+ * @param node Node embedded in retired object.
+ *
+ * @see ag_hazard_retire()
+ */
+typedef void (*ag_hazard_free_fn)(struct ag_hazard_node *node);
+
+
+/**
+ * Retire node.
+ *
+ * The @c ag_hazard_node type is embedded in objects that are retired through
+ * this module, so that retiring an object does not allocate memory. The node
+ * records the address under which the object is protected, along with its
+ * reclamation callback.
+ *
+ * @see ag_hazard_retire()
+ */
+typedef struct ag_hazard_node {
+    struct ag_hazard_node *next;
+    const void *ptr;
+    ag_hazard_free_fn fn;
+} ag_hazard_node;
+
+
+/**
+ * Thread record.
+ *
+ * The @c ag_hazard_thread type is the record of a thread registered with a
+ * hazard domain, holding its hazard slots and its retired objects. A record
+ * is owned by a single thread at a time.
+ *
+ * @see ag_hazard_register()
+ */
+typedef struct ag_hazard_thread {
+    void *slots[AG_HAZARD_SLOTS];
+    ag_cacheline_aligned ag_word used;
+    struct ag_hazard_thread *next;
+    struct ag_hazard *domain;
+    ag_hazard_node *retired;
+    ag_size count;
+    const void **snap;
+    ag_size cap;
+} ag_cacheline_aligned ag_hazard_thread;
+
+
+/**
+ * Hazard domain.
+ *
+ * The @c ag_hazard type is a hazard domain, holding the records of the
+ * threads registered with it.
+ *
+ * @see AG_HAZARD_INIT
+ * @see ag_hazard_register()
+ */
+typedef struct ag_hazard {
+    ag_hazard_thread *threads;
+    ag_size nthreads;
+} ag_hazard;
+
+
+/**
+ * Static domain initialiser.
+ *
+ * The @c AG_HAZARD_INIT symbolic constant initialises an @c ag_hazard object
+ * with no registered threads.
+ */
+#define AG_HAZARD_INIT {NULL, 0}
+
+
+static inline int
+ag__hazard_cmp__(const void *a, const void *b)
+{
+    const char *x = *(const char * const *) a;
+    const char *y = *(const char * const *) b;
+
+    return (x > y) - (x < y);
+}
+
+
+    /* checks whether a pointer is published in any slot of a domain; this is
+     * only used if a snapshot of the slots could not be allocated */
+static inline ag_bool
+ag__hazard_held__(ag_hazard *d, const void *p)
+{
+    ag_hazard_thread *t;
+    ag_index i;
+
+    t = (ag_hazard_thread *) ag_atomic_ptr_load_explicit(&d->threads,
+            AG_ATOMIC_ACQUIRE);
+    for (; t; t = t->next) {
+        for (i = 0; i < AG_HAZARD_SLOTS; i++) {
+            if (ag_atomic_ptr_load_explicit(&t->slots[i], AG_ATOMIC_ACQUIRE)
+                    == p)
+                return true;
+        }
+    }
+
+    return false;
+}
+
+
+    /* grows the snapshot buffer of a thread record to hold at least the
+     * given number of pointers */
+static inline ag_bool
+ag__hazard_reserve__(ag_hazard_thread *t, ag_size need)
+{
+    const void **snap;
+
+    if (need > t->cap) {
+        snap = (const void **) realloc((void *) t->snap, need * sizeof *snap);
+        if (!snap)
+            return false;
+
+        t->snap = snap;
+        t->cap = need;
+    }
+
+    return true;
+}
+
+
+    /* takes a sorted snapshot of the slots of a domain into the buffer of a
+     * thread record, returning the number of published pointers, or -1 if
+     * the buffer could not be grown */
+static inline long
+ag__hazard_snapshot__(ag_hazard_thread *t)
+{
+    ag_hazard *d = t->domain;
+    ag_hazard_thread *r;
+    ag_size n = 0;
+    void *p;
+    ag_index i;
+
+        /* the head is loaded before the thread count, which is raised before
+         * a record is published, so that the count covers every record the
+         * walk reaches; the buffer still grows rather than truncating the
+         * snapshot should it ever fall short */
+    r = (ag_hazard_thread *) ag_atomic_ptr_load_explicit(&d->threads,
+            AG_ATOMIC_ACQUIRE);
+    if (!ag__hazard_reserve__(t, ag_atomic_size_load_explicit(&d->nthreads,
+            AG_ATOMIC_ACQUIRE) * AG_HAZARD_SLOTS))
+        return -1;
+
+    for (; r; r = r->next) {
+        for (i = 0; i < AG_HAZARD_SLOTS; i++) {
+            p = ag_atomic_ptr_load_explicit(&r->slots[i], AG_ATOMIC_ACQUIRE);
+            if (!p)
+                continue;
+
+            if (ag_unlikely (n == t->cap)
+                    && !ag__hazard_reserve__(t, t->cap * 2 + AG_HAZARD_SLOTS))
+                return -1;
+            t->snap[n++] = p;
+        }
+    }
+
+    qsort((void *) t->snap, n, sizeof *t->snap, ag__hazard_cmp__);
+    return (long) n;
+}
+
+
+/**
+ * Register thread.
+ *
+ * The @c ag_hazard_register() function registers the calling thread with a
+ * hazard domain @p d, reusing the record of a thread that has been
+ * unregistered if there is any, and allocating a new record otherwise. All
+ * hazard slots of the record are initially clear.
+ *
+ * @param d Hazard domain.
+ * @param t Contextual thread record.
+ *
+ * @return AG_ERNO_NULL if the thread has been registered.
+ * @return AG_ERNO_HANDLE if @p d or @p t is a null pointer.
+ * @return AG_ERNO_MEMORY if a new record could not be allocated.
+ *
+ * @see ag_hazard_unregister()
+ */
+static inline ag_erno
+ag_hazard_register(ag_hazard *d, ag_hazard_thread **t)
+{
+    ag_hazard_thread *rec, *head;
+    ag_word expect;
+    ag_index i;
+
+AG_TRY:
+    ag_assert_handle(d && t);
+
+    rec = (ag_hazard_thread *) ag_atomic_ptr_load_explicit(&d->threads,
+            AG_ATOMIC_ACQUIRE);
+    for (; rec; rec = rec->next) {
+        expect = 0;
+        if (!ag_atomic_word_load_explicit(&rec->used, AG_ATOMIC_RELAXED)
+                && ag_atomic_word_cas_explicit(&rec->used, &expect, 1,
+                AG_ATOMIC_ACQUIRE, AG_ATOMIC_RELAXED))
+            break;
+    }
+
+    if (!rec) {
+        rec = (ag_hazard_thread *) aligned_alloc(AG_CACHELINE_SIZE,
+                sizeof *rec);
+        ag_assert(rec, AG_ERNO_MEMORY);
+
+        for (i = 0; i < AG_HAZARD_SLOTS; i++)
+            rec->slots[i] = NULL;
+        rec->used = 1;
+        rec->domain = d;
+        rec->retired = NULL;
+        rec->count = 0;
+        rec->snap = NULL;
+        rec->cap = 0;
+
+            /* the thread count is raised before the record is published, so
+             * that a snapshot which loads the list head before the count
+             * never has fewer entries than published slots */
+        (void) ag_atomic_size_fetch_add_explicit(&d->nthreads, 1,
+                AG_ATOMIC_RELEASE);
+
+        head = (ag_hazard_thread *) ag_atomic_ptr_load_explicit(&d->threads,
+                AG_ATOMIC_RELAXED);
+        do {
+            rec->next = head;
+        } while (!ag_atomic_ptr_cas_weak_explicit(&d->threads, &head, rec,
+                AG_ATOMIC_RELEASE, AG_ATOMIC_RELAXED));
+    }
+
+    *t = rec;
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Protect pointer.
+ *
+ * The @c ag_hazard_protect() function loads the shared pointer at @p src and
+ * publishes it in the hazard slot @p slot of a thread record @p t, retrying
+ * until the published pointer is still the one held at @p src. The object
+ * that it points to then remains valid until the slot is cleared or reused,
+ * even if it is retired in the meantime.
+ *
+ * @param t Thread record.
+ * @param slot Hazard slot, less than @c AG_HAZARD_SLOTS.
+ * @param src Shared pointer to protect.
+ *
+ * @return The protected pointer, which may be null.
+ *
+ * @see ag_hazard_clear()
+ */
+static inline void *
+ag_hazard_protect(ag_hazard_thread *t, ag_index slot, void **src)
+{
+    void *p, *q = ag_atomic_ptr_load_explicit(src, AG_ATOMIC_RELAXED);
+
+    do {
+        p = q;
+        ag_atomic_ptr_store_explicit(&t->slots[slot], p, AG_ATOMIC_RELAXED);
+
+            /* the slot must be visible to reclaimers before the shared
+             * pointer is validated */
+        ag_atomic_fence(AG_ATOMIC_SEQ_CST);
+        q = ag_atomic_ptr_load_explicit(src, AG_ATOMIC_ACQUIRE);
+    } while (ag_unlikely (p != q));
+
+    return p;
+}
+
+
+/**
+ * Clear hazard slot.
+ *
+ * The @c ag_hazard_clear() function clears the hazard slot @p slot of a thread
+ * record @p t, after which the object that it protected may be freed.
+ *
+ * @param t Thread record.
+ * @param slot Hazard slot, less than @c AG_HAZARD_SLOTS.
+ *
+ * @see ag_hazard_protect()
+ */
+static inline void
+ag_hazard_clear(ag_hazard_thread *t, ag_index slot)
+{
+    ag_atomic_ptr_store_explicit(&t->slots[slot], NULL, AG_ATOMIC_RELEASE);
+}
+
+
+/**
+ * Reclaim retired objects.
+ *
+ * The @c ag_hazard_collect() function scans the hazard slots of the domain of
+ * a thread record @p t, and frees the objects retired through @p t that are
+ * not protected by any thread. This function is called automatically once
+ * enough objects have been retired, and need only be called explicitly to
+ * reclaim memory sooner.
+ *
+ * @param t Thread record.
+ *
+ * @see ag_hazard_retire()
+ */
+static inline void
+ag_hazard_collect(ag_hazard_thread *t)
+{
+    ag_hazard_node *n, *next, *keep = NULL;
+    ag_size count = 0;
+    long snap;
+
+    ag_atomic_fence(AG_ATOMIC_SEQ_CST);
+    snap = ag__hazard_snapshot__(t);
+
+    for (n = t->retired; n; n = next) {
+        next = n->next;
+
+        if (snap < 0 ? ag__hazard_held__(t->domain, n->ptr)
+                : !!bsearch((const void *) &n->ptr, (const void *) t->snap,
+                (ag_size) snap, sizeof *t->snap, ag__hazard_cmp__)) {
+            n->next = keep;
+            keep = n;
+            count++;
+        } else
+            n->fn(n);
+    }
+
+    t->retired = keep;
+    t->count = count;
+}
+
+
+/**
+ * Retire object.
+ *
+ * The @c ag_hazard_retire() function retires an object at @p p that has been
+ * unlinked from a lock-free structure guarded by the domain of a thread record
+ * @p t. The reclamation callback @p fn is called with the node @p n embedded
+ * in the object once @p p is no longer protected by any thread.
+ *
+ * @param t Thread record.
+ * @param p Address under which object is protected.
+ * @param n Node embedded in retired object.
+ * @param fn Reclamation callback.
+ *
+ * @see ag_hazard_collect()
+ */
+static inline void
+ag_hazard_retire(ag_hazard_thread *t, const void *p, ag_hazard_node *n,
+        ag_hazard_free_fn fn)
+{
+    n->ptr = p;
+    n->fn = fn;
+    n->next = t->retired;
+    t->retired = n;
+
+    if (ag_unlikely (++t->count >= AG_HAZARD_SCAN + 2 * AG_HAZARD_SLOTS
+            * ag_atomic_size_load_explicit(&t->domain->nthreads,
+            AG_ATOMIC_RELAXED)))
+        ag_hazard_collect(t);
+}
+
+
+/**
+ * Unregister thread.
+ *
+ * The @c ag_hazard_unregister() function clears the hazard slots of a thread
+ * record @p t and unregisters it. Objects retired through @p t that are still
+ * protected remain on its list, and are reclaimed by the next thread to reuse
+ * the record, or when the domain is destroyed.
+ *
+ * @param t Thread record.
+ *
+ * @see ag_hazard_register()
+ */
+static inline void
+ag_hazard_unregister(ag_hazard_thread *t)
+{
+    ag_index i;
+
+    if (ag_likely (t)) {
+        for (i = 0; i < AG_HAZARD_SLOTS; i++)
+            ag_hazard_clear(t, i);
+
+        ag_hazard_collect(t);
+        ag_atomic_word_store_explicit(&t->used, 0, AG_ATOMIC_RELEASE);
+    }
+}
+
+
+/**
+ * Destroy domain.
+ *
+ * The @c ag_hazard_destroy() function frees all objects retired within a
+ * hazard domain @p d, along with the records of its threads. No thread may be
+ * registered with @p d when it is destroyed.
+ *
+ * @param d Hazard domain.
+ */
+static inline void
+ag_hazard_destroy(ag_hazard *d)
+{
+    ag_hazard_thread *t, *next;
+    ag_hazard_node *n, *nn;
+
+    if (ag_unlikely (!d))
+        return;
+
+    for (t = d->threads; t; t = next) {
+        next = t->next;
+        for (n = t->retired; n; n = nn) {
+            nn = n->next;
+            n->fn(n);
+        }
+
+        free((void *) t->snap);
+        free(t);
+    }
+
+    d->threads = NULL;
+    d->nthreads = 0;
+}
+
+
+/**
+ * @example hazard.h
+ * This is an example showing how to code against the Argent Core Hazard
+ * Module interface.
+ * @}
+ */
+
+
+#endif /* !defined ARGENT_CORE_HAZARD */
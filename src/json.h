@@ -0,0 +1,1506 @@
+#if !defined ARGENT_CORE_JSON
+#define ARGENT_CORE_JSON
+
+
+/**************************************************************************//**
+ * @defgroup json Argent Core JSON Module
+ * On-demand JSON parser and writer.
+ *
+ * The JSON Module parses JSON text in two stages. The first stage classifies
+ * the text through the SIMD Module a 64-byte block at a time, and records the
+ * offset of every structural character, that is every bracket, brace, colon
+ * and comma outside of strings, along with the start of every scalar value.
+ * Strings are delimited by the prefix XOR of the mask of unescaped quotes, and
+ * escaped quotes are found by locating odd-length runs of backslashes with a
+ * carry-propagating addition. This stage also checks that strings are closed
+ * and free of control characters, and that brackets are balanced.
+ *
+ * The second stage navigates the index lazily: values are only examined when
+ * they are accessed, and values that are not accessed are skipped by walking
+ * the index without looking at their contents. Strings are yielded as views
+ * into the text, and numbers and literals are converted on access, so that no
+ * tree of values is ever built; the index itself is the only representation
+ * of the document, and is reused by successive documents.
+ *
+ * Strings are yielded in their raw form, with escape sequences left in place,
+ * as most strings have none; @c ag_json_unescape() decodes them when needed.
+ * Likewise, object keys are matched against their raw form.
+ *
+ * The module also writes JSON text into a growable buffer. Strings are
+ * escaped a block at a time: a single mask flags the quotes, backslashes and
+ * control characters of a block, and the runs between them are copied whole.
+ * Numbers are formatted through the Number Module directly into the buffer.
+ * Commas are inserted automatically between values, but the writer otherwise
+ * trusts its caller to nest containers and keys correctly.
+ *
+ * @warning Since values are only examined as they are accessed, a malformed
+ * document may only be reported as such when its malformed part is reached.
+ * @{
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include "number.h"
+#include "simd.h"
+
+
+/**
+ * Maximum nesting depth.
+ *
+ * The @c AG_JSON_DEPTH symbolic constant sets the deepest nesting of arrays
+ * and objects that a document may have. The default may be overridden by
+ * defining this constant before including this header.
+ *
+ * @see ag_json_parse()
+ */
+#if !defined AG_JSON_DEPTH
+#   define AG_JSON_DEPTH 1024
+#endif
+
+
+/**
+ * Invalid value.
+ *
+ * The @c AG_JSON_INVALID symbolic constant is the type of a value that does
+ * not start like any JSON value.
+ *
+ * @see ag_json_type()
+ */
+#define AG_JSON_INVALID 0
+
+
+/**
+ * Null value.
+ *
+ * The @c AG_JSON_NULL symbolic constant is the type of the null literal.
+ *
+ * @see ag_json_type()
+ */
+#define AG_JSON_NULL 1
+
+
+/**
+ * Boolean value.
+ *
+ * The @c AG_JSON_BOOL symbolic constant is the type of the true and false
+ * literals.
+ *
+ * @see ag_json_type()
+ */
+#define AG_JSON_BOOL 2
+
+
+/**
+ * Number value.
+ *
+ * The @c AG_JSON_NUMBER symbolic constant is the type of numbers.
+ *
+ * @see ag_json_type()
+ */
+#define AG_JSON_NUMBER 3
+
+
+/**
+ * String value.
+ *
+ * The @c AG_JSON_STRING symbolic constant is the type of strings.
+ *
+ * @see ag_json_type()
+ */
+#define AG_JSON_STRING 4
+
+
+/**
+ * Array value.
+ *
+ * The @c AG_JSON_ARRAY symbolic constant is the type of arrays.
+ *
+ * @see ag_json_type()
+ */
+#define AG_JSON_ARRAY 5
+
+
+/**
+ * Object value.
+ *
+ * The @c AG_JSON_OBJECT symbolic constant is the type of objects.
+ *
+ * @see ag_json_type()
+ */
+#define AG_JSON_OBJECT 6
+
+
+/**
+ * JSON parser.
+ *
+ * The @c ag_json type holds the structural index of the last document parsed
+ * through it. Parsers are created through @c ag_json_create().
+ *
+ * @see ag_json_create()
+ */
+typedef struct ag_json {
+    ag_string_view text;
+    ag_word_32 *index;
+    ag_size n;
+    ag_size cap;
+} ag_json;
+
+
+/**
+ * JSON value.
+ *
+ * The @c ag_json_value type refers to a value within the last document parsed
+ * by a parser, and remains valid until the parser parses another document.
+ *
+ * @see ag_json_parse()
+ */
+typedef struct ag_json_value {
+    const ag_json *json;
+    ag_size at;
+} ag_json_value;
+
+
+/**
+ * JSON iterator.
+ *
+ * The @c ag_json_iter type iterates over the elements of an array, or the
+ * fields of an object.
+ *
+ * @see ag_json_iter_init()
+ */
+typedef struct ag_json_iter {
+    const ag_json *json;
+    ag_size at;
+    ag_erno erno;
+    ag_bool object;
+    ag_bool first;
+} ag_json_iter;
+
+
+    /* gets the character at an index entry */
+static inline char
+ag__json_char__(const ag_json *j, ag_size at)
+{
+    return j->text.str[j->index[at]];
+}
+
+
+    /* gets the text of a scalar token, which extends up to the next index
+     * entry, less any whitespace before it */
+static inline ag_string_view
+ag__json_token__(const ag_json *j, ag_size at)
+{
+    ag_string_view t;
+    ag_size end = at + 1 < j->n ? j->index[at + 1] : j->text.len;
+
+    t.str = j->text.str + j->index[at];
+    t.len = end - j->index[at];
+    while (t.len && (t.str[t.len - 1] == ' ' || t.str[t.len - 1] == '\t'
+            || t.str[t.len - 1] == '\n' || t.str[t.len - 1] == '\r'))
+        t.len--;
+
+    return t;
+}
+
+
+    /* gets the index entry that follows a value; the brackets have been
+     * checked to be balanced, so that this never runs past the index */
+static inline ag_size
+ag__json_skip__(const ag_json *j, ag_size at)
+{
+    ag_size depth = 0;
+    char c;
+
+    do {
+        c = ag__json_char__(j, at++);
+        if (c == '{' || c == '[')
+            depth++;
+        else if (c == '}' || c == ']')
+            depth--;
+    } while (depth);
+
+    return at;
+}
+
+
+    /* checks a token against the JSON number grammar, and tells whether it
+     * has neither a fractional part nor an exponent */
+static inline ag_bool
+ag__json_number__(ag_string_view t, ag_bool *integral)
+{
+    ag_size i = 0, k;
+
+    if (i < t.len && t.str[i] == '-')
+        i++;
+
+    if (i < t.len && t.str[i] == '0')
+        i++;
+    else {
+        for (k = i; i < t.len && t.str[i] >= '0' && t.str[i] <= '9'; i++);
+        if (i == k)
+            return false;
+    }
+
+    *integral = i == t.len;
+
+    if (i < t.len && t.str[i] == '.') {
+        for (k = ++i; i < t.len && t.str[i] >= '0' && t.str[i] <= '9'; i++);
+        if (i == k)
+            return false;
+    }
+
+    if (i < t.len && (t.str[i] == 'e' || t.str[i] == 'E')) {
+        i++;
+        if (i < t.len && (t.str[i] == '-' || t.str[i] == '+'))
+            i++;
+
+        for (k = i; i < t.len && t.str[i] >= '0' && t.str[i] <= '9'; i++);
+        if (i == k)
+            return false;
+    }
+
+    return i == t.len;
+}
+
+
+/**
+ * Create parser.
+ *
+ * The @c ag_json_create() function creates a JSON parser @p j. The parser
+ * allocates its index when it first parses a document.
+ *
+ * @param j Parser to create.
+ *
+ * @return AG_ERNO_NULL if the parser has been created.
+ * @return AG_ERNO_HANDLE if @p j is a null pointer.
+ * @return AG_ERNO_MEMORY if the parser could not be allocated.
+ *
+ * @see ag_json_destroy()
+ */
+static inline ag_erno
+ag_json_create(ag_json **j)
+{
+    ag_json *js;
+
+AG_TRY:
+    ag_assert_handle(j);
+
+    js = (ag_json *) malloc(sizeof *js);
+    ag_assert(js, AG_ERNO_MEMORY);
+
+    js->text.str = "";
+    js->text.len = 0;
+    js->index = NULL;
+    js->n = js->cap = 0;
+
+    *j = js;
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Destroy parser.
+ *
+ * The @c ag_json_destroy() function releases a parser @p j, invalidating all
+ * values referring to it.
+ *
+ * @param j Parser to destroy; may be a null pointer.
+ *
+ * @see ag_json_create()
+ */
+static inline void
+ag_json_destroy(ag_json *j)
+{
+    if (j) {
+        free(j->index);
+        free(j);
+    }
+}
+
+
+/**
+ * Parse document.
+ *
+ * The @c ag_json_parse() function indexes the JSON document @p text with a
+ * parser @p j, and gets its root value. The text must remain valid while the
+ * values of the document are used.
+ *
+ * @param j Parser to parse with.
+ * @param text JSON text, shorter than 4 GiB.
+ * @param root Value to receive the root of the document.
+ *
+ * @return AG_ERNO_NULL if the document has been indexed.
+ * @return AG_ERNO_HANDLE if @p j or @p root is a null pointer.
+ * @return AG_ERNO_RANGE if @p text is too long, or nests arrays and objects
+ * deeper than @c AG_JSON_DEPTH.
+ * @return AG_ERNO_STRING if @p text is empty, has an unterminated string or a
+ * control character within a string, has unbalanced or mismatched brackets,
+ * or has more than one root value.
+ * @return AG_ERNO_MEMORY if the index could not be allocated.
+ */
+static inline ag_erno
+ag_json_parse(ag_json *j, ag_string_view text, ag_json_value *root)
+{
+    const ag_simd_mask even = 0x5555555555555555;
+    ag_simd_block b;
+    ag_simd_mask bs, esc, follows, odd, seq, quote, str, op, ws, scalar, nq;
+    ag_simd_mask m, pesc = 0, pstr = 0, pscalar = 0;
+    ag_word_64 kind[(AG_JSON_DEPTH + 63) / 64], bit;
+    ag_word_32 *idx;
+    ag_size i, k, n = 0, depth = 0;
+    char c;
+
+AG_TRY:
+    ag_assert_handle(j && root);
+    ag_assert_range(text.len < UINT32_MAX);
+
+    j->text = text;
+    j->n = 0;
+
+    if (j->cap < text.len + 1) {
+        idx = (ag_word_32 *) realloc(j->index, (text.len + 1) * sizeof *idx);
+        ag_assert(idx, AG_ERNO_MEMORY);
+
+        j->index = idx;
+        j->cap = text.len + 1;
+    }
+
+    idx = j->index;
+    for (i = 0; i < text.len; i += AG_SIMD_BLOCK) {
+        k = text.len - i;
+        if (ag_likely (k >= AG_SIMD_BLOCK))
+            ag_simd_load(&b, text.str + i);
+        else
+            ag_simd_load_partial(&b, text.str + i, k, ' ');
+
+            /* a backslash run starting on an odd bit overflows into the bit
+             * after its end when added to the runs, which flips the parity of
+             * the escaped characters it is compared with */
+        bs = ag_simd_eq(&b, '\\') & ~pesc;
+        follows = bs << 1 | pesc;
+        odd = bs & ~even & ~follows;
+        seq = odd + bs;
+        pesc = seq < bs;
+        esc = (even ^ seq << 1) & follows;
+
+        quote = ag_simd_eq(&b, '"') & ~esc;
+        str = ag_simd_prefix_xor(quote) ^ pstr;
+        pstr = (ag_simd_mask) 0 - (str >> 63);
+        ag_assert(!(ag_simd_lt(&b, 0x20) & str), AG_ERNO_STRING);
+
+        op = ag_simd_eq(&b, '{') | ag_simd_eq(&b, '}') | ag_simd_eq(&b, '[')
+                | ag_simd_eq(&b, ']') | ag_simd_eq(&b, ':')
+                | ag_simd_eq(&b, ',');
+        ws = ag_simd_eq(&b, ' ') | ag_simd_eq(&b, '\t')
+                | ag_simd_eq(&b, '\n') | ag_simd_eq(&b, '\r');
+
+            /* scalars start wherever a non-quote scalar character does not
+             * follow another, and nothing within a string is structural */
+        scalar = ~(op | ws);
+        nq = scalar & ~quote;
+        follows = nq << 1 | pscalar;
+        pscalar = nq >> 63;
+
+        m = (op | (scalar & ~follows)) & ~(str ^ quote);
+        if (k < AG_SIMD_BLOCK)
+            m &= ((ag_simd_mask) 1 << k) - 1;
+
+        while (m)
+            idx[n++] = (ag_word_32) (i + ag_simd_next(&m));
+    }
+
+    ag_assert(!pstr && n, AG_ERNO_STRING);
+
+        /* the root value must span the whole index, and each closing
+         * bracket must match the opening one recorded at its depth */
+    for (i = 0; i < n; i++) {
+        c = text.str[idx[i]];
+        if (c == '{' || c == '[') {
+            ag_assert_range(depth < AG_JSON_DEPTH);
+            bit = (ag_word_64) 1 << depth % 64;
+            kind[depth / 64] = c == '{' ? kind[depth / 64] | bit
+                    : kind[depth / 64] & ~bit;
+            depth++;
+        } else if (c == '}' || c == ']') {
+            ag_assert(depth--, AG_ERNO_STRING);
+            ag_assert(!(kind[depth / 64] >> depth % 64 & 1) == (c == ']'),
+                    AG_ERNO_STRING);
+        }
+
+        ag_assert(depth || i == n - 1, AG_ERNO_STRING);
+    }
+
+    ag_assert(!depth, AG_ERNO_STRING);
+
+    j->n = n;
+    root->json = j;
+    root->at = 0;
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Get value type.
+ *
+ * The @c ag_json_type() function gets the type of a value @p v, as told by its
+ * first character.
+ *
+ * @param v Value to query.
+ *
+ * @return @c AG_JSON_NULL, @c AG_JSON_BOOL, @c AG_JSON_NUMBER, @c
+ * AG_JSON_STRING, @c AG_JSON_ARRAY, @c AG_JSON_OBJECT or @c AG_JSON_INVALID.
+ */
+static inline int
+ag_json_type(ag_json_value v)
+{
+    char c = ag__json_char__(v.json, v.at);
+
+    if (c == '"')
+        return AG_JSON_STRING;
+    if (c == '-' || (c >= '0' && c <= '9'))
+        return AG_JSON_NUMBER;
+    if (c == '{')
+        return AG_JSON_OBJECT;
+    if (c == '[')
+        return AG_JSON_ARRAY;
+    if (c == 't' || c == 'f')
+        return AG_JSON_BOOL;
+    if (c == 'n')
+        return AG_JSON_NULL;
+
+    return AG_JSON_INVALID;
+}
+
+
+/**
+ * Check for null.
+ *
+ * The @c ag_json_is_null() function checks whether a value @p v is the null
+ * literal.
+ *
+ * @param v Value to check.
+ *
+ * @return @c true if @p v is null.
+ */
+static inline ag_bool
+ag_json_is_null(ag_json_value v)
+{
+    ag_string_view t = ag__json_token__(v.json, v.at);
+
+    return t.len == 4 && !memcmp(t.str, "null", 4);
+}
+
+
+/**
+ * Get boolean value.
+ *
+ * The @c ag_json_get_bool() function gets the value of a boolean literal @p v.
+ *
+ * @param v Value to get.
+ * @param b Boolean to receive the value.
+ *
+ * @return AG_ERNO_NULL if the value has been got.
+ * @return AG_ERNO_HANDLE if @p b is a null pointer.
+ * @return AG_ERNO_STATE if @p v is not a boolean.
+ */
+static inline ag_erno
+ag_json_get_bool(ag_json_value v, ag_bool *b)
+{
+    ag_string_view t;
+
+AG_TRY:
+    ag_assert_handle(b);
+
+    t = ag__json_token__(v.json, v.at);
+    if (t.len == 4 && !memcmp(t.str, "true", 4))
+        *b = true;
+    else {
+        ag_assert_state(t.len == 5 && !memcmp(t.str, "false", 5));
+        *b = false;
+    }
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Get integer value.
+ *
+ * The @c ag_json_get_int() function gets the value of a number @p v that has
+ * neither a fractional part nor an exponent.
+ *
+ * @param v Value to get.
+ * @param i Integer to receive the value.
+ *
+ * @return AG_ERNO_NULL if the value has been got.
+ * @return AG_ERNO_HANDLE if @p i is a null pointer.
+ * @return AG_ERNO_STATE if @p v is not an integer.
+ * @return AG_ERNO_STRING if @p v is a malformed number.
+ * @return AG_ERNO_RANGE if the value of @p v does not fit in 64 bits.
+ *
+ * @see ag_json_get_float()
+ */
+static inline ag_erno
+ag_json_get_int(ag_json_value v, ag_int *i)
+{
+    ag_string_view t;
+    ag_int_64 x;
+    ag_bool integral = false;
+
+AG_TRY:
+    ag_assert_handle(i);
+    ag_assert_state(ag_json_type(v) == AG_JSON_NUMBER);
+
+    t = ag__json_token__(v.json, v.at);
+    ag_assert(ag__json_number__(t, &integral), AG_ERNO_STRING);
+    ag_assert_state(integral);
+
+    ag_try(ag_number_parse_int(t, &x));
+    *i = (ag_int) x;
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Get floating point value.
+ *
+ * The @c ag_json_get_float() function gets the value of any number @p v.
+ *
+ * @param v Value to get.
+ * @param f Floating point number to receive the value.
+ *
+ * @return AG_ERNO_NULL if the value has been got.
+ * @return AG_ERNO_HANDLE if @p f is a null pointer.
+ * @return AG_ERNO_STATE if @p v is not a number.
+ * @return AG_ERNO_STRING if @p v is a malformed number.
+ *
+ * @see ag_json_get_int()
+ */
+static inline ag_erno
+ag_json_get_float(ag_json_value v, ag_float *f)
+{
+    ag_string_view t;
+    ag_float_64 x;
+    ag_bool integral = false;
+
+AG_TRY:
+    ag_assert_handle(f);
+    ag_assert_state(ag_json_type(v) == AG_JSON_NUMBER);
+
+    t = ag__json_token__(v.json, v.at);
+    ag_assert(ag__json_number__(t, &integral), AG_ERNO_STRING);
+
+    ag_try(ag_number_parse_float(t, &x));
+    *f = (ag_float) x;
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Get string value.
+ *
+ * The @c ag_json_get_string() function gets a view over the raw contents of a
+ * string @p v, between its quotes and with its escape sequences left in place.
+ *
+ * @param v Value to get.
+ * @param s View to receive the string.
+ *
+ * @return AG_ERNO_NULL if the value has been got.
+ * @return AG_ERNO_HANDLE if @p s is a null pointer.
+ * @return AG_ERNO_STATE if @p v is not a string.
+ * @return AG_ERNO_STRING if @p v is followed by stray characters.
+ *
+ * @see ag_json_unescape()
+ */
+static inline ag_erno
+ag_json_get_string(ag_json_value v, ag_string_view *s)
+{
+    ag_string_view t;
+
+AG_TRY:
+    ag_assert_handle(s);
+    ag_assert_state(ag_json_type(v) == AG_JSON_STRING);
+
+    t = ag__json_token__(v.json, v.at);
+    ag_assert(t.len >= 2 && t.str[t.len - 1] == '"', AG_ERNO_STRING);
+
+    s->str = t.str + 1;
+    s->len = t.len - 2;
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+    /* decodes four hexadecimal digits */
+static inline ag_bool
+ag__json_hex4__(const ag_string *s, ag_word_32 *cp)
+{
+    ag_index i;
+    char c;
+
+    for (*cp = 0, i = 0; i < 4; i++) {
+        c = s[i];
+        if (c >= '0' && c <= '9')
+            *cp = *cp << 4 | (ag_word_32) (c - '0');
+        else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+            *cp = *cp << 4 | (ag_word_32) ((c | 0x20) - 'a' + 10);
+        else
+            return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * Unescape string.
+ *
+ * The @c ag_json_unescape() function decodes the escape sequences of the raw
+ * string @p s into @p out, encoding escaped code points in UTF-8. The decoded
+ * string is never longer than @p s, and is not null-terminated.
+ *
+ * @param s Raw string to decode.
+ * @param out Buffer to receive the decoded string, at least as long as @p s.
+ * @param n Set to the length of the decoded string.
+ *
+ * @return AG_ERNO_NULL if the string has been decoded.
+ * @return AG_ERNO_HANDLE if @p out or @p n is a null pointer.
+ * @return AG_ERNO_STRING if @p s has an invalid escape sequence.
+ *
+ * @see ag_json_get_string()
+ */
+static inline ag_erno
+ag_json_unescape(ag_string_view s, ag_string *out, ag_size *n)
+{
+    static const char esc[] = "\"\"\\\\//b\bf\fn\nr\rt\t";
+    const ag_string *p = s.str, *end = s.str + s.len, *bs, *e;
+    ag_word_32 cp, lo;
+    ag_size o = 0;
+
+AG_TRY:
+    ag_assert_handle(out && n);
+
+        /* runs without escape sequences are copied whole */
+    while ((bs = (const ag_string *) memchr(p, '\\', (ag_size) (end - p)))) {
+        memcpy(out + o, p, (ag_size) (bs - p));
+        o += (ag_size) (bs - p);
+        ag_assert(bs + 1 < end, AG_ERNO_STRING);
+
+        if (bs[1] != 'u') {
+            for (e = esc; *e && *e != bs[1]; e += 2);
+            ag_assert(*e, AG_ERNO_STRING);
+
+            out[o++] = e[1];
+            p = bs + 2;
+            continue;
+        }
+
+        ag_assert(end - bs >= 6 && ag__json_hex4__(bs + 2, &cp),
+                AG_ERNO_STRING);
+        p = bs + 6;
+
+        if (cp >= 0xd800 && cp < 0xdc00) {
+            ag_assert(end - p >= 6 && p[0] == '\\' && p[1] == 'u'
+                    && ag__json_hex4__(p + 2, &lo) && lo >= 0xdc00
+                    && lo < 0xe000, AG_ERNO_STRING);
+            cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+            p += 6;
+        } else
+            ag_assert(cp < 0xdc00 || cp >= 0xe000, AG_ERNO_STRING);
+
+        if (cp < 0x80)
+            out[o++] = (ag_string) cp;
+        else if (cp < 0x800) {
+            out[o++] = (ag_string) (0xc0 | cp >> 6);
+            out[o++] = (ag_string) (0x80 | (cp & 0x3f));
+        } else if (cp < 0x10000) {
+            out[o++] = (ag_string) (0xe0 | cp >> 12);
+            out[o++] = (ag_string) (0x80 | (cp >> 6 & 0x3f));
+            out[o++] = (ag_string) (0x80 | (cp & 0x3f));
+        } else {
+            out[o++] = (ag_string) (0xf0 | cp >> 18);
+            out[o++] = (ag_string) (0x80 | (cp >> 12 & 0x3f));
+            out[o++] = (ag_string) (0x80 | (cp >> 6 & 0x3f));
+            out[o++] = (ag_string) (0x80 | (cp & 0x3f));
+        }
+    }
+
+    memcpy(out + o, p, (ag_size) (end - p));
+    *n = o + (ag_size) (end - p);
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Start iteration.
+ *
+ * The @c ag_json_iter_init() function starts an iterator @p it over the
+ * elements of an array, or the fields of an object, @p v.
+ *
+ * @param v Array or object to iterate over.
+ * @param it Iterator to start.
+ *
+ * @return AG_ERNO_NULL if the iteration has been started.
+ * @return AG_ERNO_HANDLE if @p it is a null pointer.
+ * @return AG_ERNO_STATE if @p v is neither an array nor an object.
+ *
+ * @see ag_json_iter_next()
+ */
+static inline ag_erno
+ag_json_iter_init(ag_json_value v, ag_json_iter *it)
+{
+    int type = ag_json_type(v);
+
+AG_TRY:
+    ag_assert_handle(it);
+    ag_assert_state(type == AG_JSON_ARRAY || type == AG_JSON_OBJECT);
+
+    it->json = v.json;
+    it->at = v.at + 1;
+    it->erno = AG_ERNO_NULL;
+    it->object = type == AG_JSON_OBJECT;
+    it->first = true;
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Get next element.
+ *
+ * The @c ag_json_iter_next() function gets the next element of an array, or
+ * the next field of an object, from an iterator @p it. Elements that are not
+ * accessed are skipped without being examined. Once this function has
+ * returned @c false, @c ag_json_iter_error() tells whether the end of the
+ * array or object, or a malformed part of it, was reached.
+ *
+ * @param it Iterator to advance.
+ * @param key View to receive the raw key of an object field; may be a null
+ * pointer.
+ * @param v Value to receive the element or field value.
+ *
+ * @return @c true if an element was got, or @c false otherwise.
+ *
+ * @see ag_json_iter_error()
+ */
+static inline ag_bool
+ag_json_iter_next(ag_json_iter *it, ag_string_view *key, ag_json_value *v)
+{
+    const ag_json *j = it->json;
+    ag_string_view s;
+    ag_json_value k;
+    char c;
+
+    if (ag_unlikely (it->erno))
+        return false;
+
+    c = ag__json_char__(j, it->at);
+    if (c == (it->object ? '}' : ']'))
+        return false;
+
+    if (!it->first) {
+        if (ag_unlikely (c != ',')) {
+            it->erno = AG_ERNO_STRING;
+            return false;
+        }
+        it->at++;
+    }
+
+    if (it->object) {
+        k.json = j;
+        k.at = it->at;
+        if (ag_unlikely (ag__json_char__(j, it->at) != '"'
+                || ag__json_char__(j, it->at + 1) != ':'
+                || ag_json_get_string(k, &s))) {
+            it->erno = AG_ERNO_STRING;
+            return false;
+        }
+
+        if (key)
+            *key = s;
+        it->at += 2;
+    }
+
+        /* a value must be followed by a comma or the closing bracket, which
+         * the brackets having been balanced guarantees to exist */
+    c = ag__json_char__(j, it->at);
+    if (ag_unlikely (c == ',' || c == ':' || c == '}' || c == ']')) {
+        it->erno = AG_ERNO_STRING;
+        return false;
+    }
+
+    v->json = j;
+    v->at = it->at;
+    it->at = ag__json_skip__(j, it->at);
+    it->first = false;
+
+    return true;
+}
+
+
+/**
+ * Get iteration error.
+ *
+ * The @c ag_json_iter_error() function gets the error, if any, that stopped
+ * an iterator @p it.
+ *
+ * @param it Iterator to query.
+ *
+ * @return AG_ERNO_NULL if the end of the array or object was reached.
+ * @return AG_ERNO_STRING if the array or object is malformed.
+ */
+static inline ag_erno
+ag_json_iter_error(const ag_json_iter *it)
+{
+    return it->erno;
+}
+
+
+/**
+ * Find object field.
+ *
+ * The @c ag_json_find() function finds the field of an object @p v whose raw
+ * key is @p key.
+ *
+ * @param v Object to search.
+ * @param key Key to find.
+ * @param f Value to receive the value of the field.
+ *
+ * @return AG_ERNO_NULL if the field has been found.
+ * @return AG_ERNO_HANDLE if @p key or @p f is a null pointer.
+ * @return AG_ERNO_STATE if @p v is not an object.
+ * @return AG_ERNO_RANGE if @p v has no field with the key @p key.
+ * @return AG_ERNO_STRING if @p v is malformed.
+ */
+static inline ag_erno
+ag_json_find(ag_json_value v, const ag_string *key, ag_json_value *f)
+{
+    ag_json_iter it;
+    ag_string_view k;
+    ag_size len;
+    ag_bool found = false;
+
+AG_TRY:
+    ag_assert_handle(key && f);
+    ag_assert_state(ag_json_type(v) == AG_JSON_OBJECT);
+
+    len = strlen(key);
+    (void) ag_json_iter_init(v, &it);
+    while (!found && ag_json_iter_next(&it, &k, f))
+        found = k.len == len && !memcmp(k.str, key, len);
+
+    ag_try(ag_json_iter_error(&it));
+    ag_assert_range(found);
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Get array element.
+ *
+ * The @c ag_json_at() function gets the element at index @p i of an array @p
+ * v, skipping the elements before it.
+ *
+ * @param v Array to index.
+ * @param i Index of the element.
+ * @param e Value to receive the element.
+ *
+ * @return AG_ERNO_NULL if the element has been got.
+ * @return AG_ERNO_HANDLE if @p e is a null pointer.
+ * @return AG_ERNO_STATE if @p v is not an array.
+ * @return AG_ERNO_RANGE if @p v has no element at index @p i.
+ * @return AG_ERNO_STRING if @p v is malformed.
+ */
+static inline ag_erno
+ag_json_at(ag_json_value v, ag_index i, ag_json_value *e)
+{
+    ag_json_iter it;
+    ag_bool found = false;
+
+AG_TRY:
+    ag_assert_handle(e);
+    ag_assert_state(ag_json_type(v) == AG_JSON_ARRAY);
+
+    (void) ag_json_iter_init(v, &it);
+    while (!found && ag_json_iter_next(&it, NULL, e))
+        found = !i--;
+
+    ag_try(ag_json_iter_error(&it));
+    ag_assert_range(found);
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Default writer size.
+ *
+ * The @c AG_JSON_WRITER_SIZE symbolic constant sets the initial size of the
+ * buffer of writers created with a zero size. The default may be overridden by
+ * defining this constant before including this header.
+ *
+ * @see ag_json_writer_create()
+ */
+#if !defined AG_JSON_WRITER_SIZE
+#   define AG_JSON_WRITER_SIZE 4096
+#endif
+
+
+/**
+ * JSON writer.
+ *
+ * The @c ag_json_writer type builds JSON text in a growable buffer. Writers
+ * are created through @c ag_json_writer_create().
+ *
+ * @see ag_json_writer_create()
+ */
+typedef struct ag_json_writer {
+    ag_string *buf;
+    ag_size len;
+    ag_size cap;
+} ag_json_writer;
+
+
+    /* ensures room for n more bytes, growing the buffer geometrically */
+static inline ag_erno
+ag__json_reserve__(ag_json_writer *w, ag_size n)
+{
+    ag_string *buf;
+    ag_size cap;
+
+AG_TRY:
+    if (ag_unlikely (w->cap - w->len < n)) {
+        for (cap = w->cap * 2; cap - w->len < n; cap *= 2);
+
+        buf = (ag_string *) realloc(w->buf, cap);
+        ag_assert(buf, AG_ERNO_MEMORY);
+
+        w->buf = buf;
+        w->cap = cap;
+    }
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+    /* ensures room for n more bytes and a separating comma, which precedes a
+     * value unless it opens the text, a container or the value of a field */
+static inline ag_erno
+ag__json_begin__(ag_json_writer *w, ag_size n)
+{
+    ag_string c;
+
+AG_TRY:
+    ag_try(ag__json_reserve__(w, n + 1));
+
+    if (w->len) {
+        c = w->buf[w->len - 1];
+        if (c != '[' && c != '{' && c != ':')
+            w->buf[w->len++] = ',';
+    }
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+    /* writes a quoted string, copying the runs between the characters that
+     * need escaping, which are located a block at a time */
+static inline void
+ag__json_quote__(ag_json_writer *w, const ag_string *s, ag_size len)
+{
+    static const ag_string hex[] = "0123456789abcdef";
+    ag_string *p = w->buf + w->len;
+    ag_simd_block b;
+    ag_simd_mask m;
+    ag_size pos, run, n;
+    ag_index i;
+    ag_word_8 c;
+
+    *p++ = '"';
+
+    for (pos = 0; pos < len; pos += n) {
+        n = len - pos;
+        if (ag_likely (n >= AG_SIMD_BLOCK)) {
+            n = AG_SIMD_BLOCK;
+            ag_simd_load(&b, s + pos);
+        } else
+            ag_simd_load_partial(&b, s + pos, n, ' ');
+
+        m = ag_simd_eq(&b, '"') | ag_simd_eq(&b, '\\') | ag_simd_lt(&b, 0x20);
+        if (n < AG_SIMD_BLOCK)
+            m &= ((ag_simd_mask) 1 << n) - 1;
+
+        for (run = 0; m; run = i + 1) {
+            i = ag_simd_next(&m);
+            memcpy(p, s + pos + run, i - run);
+            p += i - run;
+
+            c = (ag_word_8) s[pos + i];
+            *p++ = '\\';
+            switch (c) {
+            case '"':
+            case '\\':
+                *p++ = (ag_string) c;
+                break;
+            case '\b':
+                *p++ = 'b';
+                break;
+            case '\f':
+                *p++ = 'f';
+                break;
+            case '\n':
+                *p++ = 'n';
+                break;
+            case '\r':
+                *p++ = 'r';
+                break;
+            case '\t':
+                *p++ = 't';
+                break;
+            default:
+                memcpy(p, "u00", 3);
+                p[3] = hex[c >> 4];
+                p[4] = hex[c & 0xf];
+                p += 5;
+            }
+        }
+
+        memcpy(p, s + pos + run, n - run);
+        p += n - run;
+    }
+
+    *p++ = '"';
+    w->len = (ag_size) (p - w->buf);
+}
+
+
+/**
+ * Create writer.
+ *
+ * The @c ag_json_writer_create() function creates a writer @p w with an
+ * initial buffer of @p size bytes.
+ *
+ * @param w Writer to create.
+ * @param size Initial buffer size, or zero for @c AG_JSON_WRITER_SIZE.
+ *
+ * @return AG_ERNO_NULL if the writer has been created.
+ * @return AG_ERNO_HANDLE if @p w is a null pointer.
+ * @return AG_ERNO_MEMORY if the writer could not be allocated.
+ *
+ * @see ag_json_writer_destroy()
+ */
+static inline ag_erno
+ag_json_writer_create(ag_json_writer **w, ag_size size)
+{
+    ag_json_writer *jw = NULL;
+
+AG_TRY:
+    ag_assert_handle(w);
+
+    jw = (ag_json_writer *) malloc(sizeof *jw);
+    ag_assert(jw, AG_ERNO_MEMORY);
+
+    jw->cap = size ? size : AG_JSON_WRITER_SIZE;
+    jw->buf = (ag_string *) malloc(jw->cap);
+    ag_assert(jw->buf, AG_ERNO_MEMORY);
+    jw->len = 0;
+
+    *w = jw;
+
+AG_CATCH:
+    free(jw);
+
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Destroy writer.
+ *
+ * The @c ag_json_writer_destroy() function releases a writer @p w, along with
+ * the text it has built.
+ *
+ * @param w Writer to destroy; may be a null pointer.
+ *
+ * @see ag_json_writer_create()
+ */
+static inline void
+ag_json_writer_destroy(ag_json_writer *w)
+{
+    if (w) {
+        free(w->buf);
+        free(w);
+    }
+}
+
+
+/**
+ * Reset writer.
+ *
+ * The @c ag_json_writer_reset() function discards the text built by a writer
+ * @p w, keeping its buffer so that it may build another document.
+ *
+ * @param w Writer to reset.
+ */
+static inline void
+ag_json_writer_reset(ag_json_writer *w)
+{
+    w->len = 0;
+}
+
+
+/**
+ * View written text.
+ *
+ * The @c ag_json_writer_view() function gets a view of the text built by a
+ * writer @p w, which remains valid until the writer is next written to, reset
+ * or destroyed. The text is not null-terminated.
+ *
+ * @param w Writer to view.
+ *
+ * @return View of the text.
+ */
+static inline ag_string_view
+ag_json_writer_view(const ag_json_writer *w)
+{
+    ag_string_view v;
+
+    v.str = w->buf;
+    v.len = w->len;
+
+    return v;
+}
+
+
+    /* writes a punctuation character, preceded by a comma if it opens a
+     * container */
+static inline ag_erno
+ag__json_punct__(ag_json_writer *w, ag_string c, ag_bool open)
+{
+AG_TRY:
+    ag_assert_handle(w);
+
+    if (open)
+        ag_try(ag__json_begin__(w, 1));
+    else
+        ag_try(ag__json_reserve__(w, 1));
+
+    w->buf[w->len++] = c;
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Open object.
+ *
+ * The @c ag_json_write_object() function writes the opening brace of an
+ * object through a writer @p w. The fields of the object are then written as
+ * a key followed by a value, and the object is closed by @c
+ * ag_json_write_object_end().
+ *
+ * @param w Writer to write through.
+ *
+ * @return AG_ERNO_NULL if the brace has been written.
+ * @return AG_ERNO_HANDLE if @p w is a null pointer.
+ * @return AG_ERNO_MEMORY if the buffer could not be grown.
+ *
+ * @see ag_json_write_key()
+ * @see ag_json_write_object_end()
+ */
+static inline ag_erno
+ag_json_write_object(ag_json_writer *w)
+{
+    return ag__json_punct__(w, '{', true);
+}
+
+
+/**
+ * Close object.
+ *
+ * The @c ag_json_write_object_end() function writes the closing brace of an
+ * object through a writer @p w.
+ *
+ * @param w Writer to write through.
+ *
+ * @return AG_ERNO_NULL if the brace has been written.
+ * @return AG_ERNO_HANDLE if @p w is a null pointer.
+ * @return AG_ERNO_MEMORY if the buffer could not be grown.
+ *
+ * @see ag_json_write_object()
+ */
+static inline ag_erno
+ag_json_write_object_end(ag_json_writer *w)
+{
+    return ag__json_punct__(w, '}', false);
+}
+
+
+/**
+ * Open array.
+ *
+ * The @c ag_json_write_array() function writes the opening bracket of an array
+ * through a writer @p w. The elements of the array are then written in turn,
+ * and the array is closed by @c ag_json_write_array_end().
+ *
+ * @param w Writer to write through.
+ *
+ * @return AG_ERNO_NULL if the bracket has been written.
+ * @return AG_ERNO_HANDLE if @p w is a null pointer.
+ * @return AG_ERNO_MEMORY if the buffer could not be grown.
+ *
+ * @see ag_json_write_array_end()
+ */
+static inline ag_erno
+ag_json_write_array(ag_json_writer *w)
+{
+    return ag__json_punct__(w, '[', true);
+}
+
+
+/**
+ * Close array.
+ *
+ * The @c ag_json_write_array_end() function writes the closing bracket of an
+ * array through a writer @p w.
+ *
+ * @param w Writer to write through.
+ *
+ * @return AG_ERNO_NULL if the bracket has been written.
+ * @return AG_ERNO_HANDLE if @p w is a null pointer.
+ * @return AG_ERNO_MEMORY if the buffer could not be grown.
+ *
+ * @see ag_json_write_array()
+ */
+static inline ag_erno
+ag_json_write_array_end(ag_json_writer *w)
+{
+    return ag__json_punct__(w, ']', false);
+}
+
+
+/**
+ * Write key.
+ *
+ * The @c ag_json_write_key() function writes the key @p s of @p len bytes of
+ * an object field through a writer @p w, escaping it as needed and following
+ * it with a colon; the value of the field is written next.
+ *
+ * @param w Writer to write through.
+ * @param s Key to write, encoded in UTF-8.
+ * @param len Length of @p s.
+ *
+ * @return AG_ERNO_NULL if the key has been written.
+ * @return AG_ERNO_HANDLE if @p w or @p s is a null pointer.
+ * @return AG_ERNO_MEMORY if the buffer could not be grown.
+ *
+ * @see ag_json_write_object()
+ */
+static inline ag_erno
+ag_json_write_key(ag_json_writer *w, const ag_string *s, ag_size len)
+{
+AG_TRY:
+    ag_assert_handle(w && s);
+
+        /* each byte expands to at most six, as in \u001f */
+    ag_try(ag__json_begin__(w, len * 6 + 3));
+    ag__json_quote__(w, s, len);
+    w->buf[w->len++] = ':';
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Write string.
+ *
+ * The @c ag_json_write_string() function writes the string @p s of @p len
+ * bytes through a writer @p w. Quotes, backslashes and control characters are
+ * escaped; other bytes, including those of multibyte UTF-8 sequences, are
+ * copied as they are.
+ *
+ * @param w Writer to write through.
+ * @param s String to write, encoded in UTF-8.
+ * @param len Length of @p s.
+ *
+ * @return AG_ERNO_NULL if the string has been written.
+ * @return AG_ERNO_HANDLE if @p w or @p s is a null pointer.
+ * @return AG_ERNO_MEMORY if the buffer could not be grown.
+ */
+static inline ag_erno
+ag_json_write_string(ag_json_writer *w, const ag_string *s, ag_size len)
+{
+AG_TRY:
+    ag_assert_handle(w && s);
+
+    ag_try(ag__json_begin__(w, len * 6 + 2));
+    ag__json_quote__(w, s, len);
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Write integer.
+ *
+ * The @c ag_json_write_int() function writes the integer @p i through a writer
+ * @p w.
+ *
+ * @param w Writer to write through.
+ * @param i Integer to write.
+ *
+ * @return AG_ERNO_NULL if the integer has been written.
+ * @return AG_ERNO_HANDLE if @p w is a null pointer.
+ * @return AG_ERNO_MEMORY if the buffer could not be grown.
+ */
+static inline ag_erno
+ag_json_write_int(ag_json_writer *w, ag_int i)
+{
+AG_TRY:
+    ag_assert_handle(w);
+
+    ag_try(ag__json_begin__(w, AG_NUMBER_SIZE));
+    w->len += ag_number_format_int(i, w->buf + w->len);
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Write floating point number.
+ *
+ * The @c ag_json_write_float() function writes the floating point number @p f
+ * through a writer @p w, with the fewest digits that read back as @p f in all
+ * but rare cases.
+ *
+ * @param w Writer to write through.
+ * @param f Floating point number to write.
+ *
+ * @return AG_ERNO_NULL if the number has been written.
+ * @return AG_ERNO_HANDLE if @p w is a null pointer.
+ * @return AG_ERNO_RANGE if @p f is infinite or a NaN, which JSON cannot
+ * represent.
+ * @return AG_ERNO_MEMORY if the buffer could not be grown.
+ */
+static inline ag_erno
+ag_json_write_float(ag_json_writer *w, ag_float f)
+{
+AG_TRY:
+    ag_assert_handle(w);
+    ag_assert_range(f - f == 0);
+
+    ag_try(ag__json_begin__(w, AG_NUMBER_SIZE));
+    w->len += ag_number_format_float(f, w->buf + w->len);
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Write Boolean.
+ *
+ * The @c ag_json_write_bool() function writes the Boolean literal @p b
+ * through a writer @p w.
+ *
+ * @param w Writer to write through.
+ * @param b Boolean to write.
+ *
+ * @return AG_ERNO_NULL if the literal has been written.
+ * @return AG_ERNO_HANDLE if @p w is a null pointer.
+ * @return AG_ERNO_MEMORY if the buffer could not be grown.
+ */
+static inline ag_erno
+ag_json_write_bool(ag_json_writer *w, ag_bool b)
+{
+AG_TRY:
+    ag_assert_handle(w);
+
+    ag_try(ag__json_begin__(w, 5));
+    memcpy(w->buf + w->len, b ? "true" : "false", b ? 4 : 5);
+    w->len += b ? 4 : 5;
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Write null.
+ *
+ * The @c ag_json_write_null() function writes the null literal through a
+ * writer @p w.
+ *
+ * @param w Writer to write through.
+ *
+ * @return AG_ERNO_NULL if the literal has been written.
+ * @return AG_ERNO_HANDLE if @p w is a null pointer.
+ * @return AG_ERNO_MEMORY if the buffer could not be grown.
+ */
+static inline ag_erno
+ag_json_write_null(ag_json_writer *w)
+{
+AG_TRY:
+    ag_assert_handle(w);
+
+    ag_try(ag__json_begin__(w, 4));
+    memcpy(w->buf + w->len, "null", 4);
+    w->len += 4;
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * @example json.h
+ * This is an example showing how to code against the Argent Core JSON Module
+ * interface.
+ * @}
+ */
+
+
+#endif /* !defined ARGENT_CORE_JSON */
@@ -0,0 +1,435 @@
+#if !defined ARGENT_CORE_LOCK
+#define ARGENT_CORE_LOCK
+
+
+/**************************************************************************//**
+ * @defgroup lock Argent Core Lock Module
+ * Lightweight spinning locks.
+ *
+ * The Lock Module provides a family of locks that spin in user space instead
+ * of sleeping in the kernel, and are intended to guard short critical sections
+ * where the cost of a system call would exceed the time spent waiting. Three
+ * kinds of lock are provided:
+ *   - @c ag_spinlock, a test-and-test-and-set lock with exponential backoff,
+ *     which is the cheapest when contention is light;
+ *   - @c ag_ticketlock, which grants the lock in first-come first-served order
+ *     and is therefore fair;
+ *   - @c ag_mcslock, a queue lock that is both fair and scalable, as each
+ *     waiter spins on its own cache line.
+ *
+ * All locks share a uniform interface of @c _init(), @c _acquire(), @c
+ * _try_acquire() and @c _release() functions, except that the MCS lock
+ * functions also take a queue node provided by the caller. All lock objects
+ * are cache line aligned so that they do not share a cache line with the data
+ * they protect or with other locks.
+ *
+ * @warning These locks never sleep, so they should @b not be held across
+ * blocking calls; use the mutex provided by the Futex Module in such cases.
+ * @{
+ */
+
+
+#include <sched.h>
+#include "atomic.h"
+
+
+/**
+ * Maximum backoff.
+ *
+ * The @c AG_LOCK_BACKOFF_MAX symbolic constant sets the maximum number of
+ * pause instructions issued between successive attempts to take a contended
+ * lock. The backoff doubles on each failed attempt up to this limit, after
+ * which the spinning thread also yields its processor. The default may be
+ * overridden by defining this constant before including this header.
+ */
+#if !defined AG_LOCK_BACKOFF_MAX
+#   define AG_LOCK_BACKOFF_MAX 256
+#endif
+
+
+    /* spins for the current backoff period and doubles it; once the period
+     * has reached its maximum, the processor is yielded in case the holder of
+     * the lock has been preempted */
+static inline void
+ag__lock_backoff__(ag_word_32 *backoff)
+{
+    ag_word_32 i;
+
+    for (i = 0; i < *backoff; i++)
+        ag_atomic_pause();
+
+    if (*backoff < AG_LOCK_BACKOFF_MAX)
+        *backoff <<= 1;
+    else
+        (void) sched_yield();
+}
+
+
+/**
+ * Test-and-test-and-set spinlock.
+ *
+ * The @c ag_spinlock type is a lock that waiters acquire by spinning on a read
+ * of its state, attempting an atomic exchange only once it is observed free,
+ * and backing off exponentially whenever the attempt fails. This keeps the
+ * cache line shared while the lock is held.
+ *
+ * @see AG_SPINLOCK_INIT
+ * @see ag_spinlock_acquire()
+ */
+typedef struct ag_spinlock {
+    ag_word_32 held;
+} ag_cacheline_aligned ag_spinlock;
+
+
+/**
+ * Static spinlock initialiser.
+ *
+ * The @c AG_SPINLOCK_INIT symbolic constant initialises an @c ag_spinlock
+ * object that is statically allocated.
+ *
+ * @see ag_spinlock_init()
+ */
+#define AG_SPINLOCK_INIT {0}
+
+
+/**
+ * Initialise spinlock.
+ *
+ * The @c ag_spinlock_init() function initialises a spinlock @p l in its
+ * released state.
+ *
+ * @param l Spinlock to initialise.
+ */
+static inline void
+ag_spinlock_init(ag_spinlock *l)
+{
+    ag_atomic_word_32_store_explicit(&l->held, 0, AG_ATOMIC_RELAXED);
+}
+
+
+/**
+ * Try to acquire spinlock.
+ *
+ * The @c ag_spinlock_try_acquire() function attempts to acquire a spinlock @p
+ * l without waiting.
+ *
+ * @param l Spinlock to acquire.
+ *
+ * @return @c true if @p l has been acquired.
+ */
+static inline ag_bool
+ag_spinlock_try_acquire(ag_spinlock *l)
+{
+    return !ag_atomic_word_32_load_explicit(&l->held, AG_ATOMIC_RELAXED)
+            && !ag_atomic_word_32_exchange_explicit(&l->held, 1,
+            AG_ATOMIC_ACQUIRE);
+}
+
+
+/**
+ * Acquire spinlock.
+ *
+ * The @c ag_spinlock_acquire() function acquires a spinlock @p l, spinning
+ * with exponential backoff until it is free.
+ *
+ * @param l Spinlock to acquire.
+ *
+ * @see ag_spinlock_release()
+ */
+static inline void
+ag_spinlock_acquire(ag_spinlock *l)
+{
+    ag_word_32 backoff = 1;
+
+    while (ag_unlikely (!ag_spinlock_try_acquire(l))) {
+        do {
+            ag__lock_backoff__(&backoff);
+        } while (ag_atomic_word_32_load_explicit(&l->held,
+                AG_ATOMIC_RELAXED));
+    }
+}
+
+
+/**
+ * Release spinlock.
+ *
+ * The @c ag_spinlock_release() function releases a spinlock @p l that is held
+ * by the calling thread.
+ *
+ * @param l Spinlock to release.
+ *
+ * @see ag_spinlock_acquire()
+ */
+static inline void
+ag_spinlock_release(ag_spinlock *l)
+{
+    ag_atomic_word_32_store_explicit(&l->held, 0, AG_ATOMIC_RELEASE);
+}
+
+
+/**
+ * Ticket lock.
+ *
+ * The @c ag_ticketlock type is a fair lock that hands out tickets to waiters
+ * and serves them in order. Waiters back off at least in proportion to the
+ * number of waiters ahead of them.
+ *
+ * @see AG_TICKETLOCK_INIT
+ * @see ag_ticketlock_acquire()
+ */
+typedef struct ag_ticketlock {
+    ag_word_32 next;
+    ag_word_32 serving;
+} ag_cacheline_aligned ag_ticketlock;
+
+
+/**
+ * Static ticket lock initialiser.
+ *
+ * The @c AG_TICKETLOCK_INIT symbolic constant initialises an @c ag_ticketlock
+ * object that is statically allocated.
+ *
+ * @see ag_ticketlock_init()
+ */
+#define AG_TICKETLOCK_INIT {0, 0}
+
+
+/**
+ * Initialise ticket lock.
+ *
+ * The @c ag_ticketlock_init() function initialises a ticket lock @p l in its
+ * released state.
+ *
+ * @param l Ticket lock to initialise.
+ */
+static inline void
+ag_ticketlock_init(ag_ticketlock *l)
+{
+    ag_atomic_word_32_store_explicit(&l->next, 0, AG_ATOMIC_RELAXED);
+    ag_atomic_word_32_store_explicit(&l->serving, 0, AG_ATOMIC_RELAXED);
+}
+
+
+/**
+ * Try to acquire ticket lock.
+ *
+ * The @c ag_ticketlock_try_acquire() function attempts to acquire a ticket
+ * lock @p l without waiting, which only succeeds if there are no waiters.
+ *
+ * @param l Ticket lock to acquire.
+ *
+ * @return @c true if @p l has been acquired.
+ */
+static inline ag_bool
+ag_ticketlock_try_acquire(ag_ticketlock *l)
+{
+    ag_word_32 t = ag_atomic_word_32_load_explicit(&l->serving,
+            AG_ATOMIC_RELAXED);
+
+    return ag_atomic_word_32_cas_explicit(&l->next, &t, t + 1,
+            AG_ATOMIC_ACQUIRE, AG_ATOMIC_RELAXED);
+}
+
+
+/**
+ * Acquire ticket lock.
+ *
+ * The @c ag_ticketlock_acquire() function acquires a ticket lock @p l, waiting
+ * until all threads that had called this function earlier have released it.
+ *
+ * @param l Ticket lock to acquire.
+ *
+ * @see ag_ticketlock_release()
+ */
+static inline void
+ag_ticketlock_acquire(ag_ticketlock *l)
+{
+    ag_word_32 t, s, backoff = 1;
+
+    t = ag_atomic_word_32_fetch_add_explicit(&l->next, 1, AG_ATOMIC_RELAXED);
+
+    while ((s = ag_atomic_word_32_load_explicit(&l->serving,
+            AG_ATOMIC_ACQUIRE)) != t) {
+        if (backoff < (t - s) * 8)
+            backoff = (t - s) * 8;
+        ag__lock_backoff__(&backoff);
+    }
+}
+
+
+/**
+ * Release ticket lock.
+ *
+ * The @c ag_ticketlock_release() function releases a ticket lock @p l that is
+ * held by the calling thread, passing it to the next waiter in line.
+ *
+ * @param l Ticket lock to release.
+ *
+ * @see ag_ticketlock_acquire()
+ */
+static inline void
+ag_ticketlock_release(ag_ticketlock *l)
+{
+    ag_atomic_word_32_store_explicit(&l->serving,
+            ag_atomic_word_32_load_explicit(&l->serving, AG_ATOMIC_RELAXED)
+            + 1, AG_ATOMIC_RELEASE);
+}
+
+
+/**
+ * MCS lock queue node.
+ *
+ * The @c ag_mcsnode type represents the place of a thread in the queue of an
+ * MCS lock. A node is provided by the caller, usually on its stack, and must
+ * remain valid from the call to @c ag_mcslock_acquire() until the matching
+ * call to @c ag_mcslock_release(). Each node is cache line aligned so that
+ * each waiter spins on its own cache line.
+ *
+ * @see ag_mcslock
+ */
+typedef struct ag_mcsnode {
+    struct ag_mcsnode *next;
+    ag_word_32 locked;
+} ag_cacheline_aligned ag_mcsnode;
+
+
+/**
+ * MCS queue lock.
+ *
+ * The @c ag_mcslock type is a fair lock that queues waiters in a linked list
+ * of @c ag_mcsnode nodes, with each waiter spinning on its own node until its
+ * predecessor hands the lock over. Contention therefore generates no cache
+ * line traffic beyond the hand-over itself. Waiters back off exponentially,
+ * and yield their processor once the backoff has reached its maximum, so
+ * that a preempted predecessor can make progress.
+ *
+ * @see AG_MCSLOCK_INIT
+ * @see ag_mcslock_acquire()
+ */
+typedef struct ag_mcslock {
+    ag_mcsnode *tail;
+} ag_cacheline_aligned ag_mcslock;
+
+
+/**
+ * Static MCS lock initialiser.
+ *
+ * The @c AG_MCSLOCK_INIT symbolic constant initialises an @c ag_mcslock object
+ * that is statically allocated.
+ *
+ * @see ag_mcslock_init()
+ */
+#define AG_MCSLOCK_INIT {NULL}
+
+
+/**
+ * Initialise MCS lock.
+ *
+ * The @c ag_mcslock_init() function initialises an MCS lock @p l in its
+ * released state.
+ *
+ * @param l MCS lock to initialise.
+ */
+static inline void
+ag_mcslock_init(ag_mcslock *l)
+{
+    ag_atomic_ptr_store_explicit(&l->tail, NULL, AG_ATOMIC_RELAXED);
+}
+
+
+/**
+ * Try to acquire MCS lock.
+ *
+ * The @c ag_mcslock_try_acquire() function attempts to acquire an MCS lock @p
+ * l with the queue node @p n without waiting, which only succeeds if the lock
+ * is free.
+ *
+ * @param l MCS lock to acquire.
+ * @param n Queue node of calling thread.
+ *
+ * @return @c true if @p l has been acquired.
+ */
+static inline ag_bool
+ag_mcslock_try_acquire(ag_mcslock *l, ag_mcsnode *n)
+{
+    ag_mcsnode *expect = NULL;
+
+    n->next = NULL;
+    return ag_atomic_ptr_cas_explicit(&l->tail, &expect, n,
+            AG_ATOMIC_ACQUIRE, AG_ATOMIC_RELAXED);
+}
+
+
+/**
+ * Acquire MCS lock.
+ *
+ * The @c ag_mcslock_acquire() function acquires an MCS lock @p l, enqueueing
+ * the queue node @p n of the calling thread and waiting until the lock is
+ * handed over to it.
+ *
+ * @param l MCS lock to acquire.
+ * @param n Queue node of calling thread.
+ *
+ * @see ag_mcslock_release()
+ */
+static inline void
+ag_mcslock_acquire(ag_mcslock *l, ag_mcsnode *n)
+{
+    ag_mcsnode *prev;
+    ag_word_32 backoff = 1;
+
+    n->next = NULL;
+    ag_atomic_word_32_store_explicit(&n->locked, 1, AG_ATOMIC_RELAXED);
+
+    prev = ag_atomic_ptr_exchange_explicit(&l->tail, n, AG_ATOMIC_ACQ_REL);
+    if (ag_likely (!prev))
+        return;
+
+    ag_atomic_ptr_store_explicit(&prev->next, n, AG_ATOMIC_RELEASE);
+    while (ag_atomic_word_32_load_explicit(&n->locked, AG_ATOMIC_ACQUIRE))
+        ag__lock_backoff__(&backoff);
+}
+
+
+/**
+ * Release MCS lock.
+ *
+ * The @c ag_mcslock_release() function releases an MCS lock @p l that is held
+ * by the calling thread through the queue node @p n, handing it over to the
+ * next waiter in the queue if there is one.
+ *
+ * @param l MCS lock to release.
+ * @param n Queue node of calling thread.
+ *
+ * @see ag_mcslock_acquire()
+ */
+static inline void
+ag_mcslock_release(ag_mcslock *l, ag_mcsnode *n)
+{
+    ag_mcsnode *next, *expect = n;
+
+    next = ag_atomic_ptr_load_explicit(&n->next, AG_ATOMIC_ACQUIRE);
+    if (ag_likely (!next)) {
+        if (ag_atomic_ptr_cas_explicit(&l->tail, &expect, NULL,
+                AG_ATOMIC_RELEASE, AG_ATOMIC_RELAXED))
+            return;
+
+            /* a successor is enqueueing itself, so wait for it to link */
+        while (!(next = ag_atomic_ptr_load_explicit(&n->next,
+                AG_ATOMIC_ACQUIRE)))
+            ag_atomic_pause();
+    }
+
+    ag_atomic_word_32_store_explicit(&next->locked, 0, AG_ATOMIC_RELEASE);
+}
+
+
+/**
+ * @example lock.h
+ * This is an example showing how to code against the Argent Core Lock Module
+ * interface.
+ * @}
+ */
+
+
+#endif /* !defined ARGENT_CORE_LOCK */
@@ -0,0 +1,1052 @@
+#if !defined ARGENT_CORE_LOOP
+#define ARGENT_CORE_LOOP
+
+
+/**************************************************************************//**
+ * @defgroup loop Argent Core Loop Module
+ * Edge-triggered event loop.
+ *
+ * The Loop Module provides a single-threaded event loop over epoll, for
+ * socket and pipe I/O. File descriptors are watched in edge-triggered mode,
+ * so that the kernel reports each change of readiness once rather than on
+ * every wait; callbacks must therefore read or write until the operation
+ * would block. Along with I/O readiness, the loop runs timers, kept in a
+ * binary heap whose earliest deadline bounds each wait, and tasks posted from
+ * other threads.
+ *
+ * Other threads wake a loop through an eventfd. Wake-ups are coalesced, so
+ * that however many tasks are posted while a loop is busy, at most one write
+ * to its eventfd is made until the loop next drains its tasks; this avoids
+ * the wake-up storms that arise when every producer signals the loop.
+ *
+ * Loops scale across processors by running one loop per core, each on its own
+ * thread pinned to that core, with connections spread across the loops, for
+ * instance through @c SO_REUSEPORT listening sockets. Loop groups set up such
+ * instances.
+ *
+ * @note This module is specific to Linux, and requires the GNU C dialect or
+ * @c _GNU_SOURCE to be defined; client code must be linked with @c -pthread.
+ *
+ * @warning Except for @c ag_loop_post(), @c ag_loop_wake() and @c
+ * ag_loop_stop(), the functions of this module must only be called on the
+ * thread running the loop.
+ * @{
+ */
+
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include "atomic.h"
+
+
+/**
+ * Event batch size.
+ *
+ * The @c AG_LOOP_EVENTS symbolic constant sets the maximum number of events
+ * that a loop takes from the kernel on each wait. The default may be
+ * overridden by defining this constant before including this header.
+ */
+#if !defined AG_LOOP_EVENTS
+#   define AG_LOOP_EVENTS 64
+#endif
+
+
+/**
+ * Read readiness.
+ *
+ * The @c AG_LOOP_READ symbolic constant flags that a file descriptor is
+ * watched for, or has become ready for, reading; this includes the peer
+ * closing its end of the connection.
+ */
+#define AG_LOOP_READ (EPOLLIN | EPOLLRDHUP)
+
+
+/**
+ * Write readiness.
+ *
+ * The @c AG_LOOP_WRITE symbolic constant flags that a file descriptor is
+ * watched for, or has become ready for, writing.
+ */
+#define AG_LOOP_WRITE EPOLLOUT
+
+
+/**
+ * Error condition.
+ *
+ * The @c AG_LOOP_ERROR symbolic constant flags that an error or hang-up has
+ * occurred on a file descriptor. It is always reported, whether or not it is
+ * watched for.
+ */
+#define AG_LOOP_ERROR (EPOLLERR | EPOLLHUP)
+
+
+struct ag_loop;
+struct ag_loop_watch;
+struct ag_loop_timer;
+struct ag_loop_task;
+
+
+/**
+ * I/O callback.
+ *
+ * The @c ag_loop_io_fn type is the signature of the function called when a
+ * watched file descriptor becomes ready.
+ *
+ * @param w Watch of file descriptor.
+ * @param events Readiness flags, a combination of @c AG_LOOP_READ, @c
+ * AG_LOOP_WRITE and @c AG_LOOP_ERROR.
+ *
+ * @see ag_loop_add()
+ */
+typedef void (*ag_loop_io_fn)(struct ag_loop_watch *w, ag_word_32 events);
+
+
+/**
+ * Timer callback.
+ *
+ * The @c ag_loop_timer_fn type is the signature of the function called when a
+ * timer expires.
+ *
+ * @param t Expired timer.
+ *
+ * @see ag_loop_timer_start()
+ */
+typedef void (*ag_loop_timer_fn)(struct ag_loop_timer *t);
+
+
+/**
+ * Task callback.
+ *
+ * The @c ag_loop_task_fn type is the signature of a function posted to run on
+ * a loop.
+ *
+ * @param t Posted task.
+ *
+ * @see ag_loop_post()
+ */
+typedef void (*ag_loop_task_fn)(struct ag_loop_task *t);
+
+
+/**
+ * File descriptor watch.
+ *
+ * The @c ag_loop_watch type describes a file descriptor watched by a loop. It
+ * is provided by the caller, and must remain valid while it is watched. The
+ * @c ctx member is free for use by the caller.
+ *
+ * @see ag_loop_add()
+ */
+typedef struct ag_loop_watch {
+    ag_loop_io_fn fn;
+    void *ctx;
+    struct ag_loop *loop;
+    int fd;
+    ag_word_32 events;
+} ag_loop_watch;
+
+
+/**
+ * Timer.
+ *
+ * The @c ag_loop_timer type describes a one-shot or periodic timer. It is
+ * provided by the caller, must be initialised through @c AG_LOOP_TIMER_INIT,
+ * and must remain valid while it is started. The @c ctx member is free for
+ * use by the caller.
+ *
+ * @see AG_LOOP_TIMER_INIT
+ * @see ag_loop_timer_start()
+ */
+typedef struct ag_loop_timer {
+    ag_loop_timer_fn fn;
+    void *ctx;
+    struct ag_loop *loop;
+    ag_word_64 due;
+    ag_word_64 period;
+    ag_size slot;
+} ag_loop_timer;
+
+
+/**
+ * Static timer initialiser.
+ *
+ * The @c AG_LOOP_TIMER_INIT symbolic constant initialises an @c ag_loop_timer
+ * object in its stopped state.
+ */
+#define AG_LOOP_TIMER_INIT {NULL, NULL, NULL, 0, 0, 0}
+
+
+/**
+ * Posted task.
+ *
+ * The @c ag_loop_task type describes a function posted to run on a loop from
+ * any thread. It is provided by the caller, and must remain valid until it
+ * has run. The @c ctx member is free for use by the caller.
+ *
+ * @see ag_loop_post()
+ */
+typedef struct ag_loop_task {
+    ag_loop_task_fn fn;
+    void *ctx;
+    struct ag_loop_task *next;
+} ag_loop_task;
+
+
+/**
+ * Event loop.
+ *
+ * The @c ag_loop type is an event loop. Loops are created through @c
+ * ag_loop_create().
+ *
+ * @see ag_loop_create()
+ */
+typedef struct ag_loop {
+    int epfd;
+    int evfd;
+    ag_word_64 now;
+    ag_loop_timer **heap;
+    ag_size ntimers;
+    ag_size cap;
+    struct epoll_event events[AG_LOOP_EVENTS];
+    int nevents;
+    int cursor;
+    ag_bool firing;
+    ag_cacheline_aligned ag_loop_task *tasks;
+    ag_word_32 awake;
+    ag_word_32 stop;
+} ag_loop;
+
+
+static inline ag_word_64
+ag__loop_clock__(void)
+{
+    struct timespec ts;
+
+    (void) clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ag_word_64) ts.tv_sec * 1000 + (ag_word_64) ts.tv_nsec / 1000000;
+}
+
+
+static inline void
+ag__loop_heap_set__(ag_loop *l, ag_size i, ag_loop_timer *t)
+{
+    l->heap[i] = t;
+    t->slot = i;
+}
+
+
+static inline void
+ag__loop_heap_up__(ag_loop *l, ag_size i)
+{
+    ag_loop_timer *t = l->heap[i];
+    ag_size parent;
+
+    while (i) {
+        parent = (i - 1) / 2;
+        if (l->heap[parent]->due <= t->due)
+            break;
+
+        ag__loop_heap_set__(l, i, l->heap[parent]);
+        i = parent;
+    }
+
+    ag__loop_heap_set__(l, i, t);
+}
+
+
+static inline void
+ag__loop_heap_down__(ag_loop *l, ag_size i)
+{
+    ag_loop_timer *t = l->heap[i];
+    ag_size child;
+
+    while ((child = 2 * i + 1) < l->ntimers) {
+        if (child + 1 < l->ntimers
+                && l->heap[child + 1]->due < l->heap[child]->due)
+            child++;
+        if (t->due <= l->heap[child]->due)
+            break;
+
+        ag__loop_heap_set__(l, i, l->heap[child]);
+        i = child;
+    }
+
+    ag__loop_heap_set__(l, i, t);
+}
+
+
+static inline void
+ag__loop_heap_remove__(ag_loop *l, ag_size i)
+{
+    ag_loop_timer *last = l->heap[--l->ntimers];
+
+    l->heap[i]->slot = (ag_size) -1;
+    if (i == l->ntimers)
+        return;
+
+    ag__loop_heap_set__(l, i, last);
+    ag__loop_heap_up__(l, i);
+    ag__loop_heap_down__(l, last->slot);
+}
+
+
+/**
+ * Create loop.
+ *
+ * The @c ag_loop_create() function creates an event loop @p l, along with its
+ * epoll instance and its eventfd.
+ *
+ * @param l Loop to create.
+ *
+ * @return AG_ERNO_NULL if the loop has been created.
+ * @return AG_ERNO_HANDLE if @p l is a null pointer.
+ * @return AG_ERNO_MEMORY if the loop could not be allocated.
+ * @return AG_ERNO_SYSTEM if the epoll instance or the eventfd could not be
+ * created.
+ *
+ * @see ag_loop_destroy()
+ */
+static inline ag_erno
+ag_loop_create(ag_loop **l)
+{
+    struct epoll_event ev;
+    ag_loop *loop = NULL;
+
+AG_TRY:
+    ag_assert_handle(l);
+
+    loop = (ag_loop *) aligned_alloc(AG_CACHELINE_SIZE, sizeof *loop);
+    ag_assert(loop, AG_ERNO_MEMORY);
+
+    loop->evfd = -1;
+    loop->heap = NULL;
+    loop->ntimers = loop->cap = 0;
+    loop->nevents = loop->cursor = 0;
+    loop->firing = false;
+    loop->tasks = NULL;
+    loop->awake = loop->stop = 0;
+    loop->now = ag__loop_clock__();
+
+    loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+    ag_assert(loop->epfd >= 0, AG_ERNO_SYSTEM);
+
+    loop->evfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    ag_assert(loop->evfd >= 0, AG_ERNO_SYSTEM);
+
+        /* the eventfd is identified by a null watch */
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = NULL;
+    ag_assert(!epoll_ctl(loop->epfd, EPOLL_CTL_ADD, loop->evfd, &ev),
+            AG_ERNO_SYSTEM);
+
+    *l = loop;
+
+AG_CATCH:
+    if (loop) {
+        if (loop->evfd >= 0)
+            (void) close(loop->evfd);
+        if (loop->epfd >= 0)
+            (void) close(loop->epfd);
+        free(loop);
+    }
+
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Destroy loop.
+ *
+ * The @c ag_loop_destroy() function releases a loop @p l. File descriptors
+ * that are still watched are not closed, and tasks still posted are not run.
+ *
+ * @param l Loop to destroy; may be a null pointer.
+ *
+ * @see ag_loop_create()
+ */
+static inline void
+ag_loop_destroy(ag_loop *l)
+{
+    if (ag_unlikely (!l))
+        return;
+
+    (void) close(l->evfd);
+    (void) close(l->epfd);
+    free(l->heap);
+    free(l);
+}
+
+
+/**
+ * Get loop time.
+ *
+ * The @c ag_loop_now() function gets the time of a loop @p l, in milliseconds
+ * of the monotonic clock, as cached at the start of its current iteration.
+ *
+ * @param l Loop to query.
+ *
+ * @return Loop time in milliseconds.
+ */
+static inline ag_word_64
+ag_loop_now(const ag_loop *l)
+{
+    return l->now;
+}
+
+
+/**
+ * Watch file descriptor.
+ *
+ * The @c ag_loop_add() function starts watching a file descriptor @p fd on a
+ * loop @p l for the readiness flags @p events, in edge-triggered mode, through
+ * the watch @p w. The callback @p fn is called whenever @p fd becomes ready,
+ * and must read or write until the operation would block, as it is not called
+ * again until the readiness of @p fd changes. The file descriptor should be
+ * in non-blocking mode.
+ *
+ * @param l Loop to watch on.
+ * @param w Watch to start.
+ * @param fd File descriptor to watch.
+ * @param events Combination of @c AG_LOOP_READ and @c AG_LOOP_WRITE.
+ * @param fn I/O callback.
+ *
+ * @return AG_ERNO_NULL if @p fd is being watched.
+ * @return AG_ERNO_HANDLE if @p l, @p w or @p fn is a null pointer.
+ * @return AG_ERNO_SYSTEM if @p fd could not be added to the epoll instance.
+ *
+ * @see ag_loop_del()
+ */
+static inline ag_erno
+ag_loop_add(ag_loop *l, ag_loop_watch *w, int fd, ag_word_32 events,
+        ag_loop_io_fn fn)
+{
+    struct epoll_event ev;
+
+AG_TRY:
+    ag_assert_handle(l && w && fn);
+
+    w->fn = fn;
+    w->loop = l;
+    w->fd = fd;
+    w->events = events;
+
+    ev.events = events | EPOLLET;
+    ev.data.ptr = w;
+    ag_assert(!epoll_ctl(l->epfd, EPOLL_CTL_ADD, fd, &ev), AG_ERNO_SYSTEM);
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Change watched events.
+ *
+ * The @c ag_loop_mod() function changes the readiness flags @p events that
+ * the watch @p w is watching for. Current readiness is reported anew, as
+ * though it had just changed.
+ *
+ * @param w Watch to change.
+ * @param events Combination of @c AG_LOOP_READ and @c AG_LOOP_WRITE.
+ *
+ * @return AG_ERNO_NULL if the watch has been changed.
+ * @return AG_ERNO_HANDLE if @p w is a null pointer.
+ * @return AG_ERNO_SYSTEM if the epoll instance could not be updated.
+ *
+ * @see ag_loop_add()
+ */
+static inline ag_erno
+ag_loop_mod(ag_loop_watch *w, ag_word_32 events)
+{
+    struct epoll_event ev;
+
+AG_TRY:
+    ag_assert_handle(w);
+
+    ev.events = events | EPOLLET;
+    ev.data.ptr = w;
+    ag_assert(!epoll_ctl(w->loop->epfd, EPOLL_CTL_MOD, w->fd, &ev),
+            AG_ERNO_SYSTEM);
+    w->events = events;
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Stop watching file descriptor.
+ *
+ * The @c ag_loop_del() function stops watching the file descriptor of the
+ * watch @p w. Events already taken from the kernel for @p w are discarded, so
+ * that the watch may be released as soon as this function returns, even from
+ * within a callback.
+ *
+ * @param w Watch to stop.
+ *
+ * @return AG_ERNO_NULL if the watch has been stopped.
+ * @return AG_ERNO_HANDLE if @p w is a null pointer.
+ * @return AG_ERNO_SYSTEM if the epoll instance could not be updated.
+ *
+ * @see ag_loop_add()
+ */
+static inline ag_erno
+ag_loop_del(ag_loop_watch *w)
+{
+    ag_loop *l;
+    int i;
+
+AG_TRY:
+    ag_assert_handle(w);
+
+    l = w->loop;
+    for (i = l->cursor; i < l->nevents; i++) {
+        if (l->events[i].data.ptr == w)
+            l->events[i].events = 0;
+    }
+
+    ag_assert(!epoll_ctl(l->epfd, EPOLL_CTL_DEL, w->fd, NULL),
+            AG_ERNO_SYSTEM);
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+    /* adds a delay to a time, saturating rather than wrapping so that an
+     * overlong delay leaves the timer due in the far future */
+static inline ag_word_64
+ag__loop_due__(ag_word_64 now, ag_word_64 delay)
+{
+    return delay > UINT64_MAX - now ? UINT64_MAX : now + delay;
+}
+
+
+/**
+ * Start timer.
+ *
+ * The @c ag_loop_timer_start() function starts a timer @p t on a loop @p l,
+ * which calls @p fn once @p delay milliseconds have elapsed, and then every
+ * @p period milliseconds if @p period is not zero. Starting a timer that is
+ * already started restarts it. A timer started from a timer callback with no
+ * delay fires on a later iteration, one millisecond later.
+ *
+ * @param l Loop to start timer on.
+ * @param t Timer to start.
+ * @param delay Delay in milliseconds before first expiry.
+ * @param period Period in milliseconds, or zero for a one-shot timer.
+ * @param fn Timer callback.
+ *
+ * @return AG_ERNO_NULL if the timer has been started.
+ * @return AG_ERNO_HANDLE if @p l, @p t or @p fn is a null pointer.
+ * @return AG_ERNO_MEMORY if the timer heap could not be grown.
+ *
+ * @see ag_loop_timer_stop()
+ */
+static inline ag_erno
+ag_loop_timer_start(ag_loop *l, ag_loop_timer *t, ag_word_64 delay,
+        ag_word_64 period, ag_loop_timer_fn fn)
+{
+    ag_loop_timer **heap;
+    ag_size cap;
+
+AG_TRY:
+    ag_assert_handle(l && t && fn);
+
+    if (t->loop == l && t->slot < l->ntimers && l->heap[t->slot] == t)
+        ag__loop_heap_remove__(l, t->slot);
+
+    if (l->ntimers == l->cap) {
+        cap = l->cap ? l->cap * 2 : 16;
+        heap = (ag_loop_timer **) realloc(l->heap, cap * sizeof *heap);
+        ag_assert(heap, AG_ERNO_MEMORY);
+
+        l->heap = heap;
+        l->cap = cap;
+    }
+
+    t->fn = fn;
+    t->loop = l;
+    t->due = ag__loop_due__(l->now, delay);
+
+        /* a timer started by a timer callback is not due before the next pass,
+         * so that a timer restarting itself cannot keep the loop firing it */
+    if (l->firing && t->due <= l->now)
+        t->due = l->now + 1;
+    t->period = period;
+
+    l->heap[l->ntimers] = t;
+    ag__loop_heap_up__(l, l->ntimers++);
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Stop timer.
+ *
+ * The @c ag_loop_timer_stop() function stops a timer @p t, if it is started.
+ * A timer may stop itself from within its callback.
+ *
+ * @param t Timer to stop.
+ *
+ * @see ag_loop_timer_start()
+ */
+static inline void
+ag_loop_timer_stop(ag_loop_timer *t)
+{
+    ag_loop *l;
+
+    if (ag_unlikely (!t || !(l = t->loop)))
+        return;
+
+    if (t->slot < l->ntimers && l->heap[t->slot] == t)
+        ag__loop_heap_remove__(l, t->slot);
+
+    t->period = 0;
+}
+
+
+/**
+ * Wake loop.
+ *
+ * The @c ag_loop_wake() function wakes a loop @p l from its wait, from any
+ * thread. Wake-ups are coalesced, so that only the first call made since the
+ * loop last woke up writes to its eventfd.
+ *
+ * @param l Loop to wake.
+ *
+ * @see ag_loop_post()
+ */
+static inline void
+ag_loop_wake(ag_loop *l)
+{
+    ag_word_64 one = 1;
+
+    if (!ag_atomic_word_32_exchange_explicit(&l->awake, 1, AG_ATOMIC_ACQ_REL))
+        (void) !write(l->evfd, &one, sizeof one);
+}
+
+
+/**
+ * Post task.
+ *
+ * The @c ag_loop_post() function posts a task @p t to run @p fn on a loop @p
+ * l, from any thread, and wakes the loop. Tasks run in the order in which
+ * they were posted.
+ *
+ * @param l Loop to post task to.
+ * @param t Task to post.
+ * @param fn Task callback.
+ *
+ * @see ag_loop_wake()
+ */
+static inline void
+ag_loop_post(ag_loop *l, ag_loop_task *t, ag_loop_task_fn fn)
+{
+    ag_loop_task *head = (ag_loop_task *) ag_atomic_ptr_load_explicit(
+            &l->tasks, AG_ATOMIC_RELAXED);
+
+    t->fn = fn;
+    do {
+        t->next = head;
+    } while (!ag_atomic_ptr_cas_weak_explicit(&l->tasks, &head, t,
+            AG_ATOMIC_RELEASE, AG_ATOMIC_RELAXED));
+
+    ag_loop_wake(l);
+}
+
+
+/**
+ * Stop loop.
+ *
+ * The @c ag_loop_stop() function makes @c ag_loop_run() return once the
+ * current iteration of a loop @p l is done, from any thread.
+ *
+ * @param l Loop to stop.
+ *
+ * @see ag_loop_run()
+ */
+static inline void
+ag_loop_stop(ag_loop *l)
+{
+    ag_atomic_word_32_store_explicit(&l->stop, 1, AG_ATOMIC_RELEASE);
+    ag_loop_wake(l);
+}
+
+
+    /* runs the tasks posted to a loop in the order in which they were posted,
+     * re-arming wake-ups first so that a task posted meanwhile is not lost */
+static inline void
+ag__loop_tasks__(ag_loop *l)
+{
+    ag_loop_task *t, *list, *next;
+    ag_word_64 count;
+
+    (void) !read(l->evfd, &count, sizeof count);
+    ag_atomic_word_32_store_explicit(&l->awake, 0, AG_ATOMIC_SEQ_CST);
+
+    list = (ag_loop_task *) ag_atomic_ptr_exchange_explicit(&l->tasks, NULL,
+            AG_ATOMIC_ACQUIRE);
+    for (t = NULL; list; list = next) {
+        next = list->next;
+        list->next = t;
+        t = list;
+    }
+
+    for (; t; t = next) {
+        next = t->next;
+        t->fn(t);
+    }
+}
+
+
+static inline void
+ag__loop_timers__(ag_loop *l)
+{
+    ag_loop_timer *t;
+
+    l->firing = true;
+    while (l->ntimers && (t = l->heap[0])->due <= l->now) {
+        if (t->period) {
+            t->due = ag__loop_due__(t->due, t->period);
+            if (t->due <= l->now)
+                t->due = ag__loop_due__(l->now, t->period);
+            ag__loop_heap_down__(l, 0);
+        } else
+            ag__loop_heap_remove__(l, 0);
+
+        t->fn(t);
+    }
+    l->firing = false;
+}
+
+
+/**
+ * Run one iteration.
+ *
+ * The @c ag_loop_run_once() function runs one iteration of a loop @p l: it
+ * waits for I/O readiness, a posted task or the earliest timer, for at most
+ * @p timeout milliseconds, and then runs the callbacks that are due.
+ *
+ * @param l Loop to run.
+ * @param timeout Maximum wait in milliseconds, or -1 to wait until an event
+ * occurs.
+ *
+ * @return AG_ERNO_NULL if the iteration has run.
+ * @return AG_ERNO_HANDLE if @p l is a null pointer.
+ * @return AG_ERNO_SYSTEM if waiting on the epoll instance failed.
+ *
+ * @see ag_loop_run()
+ */
+static inline ag_erno
+ag_loop_run_once(ag_loop *l, int timeout)
+{
+    ag_loop_watch *w;
+    ag_word_64 due;
+    int n;
+
+AG_TRY:
+    ag_assert_handle(l);
+
+    if (l->ntimers) {
+        due = l->heap[0]->due;
+        due = due > l->now ? due - l->now : 0;
+        if (due > INT_MAX)
+            due = INT_MAX;
+        if (timeout < 0 || due < (ag_word_64) timeout)
+            timeout = (int) due;
+    }
+
+    n = epoll_wait(l->epfd, l->events, AG_LOOP_EVENTS, timeout);
+    ag_assert(n >= 0 || errno == EINTR, AG_ERNO_SYSTEM);
+
+    l->now = ag__loop_clock__();
+    l->nevents = n > 0 ? n : 0;
+
+    for (l->cursor = 0; l->cursor < l->nevents; ) {
+        w = (ag_loop_watch *) l->events[l->cursor].data.ptr;
+        n = (int) l->events[l->cursor++].events;
+
+        if (!w)
+            ag__loop_tasks__(l);
+        else if (n)
+            w->fn(w, (ag_word_32) n);
+    }
+
+    l->nevents = l->cursor = 0;
+    ag__loop_timers__(l);
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Run loop.
+ *
+ * The @c ag_loop_run() function runs a loop @p l on the calling thread until
+ * it is stopped through @c ag_loop_stop().
+ *
+ * @param l Loop to run.
+ *
+ * @return AG_ERNO_NULL if the loop has been stopped.
+ * @return AG_ERNO_HANDLE if @p l is a null pointer.
+ * @return AG_ERNO_SYSTEM if waiting on the epoll instance failed.
+ *
+ * @see ag_loop_stop()
+ */
+static inline ag_erno
+ag_loop_run(ag_loop *l)
+{
+AG_TRY:
+    ag_assert_handle(l);
+
+    while (!ag_atomic_word_32_load_explicit(&l->stop, AG_ATOMIC_ACQUIRE))
+        ag_try(ag_loop_run_once(l, -1));
+
+    l->stop = 0;
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Loop initialiser.
+ *
+ * The @c ag_loop_init_fn type is the signature of the function called on the
+ * thread of each loop of a group before it starts running, typically to open
+ * its listening sockets and watch them.
+ *
+ * @param l Loop to initialise.
+ * @param index Index of loop within its group.
+ * @param ctx Context passed to @c ag_loop_group_create().
+ *
+ * @return AG_ERNO_NULL if the loop has been initialised, or an error code to
+ * fail the creation of the group.
+ *
+ * @see ag_loop_group_create()
+ */
+typedef ag_erno (*ag_loop_init_fn)(ag_loop *l, ag_index index, void *ctx);
+
+
+struct ag__loop_member__ {
+    ag_loop *loop;
+    pthread_t thread;
+    ag_index index;
+    ag_loop_init_fn init;
+    void *ctx;
+    ag_erno erno;
+    ag_word_32 ready;
+};
+
+
+/**
+ * Loop group.
+ *
+ * The @c ag_loop_group type is a group of loops, each running on its own
+ * thread pinned to a processor. Loop groups are created through @c
+ * ag_loop_group_create().
+ *
+ * @see ag_loop_group_create()
+ */
+typedef struct ag_loop_group {
+    struct ag__loop_member__ *members;
+    ag_size n;
+} ag_loop_group;
+
+
+static inline void *
+ag__loop_member_main__(void *arg)
+{
+    struct ag__loop_member__ *m = (struct ag__loop_member__ *) arg;
+    ag_erno e = m->init ? m->init(m->loop, m->index, m->ctx) : AG_ERNO_NULL;
+
+    m->erno = e;
+    ag_atomic_word_32_store_explicit(&m->ready, 1, AG_ATOMIC_RELEASE);
+
+    if (!e)
+        (void) ag_loop_run(m->loop);
+
+    return NULL;
+}
+
+
+/**
+ * Destroy loop group.
+ *
+ * The @c ag_loop_group_destroy() function stops the loops of a group @p g,
+ * joins their threads, and releases them.
+ *
+ * @param g Loop group to destroy; may be a null pointer.
+ *
+ * @see ag_loop_group_create()
+ */
+static inline void
+ag_loop_group_destroy(ag_loop_group *g)
+{
+    ag_index i;
+
+    if (ag_unlikely (!g))
+        return;
+
+    for (i = 0; i < g->n; i++)
+        ag_loop_stop(g->members[i].loop);
+
+    for (i = 0; i < g->n; i++) {
+        (void) pthread_join(g->members[i].thread, NULL);
+        ag_loop_destroy(g->members[i].loop);
+    }
+
+    free(g->members);
+    free(g);
+}
+
+
+/**
+ * Create loop group.
+ *
+ * The @c ag_loop_group_create() function creates a group @p g of @p n loops,
+ * each running on its own thread pinned to the processor @c i modulo the
+ * number of processors that the calling thread may run on, taken in order,
+ * where @c i is the index of the loop. If @p n is zero, then one loop is
+ * created for each of these processors. If the processors cannot be queried,
+ * then the threads are not pinned. The function @p init is called on the
+ * thread of each loop before it starts running.
+ *
+ * @param g Loop group to create.
+ * @param n Number of loops, or zero.
+ * @param init Loop initialiser; may be a null pointer.
+ * @param ctx Context passed to @p init.
+ *
+ * @return AG_ERNO_NULL if the group has been created.
+ * @return AG_ERNO_HANDLE if @p g is a null pointer.
+ * @return AG_ERNO_MEMORY if the group could not be allocated.
+ * @return AG_ERNO_SYSTEM if a loop or its thread could not be created.
+ * @return The first error code returned by @p init otherwise.
+ *
+ * @see ag_loop_group_destroy()
+ */
+static inline ag_erno
+ag_loop_group_create(ag_loop_group **g, ag_size n, ag_loop_init_fn init,
+        void *ctx)
+{
+    ag_loop_group *grp = NULL;
+    struct ag__loop_member__ *m;
+    pthread_attr_t attr;
+    cpu_set_t allowed, cpus;
+    ag_size count = 0, k;
+    int cpu;
+    ag_index i;
+
+AG_TRY:
+    ag_assert_handle(g);
+
+        /* loops are pinned to the processors allowed by the affinity mask
+         * of the caller, which may be restricted by a cpuset or taskset */
+    if (!sched_getaffinity(0, sizeof allowed, &allowed))
+        count = (ag_size) CPU_COUNT(&allowed);
+    if (!n)
+        n = count ? count : 1;
+
+    grp = (ag_loop_group *) malloc(sizeof *grp);
+    ag_assert(grp, AG_ERNO_MEMORY);
+
+    grp->n = 0;
+    grp->members = (struct ag__loop_member__ *) calloc(n,
+            sizeof *grp->members);
+    ag_assert(grp->members, AG_ERNO_MEMORY);
+
+    for (i = 0; i < n; i++) {
+        m = &grp->members[i];
+        ag_try(ag_loop_create(&m->loop));
+
+        m->index = i;
+        m->init = init;
+        m->ctx = ctx;
+
+        ag_assert(!pthread_attr_init(&attr), AG_ERNO_SYSTEM);
+        if (count) {
+            for (cpu = 0, k = i % count + 1; ; cpu++) {
+                if (CPU_ISSET(cpu, &allowed) && !--k)
+                    break;
+            }
+
+            CPU_ZERO(&cpus);
+            CPU_SET(cpu, &cpus);
+            (void) pthread_attr_setaffinity_np(&attr, sizeof cpus, &cpus);
+        }
+        errno = pthread_create(&m->thread, &attr, ag__loop_member_main__, m);
+        (void) pthread_attr_destroy(&attr);
+
+        if (errno) {
+            ag_loop_destroy(m->loop);
+            ag_assert(false, AG_ERNO_SYSTEM);
+        }
+
+        grp->n++;
+    }
+
+        /* the group is only handed out once all loops are initialised */
+    for (i = 0; i < n; i++) {
+        m = &grp->members[i];
+        while (!ag_atomic_word_32_load_explicit(&m->ready, AG_ATOMIC_ACQUIRE))
+            (void) sched_yield();
+        ag_try(m->erno);
+    }
+
+    *g = grp;
+
+AG_CATCH:
+    if (grp && grp->members)
+        ag_loop_group_destroy(grp);
+    else
+        free(grp);
+
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Get loop of group.
+ *
+ * The @c ag_loop_group_get() function gets the loop with index @p i in a group
+ * @p g.
+ *
+ * @param g Loop group.
+ * @param i Index of loop, less than the size of @p g.
+ *
+ * @return Loop with index @p i.
+ */
+static inline ag_loop *
+ag_loop_group_get(const ag_loop_group *g, ag_index i)
+{
+    return g->members[i].loop;
+}
+
+
+/**
+ * @example loop.h
+ * This is an example showing how to code against the Argent Core Loop Module
+ * interface.
+ * @}
+ */
+
+
+#endif /* !defined ARGENT_CORE_LOOP */
@@ -0,0 +1,304 @@
+#if !defined ARGENT_CORE_MMAP
+#define ARGENT_CORE_MMAP
+
+
+/**************************************************************************//**
+ * @defgroup mmap Argent Core Mmap Module
+ * Memory-mapped file reader.
+ *
+ * The Mmap Module maps a file read-only into memory, and exposes its contents
+ * as a string view, so that the file may be read directly from the page cache
+ * instead of being copied into buffers through @c read() or @c fread(). The
+ * contents may then be split into lines or delimited records, each of which is
+ * itself a view into the mapping.
+ *
+ * Mappings may be given hints to tune how the kernel pages them in: sequential
+ * access, which enables aggressive readahead and early reclaim of pages once
+ * they have been read; immediate readahead of the whole file; and transparent
+ * huge pages, which reduce TLB misses when scanning large files on kernels
+ * that support huge pages for the page cache. Hints that the kernel does not
+ * support are silently ignored.
+ *
+ * @note This module is specific to Linux, and requires the GNU C dialect or
+ * @c _GNU_SOURCE to be defined.
+ *
+ * @warning The views into a mapping remain valid only until it is closed. A
+ * file that is truncated by another process while it is mapped causes a @c
+ * SIGBUS signal when the missing part is read.
+ * @{
+ */
+
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "core.h"
+
+
+/**
+ * Sequential access hint.
+ *
+ * The @c AG_MMAP_SEQUENTIAL symbolic constant flags that a mapping will be
+ * read sequentially.
+ *
+ * @see ag_mmap_open()
+ */
+#define AG_MMAP_SEQUENTIAL 0x1
+
+
+/**
+ * Immediate readahead hint.
+ *
+ * The @c AG_MMAP_WILLNEED symbolic constant flags that the whole of a mapping
+ * will be needed soon, and should be read ahead immediately.
+ *
+ * @see ag_mmap_open()
+ */
+#define AG_MMAP_WILLNEED 0x2
+
+
+/**
+ * Huge page hint.
+ *
+ * The @c AG_MMAP_HUGE symbolic constant requests that a mapping be aligned to
+ * the huge page size, and backed by transparent huge pages where the kernel
+ * supports them.
+ *
+ * @see ag_mmap_open()
+ * @see AG_MMAP_HUGE_SIZE
+ */
+#define AG_MMAP_HUGE 0x4
+
+
+/**
+ * Huge page size.
+ *
+ * The @c AG_MMAP_HUGE_SIZE symbolic constant sets the alignment of mappings
+ * requesting huge pages. The default is the size of transparent huge pages on
+ * x86-64 and most aarch64 configurations, and may be overridden by defining
+ * this constant before including this header.
+ */
+#if !defined AG_MMAP_HUGE_SIZE
+#   define AG_MMAP_HUGE_SIZE (2 * 1024 * 1024)
+#endif
+
+
+/**
+ * Memory-mapped file.
+ *
+ * The @c ag_mmap type holds a read-only mapping of a file. Its contents are
+ * available through the @p view member.
+ *
+ * @see ag_mmap_open()
+ * @see ag_mmap_view()
+ */
+typedef struct ag_mmap {
+    ag_string_view view;
+    void *base;
+    ag_size span;
+} ag_mmap;
+
+
+/**
+ * Open mapped file.
+ *
+ * The @c ag_mmap_open() function maps the regular file at @p path read-only
+ * into @p m, applying the access hints in @p flags. The file descriptor is not
+ * kept open once the file has been mapped. An empty file yields an empty view,
+ * without a mapping.
+ *
+ * @param m Mapping to open.
+ * @param path Path of the file to map.
+ * @param flags Zero or more of @c AG_MMAP_SEQUENTIAL, @c AG_MMAP_WILLNEED and
+ * @c AG_MMAP_HUGE.
+ *
+ * @return AG_ERNO_NULL if the file has been mapped.
+ * @return AG_ERNO_HANDLE if @p m or @p path is a null pointer.
+ * @return AG_ERNO_STATE if @p path does not refer to a regular file.
+ * @return AG_ERNO_SYSTEM if the file could not be opened or mapped.
+ *
+ * @see ag_mmap_close()
+ */
+static inline ag_erno
+ag_mmap_open(ag_mmap *m, const char *path, int flags)
+{
+    struct stat st;
+    ag_size len, span = 0;
+    void *base = MAP_FAILED, *p;
+    int fd = -1;
+
+AG_TRY:
+    ag_assert_handle(m && path);
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    ag_assert(fd >= 0, AG_ERNO_SYSTEM);
+    ag_assert(!fstat(fd, &st), AG_ERNO_SYSTEM);
+    ag_assert_state(S_ISREG(st.st_mode));
+
+    len = (ag_size) st.st_size;
+    m->view.str = "";
+    m->view.len = 0;
+    m->base = NULL;
+    m->span = 0;
+
+    if (len) {
+            /* a huge page mapping is placed at an aligned address within a
+             * larger reservation, which is released along with it */
+        if (flags & AG_MMAP_HUGE) {
+            span = len + AG_MMAP_HUGE_SIZE;
+            base = mmap(NULL, span, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS
+                    | MAP_NORESERVE, -1, 0);
+            ag_assert(base != MAP_FAILED, AG_ERNO_SYSTEM);
+
+            p = (void *) (((uintptr_t) base + AG_MMAP_HUGE_SIZE - 1)
+                    & ~(uintptr_t) (AG_MMAP_HUGE_SIZE - 1));
+            p = mmap(p, len, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+            ag_assert(p != MAP_FAILED, AG_ERNO_SYSTEM);
+            (void) madvise(p, len, MADV_HUGEPAGE);
+        } else {
+            span = len;
+            base = p = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+            ag_assert(base != MAP_FAILED, AG_ERNO_SYSTEM);
+        }
+
+        if (flags & AG_MMAP_SEQUENTIAL)
+            (void) madvise(p, len, MADV_SEQUENTIAL);
+        if (flags & AG_MMAP_WILLNEED)
+            (void) madvise(p, len, MADV_WILLNEED);
+
+        m->view.str = (const ag_string *) p;
+        m->view.len = len;
+        m->base = base;
+        m->span = span;
+    }
+
+AG_CATCH:
+    if (base != MAP_FAILED)
+        (void) munmap(base, span);
+
+AG_FINALLY:
+    if (fd >= 0)
+        (void) close(fd);
+
+    return ag_erno_get();
+}
+
+
+/**
+ * Close mapped file.
+ *
+ * The @c ag_mmap_close() function unmaps a file mapped into @p m, invalidating
+ * all views into it.
+ *
+ * @param m Mapping to close.
+ *
+ * @see ag_mmap_open()
+ */
+static inline void
+ag_mmap_close(ag_mmap *m)
+{
+    if (m->base)
+        (void) munmap(m->base, m->span);
+
+    m->view.str = "";
+    m->view.len = 0;
+    m->base = NULL;
+    m->span = 0;
+}
+
+
+/**
+ * Get view of mapped file.
+ *
+ * The @c ag_mmap_view() function gets a view over the contents of a file
+ * mapped into @p m. The view may be used as the cursor of @c ag_mmap_line()
+ * and @c ag_mmap_record().
+ *
+ * @param m Mapping to view.
+ *
+ * @return View over the contents of @p m.
+ */
+static inline ag_string_view
+ag_mmap_view(const ag_mmap *m)
+{
+    return m->view;
+}
+
+
+/**
+ * Get next record.
+ *
+ * The @c ag_mmap_record() function splits the next record, delimited by @p
+ * delim, off the front of the view @p it, and advances @p it past the record
+ * and its delimiter. The last record need not be followed by a delimiter.
+ *
+ * @param it View over the remaining records.
+ * @param delim Record delimiter.
+ * @param rec View to receive the record, without its delimiter.
+ *
+ * @return @c true if a record was found, or @c false if @p it is empty.
+ *
+ * @see ag_mmap_line()
+ */
+static inline ag_bool
+ag_mmap_record(ag_string_view *it, int delim, ag_string_view *rec)
+{
+    const ag_string *end;
+
+    if (ag_unlikely (!it->len))
+        return false;
+
+    rec->str = it->str;
+    if (ag_likely ((end = (const ag_string *) memchr(it->str, delim,
+            it->len)) != NULL)) {
+        rec->len = (ag_size) (end - it->str);
+        it->str = end + 1;
+        it->len -= rec->len + 1;
+    } else {
+        rec->len = it->len;
+        it->str += it->len;
+        it->len = 0;
+    }
+
+    return true;
+}
+
+
+/**
+ * Get next line.
+ *
+ * The @c ag_mmap_line() function splits the next line off the front of the
+ * view @p it, and advances @p it past the line. Lines end with a newline, which
+ * may be preceded by a carriage return; neither is included in the line.
+ *
+ * @param it View over the remaining lines.
+ * @param line View to receive the line.
+ *
+ * @return @c true if a line was found, or @c false if @p it is empty.
+ *
+ * @see ag_mmap_record()
+ */
+static inline ag_bool
+ag_mmap_line(ag_string_view *it, ag_string_view *line)
+{
+    if (!ag_mmap_record(it, '\n', line))
+        return false;
+
+    if (line->len && line->str[line->len - 1] == '\r')
+        line->len--;
+
+    return true;
+}
+
+
+/**
+ * @example mmap.h
+ * This is an example showing how to code against the Argent Core Mmap Module
+ * interface.
+ * @}
+ */
+
+
+#endif /* !defined ARGENT_CORE_MMAP */
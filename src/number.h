@@ -0,0 +1,618 @@
+#if !defined ARGENT_CORE_NUMBER
+#define ARGENT_CORE_NUMBER
+
+
+/**************************************************************************//**
+ * @defgroup number Argent Core Number Module
+ * Number conversion.
+ *
+ * The Number Module converts between numbers and their decimal text, working
+ * on string views instead of null-terminated strings, so that numbers may be
+ * parsed in place from a mapped file or an input buffer.
+ *
+ * Integers are parsed eight digits at a time where possible, by checking and
+ * combining the digits within a single 64-bit word. Floating point numbers
+ * whose significand has at most 19 digits and fits in 53 bits, and whose
+ * decimal exponent is small, are converted exactly through a single
+ * multiplication or division by a power of ten; the remaining numbers, which
+ * are rare in practice, are handed to @c strtod().
+ *
+ * Integers are formatted two digits at a time. Floating point numbers are
+ * formatted through the Grisu2 algorithm, which generates their digits with
+ * 64-bit integer arithmetic against a table of cached powers of ten, and
+ * without going through @c printf().
+ *
+ * @note Since @c strtod() is sensitive to the locale, the program should keep
+ * the @c LC_NUMERIC category set to the "C" locale.
+ * @{
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include "core.h"
+
+
+#if defined __BYTE_ORDER__ && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    /* converts eight decimal digits in a single word, returning false if any
+     * of them is not a digit; the first digit is in the lowest byte */
+static inline ag_bool
+ag__number_digits8__(const ag_string *s, ag_word_64 *v)
+{
+    ag_word_64 x;
+
+    memcpy(&x, s, sizeof x);
+    if ((x & 0xf0f0f0f0f0f0f0f0) != 0x3030303030303030
+            || ((x + 0x0606060606060606) & 0xf0f0f0f0f0f0f0f0)
+            != 0x3030303030303030)
+        return false;
+
+    x -= 0x3030303030303030;
+    x = (x * 10 + (x >> 8)) & 0x00ff00ff00ff00ff;
+    x = (x * 100 + (x >> 16)) & 0x0000ffff0000ffff;
+    *v = (x * 10000 + (x >> 32)) & 0xffffffff;
+
+    return true;
+}
+#endif
+
+
+    /* accumulates the digits at the front of a string, and returns the number
+     * of digits consumed; significant digits beyond the 19th are counted in
+     * the overflow argument instead of being accumulated */
+static inline ag_size
+ag__number_digits__(const ag_string *s, ag_size len, ag_word_64 *v,
+        ag_size *nd, ag_size *over)
+{
+    ag_size i = 0;
+#if defined __BYTE_ORDER__ && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    ag_word_64 d;
+#endif
+
+    while (i < len) {
+#if defined __BYTE_ORDER__ && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            /* once a significant digit has been seen, all further digits
+             * count towards the limit, and may be taken eight at a time */
+        if (*v && i + 8 <= len && *nd + 8 <= 19
+                && ag__number_digits8__(s + i, &d)) {
+            *v = *v * 100000000 + d;
+            *nd += 8;
+            i += 8;
+            continue;
+        }
+#endif
+
+        if (s[i] < '0' || s[i] > '9')
+            break;
+
+        if (*nd < 19) {
+            *v = *v * 10 + (ag_word_64) (s[i] - '0');
+            if (*v)
+                (*nd)++;
+        } else
+            (*over)++;
+        i++;
+    }
+
+    return i;
+}
+
+
+/**
+ * Parse integer.
+ *
+ * The @c ag_number_parse_int() function parses the whole of the string view
+ * @p s as a decimal integer, with an optional leading sign.
+ *
+ * @param s String to parse.
+ * @param v Integer to receive the value.
+ *
+ * @return AG_ERNO_NULL if @p s has been parsed.
+ * @return AG_ERNO_HANDLE if @p v is a null pointer.
+ * @return AG_ERNO_STRING if @p s is not a decimal integer.
+ * @return AG_ERNO_RANGE if the value of @p s does not fit in 64 bits.
+ */
+static inline ag_erno
+ag_number_parse_int(ag_string_view s, ag_int_64 *v)
+{
+    ag_word_64 m = 0, lim;
+    ag_size i = 0, nd = 0, over = 0, n;
+    ag_bool neg = false;
+
+AG_TRY:
+    ag_assert_handle(v);
+
+    if (i < s.len && (s.str[i] == '-' || s.str[i] == '+'))
+        neg = s.str[i++] == '-';
+
+    n = ag__number_digits__(s.str + i, s.len - i, &m, &nd, &over);
+    ag_assert(n && i + n == s.len, AG_ERNO_STRING);
+
+        /* nineteen significant digits always fit in 64 bits, but not always
+         * in the signed range */
+    lim = neg ? (ag_word_64) INT64_MAX + 1 : (ag_word_64) INT64_MAX;
+    ag_assert_range(!over && m <= lim);
+
+    *v = neg ? (ag_int_64) (0 - m) : (ag_int_64) m;
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Parse floating point number.
+ *
+ * The @c ag_number_parse_float() function parses the whole of the string view
+ * @p s as a decimal floating point number, with an optional leading sign,
+ * fractional part and exponent. Other forms accepted by @c strtod(), such as
+ * infinities, are accepted as well.
+ *
+ * @param s String to parse.
+ * @param v Floating point number to receive the value.
+ *
+ * @return AG_ERNO_NULL if @p s has been parsed.
+ * @return AG_ERNO_HANDLE if @p v is a null pointer.
+ * @return AG_ERNO_STRING if @p s is not a floating point number.
+ * @return AG_ERNO_MEMORY if a long number could not be copied.
+ */
+static inline ag_erno
+ag_number_parse_float(ag_string_view s, ag_float_64 *v)
+{
+    static const ag_float_64 pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6,
+            1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+            1e18, 1e19, 1e20, 1e21, 1e22};
+    ag_string tmp[64], *buf = tmp, *end;
+    ag_word_64 m = 0;
+    ag_size i = 0, j, k, nd = 0, over = 0, n, f;
+    ag_int_64 e, x = 0;
+    ag_bool neg = false, xneg = false;
+    ag_float_64 d;
+
+AG_TRY:
+    ag_assert_handle(v);
+
+    if (i < s.len && (s.str[i] == '-' || s.str[i] == '+'))
+        neg = s.str[i++] == '-';
+
+        /* significant digits of the integral part that do not fit scale the
+         * significand up, while those of the fractional part that do fit
+         * scale it down */
+    n = ag__number_digits__(s.str + i, s.len - i, &m, &nd, &over);
+    i += n;
+    e = (ag_int_64) over;
+
+    if (i < s.len && s.str[i] == '.') {
+        f = over;
+        k = ag__number_digits__(s.str + i + 1, s.len - i - 1, &m, &nd, &over);
+        e -= (ag_int_64) (k - (over - f));
+        i += k + 1;
+        n += k;
+    }
+
+    if (n && i < s.len && (s.str[i] == 'e' || s.str[i] == 'E')) {
+        j = i + 1;
+        if (j < s.len && (s.str[j] == '-' || s.str[j] == '+'))
+            xneg = s.str[j++] == '-';
+
+        for (k = j; k < s.len && s.str[k] >= '0' && s.str[k] <= '9'; k++) {
+            if (x < 100000)
+                x = x * 10 + (s.str[k] - '0');
+        }
+
+        if (k > j) {
+            e += xneg ? -x : x;
+            i = k;
+        }
+    }
+
+    if (ag_likely (n && i == s.len && !over && m <= (ag_word_64) 1 << 53
+            && e >= -22 && e <= 22)) {
+        d = (ag_float_64) m;
+        d = e < 0 ? d / pow10[-e] : d * pow10[e];
+        *v = neg ? -d : d;
+    } else {
+        ag_assert(s.len && (ag_word_8) s.str[0] > ' ', AG_ERNO_STRING);
+
+        if (s.len >= sizeof tmp) {
+            buf = (ag_string *) malloc(s.len + 1);
+            ag_assert(buf, AG_ERNO_MEMORY);
+        }
+
+        memcpy(buf, s.str, s.len);
+        buf[s.len] = '\0';
+
+        d = strtod(buf, &end);
+        ag_assert(end == buf + s.len, AG_ERNO_STRING);
+        *v = d;
+    }
+
+AG_CATCH:
+AG_FINALLY:
+    if (buf != tmp)
+        free(buf);
+
+    return ag_erno_get();
+}
+
+
+/**
+ * Formatted number size.
+ *
+ * The @c AG_NUMBER_SIZE symbolic constant is the largest number of bytes that
+ * formatting a number may write.
+ *
+ * @see ag_number_format_int()
+ * @see ag_number_format_float()
+ */
+#define AG_NUMBER_SIZE 32
+
+
+/**
+ * Format integer.
+ *
+ * The @c ag_number_format_int() function writes the decimal text of an
+ * integer @p v into @p out, two digits at a time. The text is not
+ * null-terminated.
+ *
+ * @param v Integer to format.
+ * @param out Buffer to receive the text, at least @c AG_NUMBER_SIZE bytes
+ * long.
+ *
+ * @return Length of the text.
+ *
+ * @see ag_number_parse_int()
+ */
+static inline ag_size
+ag_number_format_int(ag_int_64 v, ag_string *out)
+{
+    static const char digits[] =
+            "00010203040506070809101112131415161718192021222324"
+            "25262728293031323334353637383940414243444546474849"
+            "50515253545556575859606162636465666768697071727374"
+            "75767778798081828384858687888990919293949596979899";
+    ag_string tmp[20], *p = tmp + sizeof tmp;
+    ag_word_64 u = v < 0 ? 0 - (ag_word_64) v : (ag_word_64) v;
+    ag_size i, n = 0;
+
+    while (u >= 100) {
+        i = (ag_size) (u % 100) * 2;
+        u /= 100;
+        *--p = digits[i + 1];
+        *--p = digits[i];
+    }
+
+    if (u >= 10) {
+        *--p = digits[u * 2 + 1];
+        *--p = digits[u * 2];
+    } else
+        *--p = (ag_string) ('0' + u);
+
+    if (v < 0)
+        out[n++] = '-';
+
+    memcpy(out + n, p, (ag_size) (tmp + sizeof tmp - p));
+    return n + (ag_size) (tmp + sizeof tmp - p);
+}
+
+
+    /* a floating point number with a 64-bit significand, as used by the
+     * Grisu algorithm */
+struct ag__number_fp__ {
+    ag_word_64 f;
+    int e;
+};
+
+
+static inline struct ag__number_fp__
+ag__number_fp_norm__(struct ag__number_fp__ x)
+{
+    int s = __builtin_clzll(x.f);
+
+    x.f <<= s;
+    x.e -= s;
+
+    return x;
+}
+
+
+    /* multiplies two significands, keeping the rounded upper half */
+static inline struct ag__number_fp__
+ag__number_fp_mul__(struct ag__number_fp__ x, struct ag__number_fp__ y)
+{
+    const ag_word_64 m = 0xffffffff;
+    ag_word_64 a = x.f >> 32, b = x.f & m, c = y.f >> 32, d = y.f & m;
+    ag_word_64 ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    ag_word_64 t = (bd >> 32) + (ad & m) + (bc & m) + ((ag_word_64) 1 << 31);
+
+    x.f = ac + (ad >> 32) + (bc >> 32) + (t >> 32);
+    x.e += y.e + 64;
+
+    return x;
+}
+
+
+    /* nudges the last digit towards the exact value while the result stays
+     * within the rounding interval */
+static inline void
+ag__number_grisu_round__(ag_string *buf, int len, ag_word_64 delta,
+        ag_word_64 rest, ag_word_64 ten, ag_word_64 wp_w)
+{
+    while (rest < wp_w && delta - rest >= ten && (rest + ten < wp_w
+            || wp_w - rest > rest + ten - wp_w)) {
+        buf[len - 1]--;
+        rest += ten;
+    }
+}
+
+
+    /* generates the digits of a positive finite number through the Grisu2
+     * algorithm, which yields the shortest digits that read back as the same
+     * number in all but rare cases, where it yields a digit more; the value
+     * is the digits scaled by ten to the power of the returned exponent */
+static inline int
+ag__number_grisu2__(ag_float_64 v, ag_string *buf, int *k)
+{
+    static const ag_word_64 pow10[] = {1, 10, 100, 1000, 10000, 100000,
+            1000000, 10000000, 100000000, 1000000000, 10000000000,
+            100000000000, 1000000000000, 10000000000000, 100000000000000,
+            1000000000000000, 10000000000000000, 100000000000000000,
+            1000000000000000000, 10000000000000000000u};
+    static const struct {
+        ag_word_64 f;
+        int e;
+    } cache[] = {
+            {0xfa8fd5a0081c0288, -1220}, {0xbaaee17fa23ebf76, -1193},
+            {0x8b16fb203055ac76, -1166}, {0xcf42894a5dce35ea, -1140},
+            {0x9a6bb0aa55653b2d, -1113}, {0xe61acf033d1a45df, -1087},
+            {0xab70fe17c79ac6ca, -1060}, {0xff77b1fcbebcdc4f, -1034},
+            {0xbe5691ef416bd60c, -1007}, {0x8dd01fad907ffc3c, -980},
+            {0xd3515c2831559a83, -954}, {0x9d71ac8fada6c9b5, -927},
+            {0xea9c227723ee8bcb, -901}, {0xaecc49914078536d, -874},
+            {0x823c12795db6ce57, -847}, {0xc21094364dfb5637, -821},
+            {0x9096ea6f3848984f, -794}, {0xd77485cb25823ac7, -768},
+            {0xa086cfcd97bf97f4, -741}, {0xef340a98172aace5, -715},
+            {0xb23867fb2a35b28e, -688}, {0x84c8d4dfd2c63f3b, -661},
+            {0xc5dd44271ad3cdba, -635}, {0x936b9fcebb25c996, -608},
+            {0xdbac6c247d62a584, -582}, {0xa3ab66580d5fdaf6, -555},
+            {0xf3e2f893dec3f126, -529}, {0xb5b5ada8aaff80b8, -502},
+            {0x87625f056c7c4a8b, -475}, {0xc9bcff6034c13053, -449},
+            {0x964e858c91ba2655, -422}, {0xdff9772470297ebd, -396},
+            {0xa6dfbd9fb8e5b88f, -369}, {0xf8a95fcf88747d94, -343},
+            {0xb94470938fa89bcf, -316}, {0x8a08f0f8bf0f156b, -289},
+            {0xcdb02555653131b6, -263}, {0x993fe2c6d07b7fac, -236},
+            {0xe45c10c42a2b3b06, -210}, {0xaa242499697392d3, -183},
+            {0xfd87b5f28300ca0e, -157}, {0xbce5086492111aeb, -130},
+            {0x8cbccc096f5088cc, -103}, {0xd1b71758e219652c, -77},
+            {0x9c40000000000000, -50}, {0xe8d4a51000000000, -24},
+            {0xad78ebc5ac620000, 3}, {0x813f3978f8940984, 30},
+            {0xc097ce7bc90715b3, 56}, {0x8f7e32ce7bea5c70, 83},
+            {0xd5d238a4abe98068, 109}, {0x9f4f2726179a2245, 136},
+            {0xed63a231d4c4fb27, 162}, {0xb0de65388cc8ada8, 189},
+            {0x83c7088e1aab65db, 216}, {0xc45d1df942711d9a, 242},
+            {0x924d692ca61be758, 269}, {0xda01ee641a708dea, 295},
+            {0xa26da3999aef774a, 322}, {0xf209787bb47d6b85, 348},
+            {0xb454e4a179dd1877, 375}, {0x865b86925b9bc5c2, 402},
+            {0xc83553c5c8965d3d, 428}, {0x952ab45cfa97a0b3, 455},
+            {0xde469fbd99a05fe3, 481}, {0xa59bc234db398c25, 508},
+            {0xf6c69a72a3989f5c, 534}, {0xb7dcbf5354e9bece, 561},
+            {0x88fcf317f22241e2, 588}, {0xcc20ce9bd35c78a5, 614},
+            {0x98165af37b2153df, 641}, {0xe2a0b5dc971f303a, 667},
+            {0xa8d9d1535ce3b396, 694}, {0xfb9b7cd9a4a7443c, 720},
+            {0xbb764c4ca7a44410, 747}, {0x8bab8eefb6409c1a, 774},
+            {0xd01fef10a657842c, 800}, {0x9b10a4e5e9913129, 827},
+            {0xe7109bfba19c0c9d, 853}, {0xac2820d9623bf429, 880},
+            {0x80444b5e7aa7cf85, 907}, {0xbf21e44003acdd2d, 933},
+            {0x8e679c2f5e44ff8f, 960}, {0xd433179d9c8cb841, 986},
+            {0x9e19db92b4e31ba9, 1013}, {0xeb96bf6ebadf77d9, 1039},
+            {0xaf87023b9bf0ee6b, 1066}};
+    struct ag__number_fp__ w, pl, mi, c, one;
+    ag_word_64 bits, delta, p2, wp_w, t;
+    ag_word_32 p1, d;
+    int i, kappa, len = 0;
+    double dk;
+
+    memcpy(&bits, &v, sizeof bits);
+    w.f = bits & 0xfffffffffffff;
+    w.e = (int) (bits >> 52 & 0x7ff);
+    if (w.e) {
+        w.f |= (ag_word_64) 1 << 52;
+        w.e -= 1075;
+    } else
+        w.e = -1074;
+
+        /* the boundaries lie halfway to the neighbouring numbers, the lower
+         * one being closer at a power of two */
+    pl.f = (w.f << 1) + 1;
+    pl.e = w.e - 1;
+    pl = ag__number_fp_norm__(pl);
+
+    if (w.f == (ag_word_64) 1 << 52) {
+        mi.f = (w.f << 2) - 1;
+        mi.e = w.e - 2;
+    } else {
+        mi.f = (w.f << 1) - 1;
+        mi.e = w.e - 1;
+    }
+    mi.f <<= mi.e - pl.e;
+    mi.e = pl.e;
+
+        /* a cached power of ten brings the upper boundary's exponent within
+         * [-60, -32], so that its integral part fits in 32 bits */
+    dk = (-61 - pl.e) * 0.30102999566398114 + 347;
+    i = (int) dk;
+    if (dk - i > 0.0)
+        i++;
+    i = (i >> 3) + 1;
+    *k = -(-348 + i * 8);
+    c.f = cache[i].f;
+    c.e = cache[i].e;
+
+    w = ag__number_fp_mul__(ag__number_fp_norm__(w), c);
+    pl = ag__number_fp_mul__(pl, c);
+    mi = ag__number_fp_mul__(mi, c);
+    mi.f++;
+    pl.f--;
+
+    delta = pl.f - mi.f;
+    wp_w = pl.f - w.f;
+    one.f = (ag_word_64) 1 << -pl.e;
+    one.e = pl.e;
+    p1 = (ag_word_32) (pl.f >> -one.e);
+    p2 = pl.f & (one.f - 1);
+
+    for (kappa = 1; kappa < 10 && p1 >= pow10[kappa]; kappa++);
+
+    while (kappa > 0) {
+        d = (ag_word_32) (p1 / pow10[kappa - 1]);
+        p1 = (ag_word_32) (p1 % pow10[kappa - 1]);
+        if (d || len)
+            buf[len++] = (ag_string) ('0' + d);
+        kappa--;
+
+        t = ((ag_word_64) p1 << -one.e) + p2;
+        if (t <= delta) {
+            *k += kappa;
+            ag__number_grisu_round__(buf, len, delta, t,
+                    pow10[kappa] << -one.e, wp_w);
+            return len;
+        }
+    }
+
+    for (;;) {
+        p2 *= 10;
+        delta *= 10;
+        d = (ag_word_32) (p2 >> -one.e);
+        if (d || len)
+            buf[len++] = (ag_string) ('0' + d);
+        p2 &= one.f - 1;
+        kappa--;
+
+        if (p2 < delta) {
+            *k += kappa;
+            i = -kappa;
+            ag__number_grisu_round__(buf, len, delta, p2, one.f,
+                    wp_w * (i < 20 ? pow10[i] : 0));
+            return len;
+        }
+    }
+}
+
+
+    /* writes a decimal exponent */
+static inline ag_size
+ag__number_exponent__(int e, ag_string *out)
+{
+    ag_size n = 0;
+
+    if (e < 0) {
+        out[n++] = '-';
+        e = -e;
+    }
+
+    if (e >= 100) {
+        out[n++] = (ag_string) ('0' + e / 100);
+        e %= 100;
+        out[n++] = (ag_string) ('0' + e / 10);
+    } else if (e >= 10)
+        out[n++] = (ag_string) ('0' + e / 10);
+    out[n++] = (ag_string) ('0' + e % 10);
+
+    return n;
+}
+
+
+/**
+ * Format floating point number.
+ *
+ * The @c ag_number_format_float() function writes the decimal text of a
+ * floating point number @p v into @p out, with the fewest significant digits
+ * that read back as @p v in all but rare cases, in which a digit more is used.
+ * Numbers of moderate magnitude are written in positional notation, always
+ * with a fractional part, and others in exponential notation. Infinities and
+ * NaNs are written as "inf", "-inf" and "nan". The text is not
+ * null-terminated.
+ *
+ * @param v Floating point number to format.
+ * @param out Buffer to receive the text, at least @c AG_NUMBER_SIZE bytes
+ * long.
+ *
+ * @return Length of the text.
+ *
+ * @see ag_number_parse_float()
+ */
+static inline ag_size
+ag_number_format_float(ag_float_64 v, ag_string *out)
+{
+    ag_string *p = out;
+    ag_word_64 bits;
+    int len, k, kk, i;
+
+    memcpy(&bits, &v, sizeof bits);
+    if (ag_unlikely ((bits >> 52 & 0x7ff) == 0x7ff)) {
+        if (bits & 0xfffffffffffff) {
+            memcpy(p, "nan", 3);
+            return 3;
+        }
+
+        if (bits >> 63)
+            *p++ = '-';
+        memcpy(p, "inf", 3);
+        return (ag_size) (p + 3 - out);
+    }
+
+    if (bits >> 63) {
+        *p++ = '-';
+        v = -v;
+    }
+
+    if (v == 0) {
+        memcpy(p, "0.0", 3);
+        return (ag_size) (p + 3 - out);
+    }
+
+    len = ag__number_grisu2__(v, p, &k);
+    kk = len + k;
+
+        /* the number lies within [10^(kk-1), 10^kk) */
+    if (k >= 0 && kk <= 21) {
+        for (i = len; i < kk; i++)
+            p[i] = '0';
+        p[kk] = '.';
+        p[kk + 1] = '0';
+        p += kk + 2;
+    } else if (kk > 0 && kk <= 21) {
+        memmove(p + kk + 1, p + kk, (ag_size) (len - kk));
+        p[kk] = '.';
+        p += len + 1;
+    } else if (kk > -6 && kk <= 0) {
+        memmove(p + 2 - kk, p, (ag_size) len);
+        p[0] = '0';
+        p[1] = '.';
+        for (i = 2; i < 2 - kk; i++)
+            p[i] = '0';
+        p += len + 2 - kk;
+    } else if (len == 1) {
+        p[1] = 'e';
+        p += 2 + ag__number_exponent__(kk - 1, p + 2);
+    } else {
+        memmove(p + 2, p + 1, (ag_size) (len - 1));
+        p[1] = '.';
+        p[len + 1] = 'e';
+        p += len + 2 + ag__number_exponent__(kk - 1, p + len + 2);
+    }
+
+    return (ag_size) (p - out);
+}
+
+
+/**
+ * @example number.h
+ * This is an example showing how to code against the Argent Core Number
+ * Module interface.
+ * @}
+ */
+
+
+#endif /* !defined ARGENT_CORE_NUMBER */
@@ -0,0 +1,371 @@
+#if !defined ARGENT_CORE_PARALLEL
+#define ARGENT_CORE_PARALLEL
+
+
+/**************************************************************************//**
+ * @defgroup parallel Argent Core Parallel Module
+ * Parallel loops over index ranges.
+ *
+ * The Parallel Module provides parallel-for and parallel-reduce loops over
+ * index ranges of the form [0, n), run across the workers of a thread pool
+ * created through the Pool Module.
+ *
+ * Ranges are split adaptively through lazy binary splitting: a worker only
+ * splits its remaining range in two when its own deque is empty, which is the
+ * case when its previous split has been stolen by an idle worker. Work is thus
+ * divided finely when workers are hungry, and coarsely when they are all busy,
+ * without the need to tune the number of chunks for each loop.
+ *
+ * Loop bodies return an @c ag_erno error code. The first error raised by any
+ * chunk cancels the chunks that have not yet started, and is returned by the
+ * loop.
+ *
+ * @note This module is specific to Linux, and requires the GNU C dialect or
+ * @c _GNU_SOURCE to be defined; client code must be linked with @c -pthread.
+ * @{
+ */
+
+
+#include <string.h>
+#include "pool.h"
+
+
+/**
+ * Maximum accumulator size.
+ *
+ * The @c AG_PARALLEL_ACC_MAX symbolic constant sets the maximum size in bytes
+ * of the accumulator of a parallel reduction. Each split of the range holds
+ * its own accumulator of this size, so it is kept small. The default may be
+ * overridden by defining this constant before including this header.
+ *
+ * @see ag_parallel_reduce()
+ */
+#if !defined AG_PARALLEL_ACC_MAX
+#   define AG_PARALLEL_ACC_MAX 64
+#endif
+
+
+/**
+ * Parallel-for body.
+ *
+ * The @c ag_parallel_fn type is the signature of the body of a parallel-for
+ * loop. The body processes the indices in the range [@p begin, @p end).
+ *
+ * @param ctx Context passed to @c ag_parallel_for().
+ * @param begin First index of range.
+ * @param end One past the last index of range.
+ *
+ * @return AG_ERNO_NULL if the range has been processed, or an error code to
+ * cancel the loop.
+ *
+ * @see ag_parallel_for()
+ */
+typedef ag_erno (*ag_parallel_fn)(void *ctx, ag_index begin, ag_index end);
+
+
+/**
+ * Parallel-reduce body.
+ *
+ * The @c ag_parallel_reduce_fn type is the signature of the body of a
+ * parallel-reduce loop. The body folds the indices in the range [@p begin, @p
+ * end) into the accumulator @p acc.
+ *
+ * @param ctx Context passed to @c ag_parallel_reduce().
+ * @param begin First index of range.
+ * @param end One past the last index of range.
+ * @param acc Accumulator to fold into.
+ *
+ * @return AG_ERNO_NULL if the range has been processed, or an error code to
+ * cancel the loop.
+ *
+ * @see ag_parallel_reduce()
+ */
+typedef ag_erno (*ag_parallel_reduce_fn)(void *ctx, ag_index begin,
+        ag_index end, void *acc);
+
+
+/**
+ * Parallel-reduce join.
+ *
+ * The @c ag_parallel_join_fn type is the signature of the function that
+ * combines two accumulators of a parallel-reduce loop. The accumulator @p
+ * right always holds the result for indices following those of @p acc, so the
+ * combining operation need only be associative, not commutative.
+ *
+ * @param ctx Context passed to @c ag_parallel_reduce().
+ * @param acc Accumulator to combine into.
+ * @param right Accumulator to combine.
+ *
+ * @see ag_parallel_reduce()
+ */
+typedef void (*ag_parallel_join_fn)(void *ctx, void *acc, const void *right);
+
+
+struct ag__parallel_job__ {
+    ag_pool *pool;
+    ag_parallel_fn fn;
+    ag_parallel_reduce_fn reduce;
+    ag_parallel_join_fn join;
+    void *ctx;
+    const void *identity;
+    ag_size size;
+    ag_size grain;
+    ag_erno erno;
+};
+
+
+    /* a split of the range, run as a task with its own accumulator */
+struct ag__parallel_split__ {
+    ag_pool_task task;
+    struct ag__parallel_job__ *job;
+    ag_index begin;
+    ag_index end;
+    union {
+        unsigned char bytes[AG_PARALLEL_ACC_MAX];
+        long double align;
+        void *ptr;
+    } acc;
+};
+
+
+    /* records the first error raised, which cancels the remaining chunks */
+static inline void
+ag__parallel_fail__(struct ag__parallel_job__ *job, ag_erno e)
+{
+    ag_erno expect = AG_ERNO_NULL;
+
+    (void) ag_atomic_word_cas_explicit(&job->erno, &expect, e,
+            AG_ATOMIC_RELAXED, AG_ATOMIC_RELAXED);
+}
+
+
+    /* checks whether the deque of the current worker is empty, in which case
+     * any further split is likely to be stolen by a hungry worker */
+static inline ag_bool
+ag__parallel_hungry__(void)
+{
+    struct ag__pool_worker__ *w = ag__pool_self__;
+
+    return w && ag_atomic_int_64_load_explicit(&w->top, AG_ATOMIC_RELAXED)
+            >= ag_atomic_int_64_load_explicit(&w->bottom, AG_ATOMIC_RELAXED);
+}
+
+
+static inline ag_erno ag__parallel_task__(void *arg);
+
+
+static inline void
+ag__parallel_range__(struct ag__parallel_job__ *job, ag_index begin,
+        ag_index end, void *acc)
+{
+    struct ag__parallel_split__ right;
+    ag_index chunk;
+    ag_erno e;
+
+    while (begin < end) {
+        if (ag_atomic_word_load_explicit(&job->erno, AG_ATOMIC_RELAXED))
+            return;
+
+        if (end - begin > job->grain && ag__parallel_hungry__()) {
+            right.job = job;
+            right.begin = begin + (end - begin) / 2;
+            right.end = end;
+            if (job->size)
+                memcpy(right.acc.bytes, job->identity, job->size);
+
+            ag_pool_task_init(&right.task, ag__parallel_task__, &right);
+            ag_pool_submit(job->pool, &right.task);
+
+            ag__parallel_range__(job, begin, right.begin, acc);
+            (void) ag_pool_wait(job->pool, &right.task);
+
+            if (job->join)
+                job->join(job->ctx, acc, right.acc.bytes);
+            return;
+        }
+
+        chunk = end - begin < job->grain ? end - begin : job->grain;
+        e = job->fn ? job->fn(job->ctx, begin, begin + chunk)
+                : job->reduce(job->ctx, begin, begin + chunk, acc);
+        if (ag_unlikely (e)) {
+            ag__parallel_fail__(job, e);
+            return;
+        }
+
+        begin += chunk;
+    }
+}
+
+
+static inline ag_erno
+ag__parallel_task__(void *arg)
+{
+    struct ag__parallel_split__ *s = (struct ag__parallel_split__ *) arg;
+
+    ag__parallel_range__(s->job, s->begin, s->end, s->acc.bytes);
+    return AG_ERNO_NULL;
+}
+
+
+    /* runs a job over [0, n), from within the pool if the calling thread is
+     * not one of its workers */
+static inline ag_erno
+ag__parallel_run__(struct ag__parallel_job__ *job, ag_index n, void *acc)
+{
+    struct ag__parallel_split__ root;
+    struct ag__pool_worker__ *w = ag__pool_self__;
+
+    if (!job->grain) {
+        job->grain = n / (ag_pool_workers(job->pool) * 64);
+        if (!job->grain)
+            job->grain = 1;
+    }
+
+    if (w && w->pool == job->pool) {
+        ag__parallel_range__(job, 0, n, acc);
+        return ag_atomic_word_load_explicit(&job->erno, AG_ATOMIC_RELAXED);
+    }
+
+    root.job = job;
+    root.begin = 0;
+    root.end = n;
+    if (job->size)
+        memcpy(root.acc.bytes, acc, job->size);
+
+    ag_pool_task_init(&root.task, ag__parallel_task__, &root);
+    ag_pool_submit(job->pool, &root.task);
+    (void) ag_pool_wait(job->pool, &root.task);
+
+    if (job->size)
+        memcpy(acc, root.acc.bytes, job->size);
+    return ag_atomic_word_load_explicit(&job->erno, AG_ATOMIC_RELAXED);
+}
+
+
+/**
+ * Run parallel-for loop.
+ *
+ * The @c ag_parallel_for() function runs the body @p fn over the indices in
+ * the range [0, @p n) across the workers of a pool @p p. The range is split
+ * adaptively into chunks of at most @p grain indices, and @p fn is called once
+ * for each chunk. If any call of @p fn returns an error code, then the chunks
+ * that have not yet started are cancelled.
+ *
+ * This function may be called both from outside the pool and from within a
+ * task running on it, in which case the calling worker takes part in the loop.
+ *
+ * @param p Pool to run loop on.
+ * @param n Number of indices.
+ * @param grain Maximum chunk size, or zero to choose automatically.
+ * @param fn Loop body.
+ * @param ctx Context passed to @p fn.
+ *
+ * @return AG_ERNO_NULL if all chunks have been processed.
+ * @return AG_ERNO_HANDLE if @p p or @p fn is a null pointer.
+ * @return The first error code returned by @p fn otherwise.
+ *
+ * @see ag_parallel_reduce()
+ */
+static inline ag_erno
+ag_parallel_for(ag_pool *p, ag_index n, ag_size grain, ag_parallel_fn fn,
+        void *ctx)
+{
+    struct ag__parallel_job__ job;
+
+AG_TRY:
+    ag_assert_handle(p && fn);
+
+    job.pool = p;
+    job.fn = fn;
+    job.reduce = NULL;
+    job.join = NULL;
+    job.ctx = ctx;
+    job.identity = NULL;
+    job.size = 0;
+    job.grain = grain;
+    job.erno = AG_ERNO_NULL;
+
+    if (n)
+        ag_try(ag__parallel_run__(&job, n, NULL));
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Run parallel-reduce loop.
+ *
+ * The @c ag_parallel_reduce() function folds the indices in the range [0, @p
+ * n) into the accumulator @p acc, of @p size bytes, across the workers of a
+ * pool @p p. The range is split adaptively into chunks of at most @p grain
+ * indices, and @p fn is called once for each chunk. Each split of the range
+ * starts with a copy of the initial value of @p acc, which must therefore be
+ * the identity of the reduction, and splits are combined in index order
+ * through @p join.
+ *
+ * If any call of @p fn returns an error code, then the chunks that have not
+ * yet started are cancelled, and the contents of @p acc are unspecified.
+ *
+ * @param p Pool to run loop on.
+ * @param n Number of indices.
+ * @param grain Maximum chunk size, or zero to choose automatically.
+ * @param fn Loop body.
+ * @param join Accumulator combining function.
+ * @param ctx Context passed to @p fn and @p join.
+ * @param acc Accumulator holding identity, and receiving result.
+ * @param size Size of accumulator in bytes.
+ *
+ * @return AG_ERNO_NULL if all chunks have been processed.
+ * @return AG_ERNO_HANDLE if @p p, @p fn, @p join or @p acc is a null pointer.
+ * @return AG_ERNO_RANGE if @p size exceeds @c AG_PARALLEL_ACC_MAX.
+ * @return The first error code returned by @p fn otherwise.
+ *
+ * @see ag_parallel_for()
+ */
+static inline ag_erno
+ag_parallel_reduce(ag_pool *p, ag_index n, ag_size grain,
+        ag_parallel_reduce_fn fn, ag_parallel_join_fn join, void *ctx,
+        void *acc, ag_size size)
+{
+    struct ag__parallel_job__ job;
+    union {
+        unsigned char bytes[AG_PARALLEL_ACC_MAX];
+        long double align;
+        void *ptr;
+    } identity;
+
+AG_TRY:
+    ag_assert_handle(p && fn && join && acc);
+    ag_assert_range(size <= AG_PARALLEL_ACC_MAX);
+
+    memcpy(identity.bytes, acc, size);
+    job.pool = p;
+    job.fn = NULL;
+    job.reduce = fn;
+    job.join = join;
+    job.ctx = ctx;
+    job.identity = identity.bytes;
+    job.size = size;
+    job.grain = grain;
+    job.erno = AG_ERNO_NULL;
+
+    if (n)
+        ag_try(ag__parallel_run__(&job, n, acc));
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * @example parallel.h
+ * This is an example showing how to code against the Argent Core Parallel
+ * Module interface.
+ * @}
+ */
+
+
+#endif /* !defined ARGENT_CORE_PARALLEL */
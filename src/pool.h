@@ -0,0 +1,564 @@
+#if !defined ARGENT_CORE_POOL
+#define ARGENT_CORE_POOL
+
+
+/**************************************************************************//**
+ * @defgroup pool Argent Core Pool Module
+ * Work-stealing thread pool.
+ *
+ * The Pool Module provides a thread pool that spreads tasks across a set of
+ * worker threads without a central queue. Each worker owns a Chase-Lev
+ * deque of tasks, pushing and popping at one end, while idle workers steal
+ * from the other end of the deques of their peers. Tasks submitted from
+ * outside the pool are handed to the inbox of a worker in round-robin order,
+ * from which any idle worker may claim them.
+ *
+ * Idle workers first spin, then yield their processor, and finally park on a
+ * futex until more work is submitted, so that an idle pool consumes no
+ * processor time while a busy pool does not pay for system calls.
+ *
+ * Tasks are functions returning an @c ag_erno error code, which is reported
+ * as the completion status of the task by @c ag_pool_wait(). Task descriptors
+ * are provided by the caller, so submitting a task does not allocate memory.
+ *
+ * @note This module is specific to Linux, and requires the GNU C dialect or
+ * @c _GNU_SOURCE to be defined; client code must be linked with @c -pthread.
+ * @{
+ */
+
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include "futex.h"
+
+
+/**
+ * Deque capacity.
+ *
+ * The @c AG_POOL_DEQUE_SIZE symbolic constant sets the number of tasks that
+ * each worker deque can hold, and must be a power of two. A task spawned by a
+ * worker whose deque is full is run immediately by that worker instead. The
+ * default may be overridden by defining this constant before including this
+ * header.
+ */
+#if !defined AG_POOL_DEQUE_SIZE
+#   define AG_POOL_DEQUE_SIZE 4096
+#endif
+
+
+/**
+ * Task function.
+ *
+ * The @c ag_pool_fn type is the signature of a function run as a task by the
+ * pool. The function receives the argument given to @c ag_pool_task_init(),
+ * and its return value is reported as the completion status of the task.
+ *
+ * @see ag_pool_task_init()
+ */
+typedef ag_erno (*ag_pool_fn)(void *arg);
+
+
+/**
+ * Task descriptor.
+ *
+ * The @c ag_pool_task type describes a task submitted to a pool. A task is
+ * allocated by the caller, and must remain valid until @c ag_pool_wait() has
+ * returned for it; it may be reused once that has happened.
+ *
+ * @see ag_pool_task_init()
+ * @see ag_pool_submit()
+ */
+typedef struct ag_pool_task {
+    ag_pool_fn fn;
+    void *arg;
+    struct ag_pool_task *next;
+    ag_erno erno;
+    ag_event done;
+} ag_pool_task;
+
+
+    /* the deque indices are kept on separate cache lines, as the bottom index
+     * is written by the owner and the top index by thieves */
+struct ag__pool_worker__ {
+    ag_cacheline_aligned ag_int_64 top;
+    ag_cacheline_aligned ag_int_64 bottom;
+    ag_pool_task *buf[AG_POOL_DEQUE_SIZE];
+    ag_cacheline_aligned ag_pool_task *inbox;
+    struct ag_pool *pool;
+    pthread_t thread;
+    ag_word_64 seed;
+};
+
+
+/**
+ * Work-stealing thread pool.
+ *
+ * The @c ag_pool type is an opaque handle to a pool of worker threads created
+ * through @c ag_pool_create().
+ *
+ * @see ag_pool_create()
+ */
+typedef struct ag_pool {
+    struct ag__pool_worker__ *workers;
+    ag_size nworkers;
+    ag_cacheline_aligned ag_word_32 epoch;
+    ag_word_32 sleepers;
+    ag_word_32 stop;
+    ag_cacheline_aligned ag_size next;
+} ag_pool;
+
+
+    /* the worker running on the current thread, if any; this is weak so that
+     * it is shared by all translation units including this header */
+__attribute__((weak)) __thread struct ag__pool_worker__ *ag__pool_self__;
+
+
+    /* pushes a task onto the bottom of the deque of its owner */
+static inline ag_bool
+ag__pool_push__(struct ag__pool_worker__ *w, ag_pool_task *t)
+{
+    ag_int_64 b, tp;
+
+    b = ag_atomic_int_64_load_explicit(&w->bottom, AG_ATOMIC_RELAXED);
+    tp = ag_atomic_int_64_load_explicit(&w->top, AG_ATOMIC_ACQUIRE);
+    if (ag_unlikely (b - tp >= AG_POOL_DEQUE_SIZE))
+        return AG_BOOL_FALSE;
+
+    ag_atomic_ptr_store_explicit(&w->buf[b & (AG_POOL_DEQUE_SIZE - 1)], t,
+            AG_ATOMIC_RELAXED);
+    ag_atomic_int_64_store_explicit(&w->bottom, b + 1, AG_ATOMIC_RELEASE);
+
+    return AG_BOOL_TRUE;
+}
+
+
+    /* pops a task from the bottom of the deque of its owner */
+static inline ag_pool_task *
+ag__pool_take__(struct ag__pool_worker__ *w)
+{
+    ag_int_64 b, tp;
+    ag_pool_task *t = NULL;
+
+    b = ag_atomic_int_64_load_explicit(&w->bottom, AG_ATOMIC_RELAXED) - 1;
+    ag_atomic_int_64_store_explicit(&w->bottom, b, AG_ATOMIC_RELAXED);
+    ag_atomic_fence(AG_ATOMIC_SEQ_CST);
+    tp = ag_atomic_int_64_load_explicit(&w->top, AG_ATOMIC_RELAXED);
+
+    if (ag_likely (tp <= b)) {
+        t = ag_atomic_ptr_load_explicit(
+                &w->buf[b & (AG_POOL_DEQUE_SIZE - 1)], AG_ATOMIC_RELAXED);
+        if (tp == b) {
+            if (!ag_atomic_int_64_cas_explicit(&w->top, &tp, tp + 1,
+                    AG_ATOMIC_SEQ_CST, AG_ATOMIC_RELAXED))
+                t = NULL;
+            ag_atomic_int_64_store_explicit(&w->bottom, b + 1,
+                    AG_ATOMIC_RELAXED);
+        }
+    } else
+        ag_atomic_int_64_store_explicit(&w->bottom, b + 1, AG_ATOMIC_RELAXED);
+
+    return t;
+}
+
+
+    /* steals a task from the top of the deque of another worker */
+static inline ag_pool_task *
+ag__pool_steal__(struct ag__pool_worker__ *w)
+{
+    ag_int_64 b, tp;
+    ag_pool_task *t;
+
+    tp = ag_atomic_int_64_load_explicit(&w->top, AG_ATOMIC_ACQUIRE);
+    ag_atomic_fence(AG_ATOMIC_SEQ_CST);
+    b = ag_atomic_int_64_load_explicit(&w->bottom, AG_ATOMIC_ACQUIRE);
+
+    if (tp >= b)
+        return NULL;
+
+    t = ag_atomic_ptr_load_explicit(&w->buf[tp & (AG_POOL_DEQUE_SIZE - 1)],
+            AG_ATOMIC_RELAXED);
+    if (!ag_atomic_int_64_cas_explicit(&w->top, &tp, tp + 1,
+            AG_ATOMIC_SEQ_CST, AG_ATOMIC_RELAXED))
+        return NULL;
+
+    return t;
+}
+
+
+    /* wakes a parked worker if there are any; the sequentially consistent
+     * fence pairs with the one taken by a worker before it parks, so that
+     * either the submitter sees the sleeper or the sleeper sees the task */
+static inline void
+ag__pool_notify__(ag_pool *p)
+{
+    ag_atomic_fence(AG_ATOMIC_SEQ_CST);
+    if (ag_atomic_word_32_load_explicit(&p->sleepers, AG_ATOMIC_RELAXED)) {
+        (void) ag_atomic_word_32_fetch_add(&p->epoch, 1);
+        ag_futex_wake(&p->epoch, 1);
+    }
+}
+
+
+static inline void
+ag__pool_run__(ag_pool_task *t)
+{
+    t->erno = t->fn(t->arg);
+    ag_event_set(&t->done);
+}
+
+
+    /* moves all tasks in an inbox to the deque of worker w, and returns one
+     * of them to run */
+static inline ag_pool_task *
+ag__pool_claim__(struct ag__pool_worker__ *w, ag_pool_task **inbox)
+{
+    ag_pool_task *t, *next;
+
+    if (!ag_atomic_ptr_load_explicit(inbox, AG_ATOMIC_RELAXED))
+        return NULL;
+
+    t = ag_atomic_ptr_exchange_explicit(inbox, NULL, AG_ATOMIC_ACQUIRE);
+    if (!t)
+        return NULL;
+
+    while (t->next) {
+        next = t->next;
+        if (ag_unlikely (!ag__pool_push__(w, t)))
+            ag__pool_run__(t);
+        t = next;
+    }
+
+    return t;
+}
+
+
+    /* finds a task for worker w to run, looking first at its own deque and
+     * inbox, and then at those of its peers starting from a random one */
+static inline ag_pool_task *
+ag__pool_find__(struct ag__pool_worker__ *w)
+{
+    ag_pool *p = w->pool;
+    struct ag__pool_worker__ *v;
+    ag_pool_task *t;
+    ag_index i, start;
+
+    if ((t = ag__pool_take__(w)) || (t = ag__pool_claim__(w, &w->inbox)))
+        return t;
+
+    w->seed ^= w->seed << 13;
+    w->seed ^= w->seed >> 7;
+    w->seed ^= w->seed << 17;
+    start = w->seed % p->nworkers;
+
+    for (i = 0; i < p->nworkers; i++) {
+        v = &p->workers[(start + i) % p->nworkers];
+        if (v == w)
+            continue;
+        if ((t = ag__pool_steal__(v)) || (t = ag__pool_claim__(w, &v->inbox)))
+            return t;
+    }
+
+    return NULL;
+}
+
+
+    /* checks whether any work is visible anywhere in the pool */
+static inline ag_bool
+ag__pool_pending__(ag_pool *p)
+{
+    struct ag__pool_worker__ *w;
+    ag_index i;
+
+    for (i = 0; i < p->nworkers; i++) {
+        w = &p->workers[i];
+        if (ag_atomic_ptr_load_explicit(&w->inbox, AG_ATOMIC_RELAXED)
+                || ag_atomic_int_64_load_explicit(&w->top, AG_ATOMIC_RELAXED)
+                < ag_atomic_int_64_load_explicit(&w->bottom,
+                AG_ATOMIC_RELAXED))
+            return AG_BOOL_TRUE;
+    }
+
+    return AG_BOOL_FALSE;
+}
+
+
+static inline void *
+ag__pool_main__(void *arg)
+{
+    struct ag__pool_worker__ *w = (struct ag__pool_worker__ *) arg;
+    ag_pool *p = w->pool;
+    ag_pool_task *t;
+    ag_word_32 epoch;
+    ag_index idle = 0;
+
+    ag__pool_self__ = w;
+
+    while (!ag_atomic_word_32_load_explicit(&p->stop, AG_ATOMIC_ACQUIRE)) {
+        if ((t = ag__pool_find__(w))) {
+            ag__pool_run__(t);
+            idle = 0;
+            continue;
+        }
+
+            /* back off by spinning, then yielding, then parking */
+        if (++idle < 64) {
+            ag_atomic_pause();
+            continue;
+        }
+
+        if (idle < 80) {
+            (void) sched_yield();
+            continue;
+        }
+
+        epoch = ag_atomic_word_32_load_explicit(&p->epoch, AG_ATOMIC_ACQUIRE);
+        (void) ag_atomic_word_32_fetch_add(&p->sleepers, 1);
+        ag_atomic_fence(AG_ATOMIC_SEQ_CST);
+
+        if (!ag__pool_pending__(p) && !ag_atomic_word_32_load_explicit(
+                &p->stop, AG_ATOMIC_ACQUIRE))
+            ag_futex_wait(&p->epoch, epoch);
+
+        (void) ag_atomic_word_32_fetch_sub(&p->sleepers, 1);
+        idle = 0;
+    }
+
+    return NULL;
+}
+
+
+/**
+ * Create thread pool.
+ *
+ * The @c ag_pool_create() function creates a thread pool @p p with @p n worker
+ * threads. If @p n is zero, then one worker is created for each online
+ * processor.
+ *
+ * @param p Pool to create.
+ * @param n Number of worker threads, or zero.
+ *
+ * @return AG_ERNO_NULL if the pool has been created.
+ * @return AG_ERNO_HANDLE if @p p is a null pointer.
+ * @return AG_ERNO_MEMORY if the pool could not be allocated.
+ * @return AG_ERNO_SYSTEM if a worker thread could not be started.
+ *
+ * @see ag_pool_destroy()
+ */
+static inline ag_erno
+ag_pool_create(ag_pool **p, ag_size n)
+{
+    ag_pool *pool = NULL;
+    ag_index i, started = 0;
+    long cpus;
+
+AG_TRY:
+    ag_assert_handle(p);
+
+    if (!n) {
+        cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        n = cpus > 0 ? (ag_size) cpus : 1;
+    }
+
+    pool = (ag_pool *) aligned_alloc(AG_CACHELINE_SIZE, sizeof *pool);
+    ag_assert(pool, AG_ERNO_MEMORY);
+
+    pool->nworkers = n;
+    pool->epoch = pool->sleepers = pool->stop = 0;
+    pool->next = 0;
+    pool->workers = (struct ag__pool_worker__ *) aligned_alloc(
+            AG_CACHELINE_SIZE, n * sizeof *pool->workers);
+    ag_assert(pool->workers, AG_ERNO_MEMORY);
+
+    for (i = 0; i < n; i++) {
+        pool->workers[i].top = pool->workers[i].bottom = 0;
+        pool->workers[i].inbox = NULL;
+        pool->workers[i].pool = pool;
+        pool->workers[i].seed = 0x9e3779b97f4a7c15ull * (i + 1);
+    }
+
+    for (; started < n; started++) {
+        errno = pthread_create(&pool->workers[started].thread, NULL,
+                ag__pool_main__, &pool->workers[started]);
+        ag_assert(!errno, AG_ERNO_SYSTEM);
+    }
+
+    *p = pool;
+
+AG_CATCH:
+    if (pool) {
+        ag_atomic_word_32_store(&pool->stop, 1);
+        (void) ag_atomic_word_32_fetch_add(&pool->epoch, 1);
+        ag_futex_wake(&pool->epoch, INT_MAX);
+        for (i = 0; i < started; i++)
+            (void) pthread_join(pool->workers[i].thread, NULL);
+
+        free(pool->workers);
+        free(pool);
+    }
+
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Destroy thread pool.
+ *
+ * The @c ag_pool_destroy() function stops and joins the worker threads of a
+ * pool @p p, and releases it. All tasks submitted to @p p must have been
+ * waited upon before calling this function.
+ *
+ * @param p Pool to destroy; may be a null pointer.
+ *
+ * @see ag_pool_create()
+ */
+static inline void
+ag_pool_destroy(ag_pool *p)
+{
+    ag_index i;
+
+    if (!p)
+        return;
+
+    ag_atomic_word_32_store(&p->stop, 1);
+    (void) ag_atomic_word_32_fetch_add(&p->epoch, 1);
+    ag_futex_wake(&p->epoch, INT_MAX);
+
+    for (i = 0; i < p->nworkers; i++)
+        (void) pthread_join(p->workers[i].thread, NULL);
+
+    free(p->workers);
+    free(p);
+}
+
+
+/**
+ * Get number of workers.
+ *
+ * The @c ag_pool_workers() function returns the number of worker threads in a
+ * pool @p p.
+ *
+ * @param p Pool to query.
+ *
+ * @return Number of worker threads.
+ */
+static inline ag_pure ag_size
+ag_pool_workers(const ag_pool *p)
+{
+    return p->nworkers;
+}
+
+
+/**
+ * Initialise task.
+ *
+ * The @c ag_pool_task_init() function initialises a task descriptor @p t to
+ * run the function @p fn with the argument @p arg.
+ *
+ * @param t Task to initialise.
+ * @param fn Function to run.
+ * @param arg Argument to pass to @p fn.
+ *
+ * @see ag_pool_submit()
+ */
+static inline void
+ag_pool_task_init(ag_pool_task *t, ag_pool_fn fn, void *arg)
+{
+    t->fn = fn;
+    t->arg = arg;
+    t->next = NULL;
+    t->erno = AG_ERNO_NULL;
+    t->done = AG_EVENT_INIT;
+}
+
+
+/**
+ * Submit task.
+ *
+ * The @c ag_pool_submit() function submits a task @p t, initialised through @c
+ * ag_pool_task_init(), to a pool @p p. When called from a worker thread of @p
+ * p, the task is pushed onto the deque of the worker, where it is likely to be
+ * run by the same worker while its data is still in cache; otherwise, it is
+ * handed to the inbox of a worker chosen in round-robin order.
+ *
+ * @param p Pool to submit to.
+ * @param t Task to submit.
+ *
+ * @see ag_pool_wait()
+ */
+static inline void
+ag_pool_submit(ag_pool *p, ag_pool_task *t)
+{
+    struct ag__pool_worker__ *w = ag__pool_self__;
+    ag_pool_task *head;
+
+    t->done = AG_EVENT_INIT;
+
+    if (w && w->pool == p) {
+        if (ag_unlikely (!ag__pool_push__(w, t))) {
+            ag__pool_run__(t);
+            return;
+        }
+    } else {
+        w = &p->workers[ag_atomic_size_fetch_add_explicit(&p->next, 1,
+                AG_ATOMIC_RELAXED) % p->nworkers];
+        head = ag_atomic_ptr_load_explicit(&w->inbox, AG_ATOMIC_RELAXED);
+        do {
+            t->next = head;
+        } while (!ag_atomic_ptr_cas_weak_explicit(&w->inbox, &head, t,
+                AG_ATOMIC_RELEASE, AG_ATOMIC_RELAXED));
+    }
+
+    ag__pool_notify__(p);
+}
+
+
+/**
+ * Wait for task.
+ *
+ * The @c ag_pool_wait() function waits until a task @p t submitted to a pool
+ * @p p has completed, and returns its completion status. When called from a
+ * worker thread of @p p, the worker runs other tasks while it waits; otherwise
+ * the calling thread sleeps until the task completes.
+ *
+ * @param p Pool that @p t was submitted to.
+ * @param t Task to wait for.
+ *
+ * @return Error code returned by the task function.
+ *
+ * @see ag_pool_submit()
+ */
+static inline ag_erno
+ag_pool_wait(ag_pool *p, ag_pool_task *t)
+{
+    struct ag__pool_worker__ *w = ag__pool_self__;
+    ag_pool_task *other;
+    ag_index spin = 0;
+
+    if (w && w->pool == p) {
+        while (!ag_event_is_set(&t->done)) {
+            if ((other = ag__pool_find__(w)))
+                ag__pool_run__(other);
+            else if (++spin < 64)
+                ag_atomic_pause();
+            else
+                (void) sched_yield();
+        }
+    } else
+        ag_event_wait(&t->done);
+
+    return t->erno;
+}
+
+
+/**
+ * @example pool.h
+ * This is an example showing how to code against the Argent Core Pool Module
+ * interface.
+ * @}
+ */
+
+
+#endif /* !defined ARGENT_CORE_POOL */
@@ -0,0 +1,320 @@
+#if !defined ARGENT_CORE_READER
+#define ARGENT_CORE_READER
+
+
+/**************************************************************************//**
+ * @defgroup reader Argent Core Reader Module
+ * Streaming record reader.
+ *
+ * The Reader Module reads a file descriptor through a buffer, and splits its
+ * contents into lines or records ending with an arbitrary delimiter, each of
+ * which is yielded as a view into the buffer without being copied.
+ *
+ * Delimiters are located through the SIMD Module a 64-byte block at a time:
+ * each block yields a mask of delimiter positions, which successive records
+ * are then split at by popping its lowest bit. This avoids the cost of a
+ * separate @c memchr() call for each record, which dominates when records are
+ * short. A record that spans the end of the buffer is completed by moving it
+ * to the front of the buffer before reading more data; the buffer grows if a
+ * single record does not fit in it.
+ *
+ * @note This module is specific to Linux.
+ *
+ * @warning The views yielded by a reader remain valid only until its next
+ * record is requested, as the buffer may then be refilled.
+ * @{
+ */
+
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "simd.h"
+
+
+/**
+ * Default buffer size.
+ *
+ * The @c AG_READER_SIZE symbolic constant sets the initial size of the buffer
+ * of readers created with a zero size. The default may be overridden by
+ * defining this constant before including this header.
+ *
+ * @see ag_reader_create()
+ */
+#if !defined AG_READER_SIZE
+#   define AG_READER_SIZE 65536
+#endif
+
+
+/**
+ * Record reader.
+ *
+ * The @c ag_reader type reads delimited records from a file descriptor.
+ * Readers are created through @c ag_reader_create().
+ *
+ * @see ag_reader_create()
+ */
+typedef struct ag_reader {
+    ag_string *buf;
+    ag_size size;
+    ag_size head;
+    ag_size tail;
+    ag_size scan;
+    ag_size base;
+    ag_simd_mask mask;
+    ag_erno erno;
+    int fd;
+    int delim;
+    ag_bool eof;
+} ag_reader;
+
+
+    /* allocates a buffer of the given size, with a block of padding at its end
+     * so that the last block of data can always be loaded whole */
+static inline ag_string *
+ag__reader_alloc__(ag_string *buf, ag_size size)
+{
+    if (!(buf = (ag_string *) realloc(buf, size + AG_SIMD_BLOCK)))
+        return NULL;
+
+    memset(buf + size, 0, AG_SIMD_BLOCK);
+    return buf;
+}
+
+
+    /* moves the unconsumed data to the front of the buffer, growing it if it
+     * is full, and reads more data after it */
+static inline ag_erno
+ag__reader_fill__(ag_reader *r)
+{
+    ag_string *buf;
+    ssize_t n;
+
+AG_TRY:
+    if (r->head) {
+        memmove(r->buf, r->buf + r->head, r->tail - r->head);
+        r->tail -= r->head;
+        r->scan -= r->head;
+        r->head = 0;
+    }
+
+    if (r->tail == r->size) {
+        buf = ag__reader_alloc__(r->buf, r->size * 2);
+        ag_assert(buf, AG_ERNO_MEMORY);
+
+        r->buf = buf;
+        r->size *= 2;
+    }
+
+    do
+        n = read(r->fd, r->buf + r->tail, r->size - r->tail);
+    while (n < 0 && errno == EINTR);
+    ag_assert(n >= 0, AG_ERNO_SYSTEM);
+
+    r->tail += (ag_size) n;
+    r->eof = !n;
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Create reader.
+ *
+ * The @c ag_reader_create() function creates a reader @p r over the file
+ * descriptor @p fd, which splits records at the delimiter @p delim, with an
+ * initial buffer of @p size bytes. The reader does not take ownership of @p
+ * fd.
+ *
+ * @param r Reader to create.
+ * @param fd File descriptor to read from.
+ * @param delim Record delimiter.
+ * @param size Initial buffer size, or zero for @c AG_READER_SIZE.
+ *
+ * @return AG_ERNO_NULL if the reader has been created.
+ * @return AG_ERNO_HANDLE if @p r is a null pointer.
+ * @return AG_ERNO_STATE if @p fd is negative.
+ * @return AG_ERNO_MEMORY if the reader could not be allocated.
+ *
+ * @see ag_reader_destroy()
+ */
+static inline ag_erno
+ag_reader_create(ag_reader **r, int fd, int delim, ag_size size)
+{
+    ag_reader *rd = NULL;
+
+AG_TRY:
+    ag_assert_handle(r);
+    ag_assert_state(fd >= 0);
+
+    rd = (ag_reader *) malloc(sizeof *rd);
+    ag_assert(rd, AG_ERNO_MEMORY);
+
+    rd->size = size ? size : AG_READER_SIZE;
+    rd->buf = ag__reader_alloc__(NULL, rd->size);
+    ag_assert(rd->buf, AG_ERNO_MEMORY);
+
+    rd->head = rd->tail = rd->scan = rd->base = 0;
+    rd->mask = 0;
+    rd->erno = AG_ERNO_NULL;
+    rd->fd = fd;
+    rd->delim = delim;
+    rd->eof = false;
+
+    *r = rd;
+
+AG_CATCH:
+    free(rd);
+
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Destroy reader.
+ *
+ * The @c ag_reader_destroy() function releases a reader @p r, invalidating the
+ * views it has yielded. The file descriptor of the reader is not closed.
+ *
+ * @param r Reader to destroy; may be a null pointer.
+ *
+ * @see ag_reader_create()
+ */
+static inline void
+ag_reader_destroy(ag_reader *r)
+{
+    if (r) {
+        free(r->buf);
+        free(r);
+    }
+}
+
+
+/**
+ * Get next record.
+ *
+ * The @c ag_reader_next() function yields the next record read by a reader @p
+ * r, without its delimiter. The last record need not be followed by a
+ * delimiter. Once this function has returned @c false, @c ag_reader_error()
+ * tells whether the end of the file or an error was reached.
+ *
+ * @param r Reader to read from.
+ * @param rec View to receive the record, which remains valid until the next
+ * call.
+ *
+ * @return @c true if a record was read, or @c false otherwise.
+ *
+ * @see ag_reader_line()
+ * @see ag_reader_error()
+ */
+static inline ag_bool
+ag_reader_next(ag_reader *r, ag_string_view *rec)
+{
+    ag_simd_block b;
+    ag_size n;
+    ag_index i;
+
+    while (!r->mask) {
+        if (ag_unlikely (r->scan == r->tail)) {
+            if (r->erno)
+                return false;
+
+            if (r->eof) {
+                if (r->head == r->tail)
+                    return false;
+
+                rec->str = r->buf + r->head;
+                rec->len = r->tail - r->head;
+                r->head = r->tail;
+                return true;
+            }
+
+            if ((r->erno = ag__reader_fill__(r)))
+                return false;
+            continue;
+        }
+
+            /* the padding after the buffer keeps a block near its end
+             * readable, and the bytes past the data are masked off */
+        n = r->tail - r->scan;
+        ag_simd_load(&b, r->buf + r->scan);
+        r->mask = ag_simd_eq(&b, (ag_word_8) r->delim);
+        if (n < AG_SIMD_BLOCK)
+            r->mask &= ((ag_simd_mask) 1 << n) - 1;
+        else
+            n = AG_SIMD_BLOCK;
+
+        r->base = r->scan;
+        r->scan += n;
+    }
+
+    i = r->base + ag_simd_next(&r->mask);
+    rec->str = r->buf + r->head;
+    rec->len = i - r->head;
+    r->head = i + 1;
+
+    return true;
+}
+
+
+/**
+ * Get next line.
+ *
+ * The @c ag_reader_line() function yields the next record read by a reader @p
+ * r, removing a trailing carriage return; with a newline delimiter, this
+ * yields lines ending with either a newline or a carriage return and newline.
+ *
+ * @param r Reader to read from.
+ * @param line View to receive the line, which remains valid until the next
+ * call.
+ *
+ * @return @c true if a line was read, or @c false otherwise.
+ *
+ * @see ag_reader_next()
+ */
+static inline ag_bool
+ag_reader_line(ag_reader *r, ag_string_view *line)
+{
+    if (!ag_reader_next(r, line))
+        return false;
+
+    if (line->len && line->str[line->len - 1] == '\r')
+        line->len--;
+
+    return true;
+}
+
+
+/**
+ * Get reader error.
+ *
+ * The @c ag_reader_error() function gets the error, if any, that stopped a
+ * reader @p r from yielding further records.
+ *
+ * @param r Reader to query.
+ *
+ * @return AG_ERNO_NULL if no error has occurred.
+ * @return AG_ERNO_MEMORY if the buffer could not be grown.
+ * @return AG_ERNO_SYSTEM if the file descriptor could not be read; @c errno
+ * is set to the cause of failure by the failed call.
+ */
+static inline ag_erno
+ag_reader_error(const ag_reader *r)
+{
+    return r->erno;
+}
+
+
+/**
+ * @example reader.h
+ * This is an example showing how to code against the Argent Core Reader
+ * Module interface.
+ * @}
+ */
+
+
+#endif /* !defined ARGENT_CORE_READER */
@@ -0,0 +1,1275 @@
+#if !defined ARGENT_CORE_RECORD
+#define ARGENT_CORE_RECORD
+
+
+/**************************************************************************//**
+ * @defgroup record Argent Core Record Module
+ * Zero-copy binary records.
+ *
+ * The Record Module encodes records of fixed-width scalars and strings in a
+ * compact binary format that is read in place, straight from a receive buffer
+ * or a file mapped through the Mmap Module, without being decoded into another
+ * representation first. Reading a field is a single load at an offset known
+ * from the schema of the record.
+ *
+ * A record starts with a 16-byte header, holding a magic number, the size of
+ * the record, and the identifier, version and field count of its schema. The
+ * fields follow in schema order, each aligned to its own width, with Booleans
+ * taking a byte and strings taking a 32-bit offset and a 32-bit length. The
+ * bytes of the strings follow the fields, each with a terminating null byte,
+ * and the record is padded to a multiple of eight bytes, so that records may
+ * be laid out back to back in a buffer or file and each remains aligned. A
+ * string field with a zero offset and length, as left by a builder when the
+ * field is not set, is an empty string.
+ *
+ * Schemas evolve by appending fields: since each field keeps its offset in
+ * every later version, a record may be read through an older or newer version
+ * of its schema. Fields that a record lacks read as zero or as an empty string,
+ * and fields that the reader does not know of are ignored. The fields of an
+ * existing version must never be removed, reordered or retyped.
+ *
+ * Records are checked once as they are opened, so that the offsets of their
+ * fields and strings all lie within the record; the fields themselves are then
+ * read without further checks.
+ *
+ * @note The format is little-endian, and this module requires a little-endian
+ * host, on which no byte swapping is needed.
+ *
+ * @warning The buffer that records are read from must be aligned to eight
+ * bytes, as memory returned by @c malloc() or @c mmap() is.
+ * @{
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include "core.h"
+
+#if defined __BYTE_ORDER__ && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#   error "The Argent Core Record Module requires a little-endian host"
+#endif
+
+
+/**
+ * Maximum fields.
+ *
+ * The @c AG_RECORD_FIELDS symbolic constant sets the largest number of fields
+ * in a schema. The default may be overridden by defining this constant before
+ * including this header.
+ *
+ * @see ag_record_schema_init()
+ */
+#if !defined AG_RECORD_FIELDS
+#   define AG_RECORD_FIELDS 64
+#endif
+
+
+/**
+ * Record magic number.
+ *
+ * The @c AG_RECORD_MAGIC symbolic constant is the first word of every record,
+ * reading "AGR1" in memory.
+ */
+#define AG_RECORD_MAGIC 0x31524741
+
+
+/**
+ * Record header size.
+ *
+ * The @c AG_RECORD_HEADER symbolic constant is the size of the header that
+ * starts every record.
+ */
+#define AG_RECORD_HEADER 16
+
+
+/**
+ * Boolean field.
+ *
+ * The @c AG_RECORD_BOOL symbolic constant is the type of a Boolean field.
+ *
+ * @see ag_record_schema_init()
+ */
+#define AG_RECORD_BOOL 1
+
+
+/**
+ * 8-bit unsigned integer field.
+ *
+ * The @c AG_RECORD_WORD_8 symbolic constant is the type of an 8-bit unsigned
+ * integer field.
+ *
+ * @see ag_record_schema_init()
+ */
+#define AG_RECORD_WORD_8 2
+
+
+/**
+ * 16-bit unsigned integer field.
+ *
+ * The @c AG_RECORD_WORD_16 symbolic constant is the type of a 16-bit unsigned
+ * integer field.
+ *
+ * @see ag_record_schema_init()
+ */
+#define AG_RECORD_WORD_16 3
+
+
+/**
+ * 32-bit unsigned integer field.
+ *
+ * The @c AG_RECORD_WORD_32 symbolic constant is the type of a 32-bit unsigned
+ * integer field.
+ *
+ * @see ag_record_schema_init()
+ */
+#define AG_RECORD_WORD_32 4
+
+
+/**
+ * 64-bit unsigned integer field.
+ *
+ * The @c AG_RECORD_WORD_64 symbolic constant is the type of a 64-bit unsigned
+ * integer field.
+ *
+ * @see ag_record_schema_init()
+ */
+#define AG_RECORD_WORD_64 5
+
+
+/**
+ * 8-bit signed integer field.
+ *
+ * The @c AG_RECORD_INT_8 symbolic constant is the type of an 8-bit signed
+ * integer field.
+ *
+ * @see ag_record_schema_init()
+ */
+#define AG_RECORD_INT_8 6
+
+
+/**
+ * 16-bit signed integer field.
+ *
+ * The @c AG_RECORD_INT_16 symbolic constant is the type of a 16-bit signed
+ * integer field.
+ *
+ * @see ag_record_schema_init()
+ */
+#define AG_RECORD_INT_16 7
+
+
+/**
+ * 32-bit signed integer field.
+ *
+ * The @c AG_RECORD_INT_32 symbolic constant is the type of a 32-bit signed
+ * integer field.
+ *
+ * @see ag_record_schema_init()
+ */
+#define AG_RECORD_INT_32 8
+
+
+/**
+ * 64-bit signed integer field.
+ *
+ * The @c AG_RECORD_INT_64 symbolic constant is the type of a 64-bit signed
+ * integer field.
+ *
+ * @see ag_record_schema_init()
+ */
+#define AG_RECORD_INT_64 9
+
+
+/**
+ * 32-bit floating point field.
+ *
+ * The @c AG_RECORD_FLOAT_32 symbolic constant is the type of a 32-bit floating
+ * point field.
+ *
+ * @see ag_record_schema_init()
+ */
+#define AG_RECORD_FLOAT_32 10
+
+
+/**
+ * 64-bit floating point field.
+ *
+ * The @c AG_RECORD_FLOAT_64 symbolic constant is the type of a 64-bit floating
+ * point field.
+ *
+ * @see ag_record_schema_init()
+ */
+#define AG_RECORD_FLOAT_64 11
+
+
+/**
+ * String field.
+ *
+ * The @c AG_RECORD_STRING symbolic constant is the type of a string field,
+ * stored as a 32-bit offset and length.
+ *
+ * @see ag_record_schema_init()
+ */
+#define AG_RECORD_STRING 12
+
+
+/**
+ * Record schema.
+ *
+ * The @c ag_record_schema type describes the fields of a version of a record
+ * type, along with their offsets. Schemas are initialised through @c
+ * ag_record_schema_init(), and hold no resources.
+ *
+ * @see ag_record_schema_init()
+ */
+typedef struct ag_record_schema {
+    ag_word_32 offset[AG_RECORD_FIELDS];
+    ag_word_8 type[AG_RECORD_FIELDS];
+    ag_word_32 id;
+    ag_word_32 fixed;
+    ag_word_16 version;
+    ag_word_16 n;
+} ag_record_schema;
+
+
+/**
+ * Record view.
+ *
+ * The @c ag_record type is a view of a record held in a buffer, through which
+ * its fields are read in place. Views are opened through @c
+ * ag_record_open(), hold no resources, and remain valid while the buffer does.
+ *
+ * @see ag_record_open()
+ */
+typedef struct ag_record {
+    const ag_word_8 *base;
+    const ag_record_schema *schema;
+    ag_word_32 size;
+    ag_word_16 version;
+    ag_word_16 n;
+} ag_record;
+
+
+/**
+ * Record builder.
+ *
+ * The @c ag_record_builder type encodes records of a schema into a buffer.
+ * Builders are created through @c ag_record_builder_create(), and may encode
+ * any number of records in turn.
+ *
+ * @see ag_record_builder_create()
+ */
+typedef struct ag_record_builder {
+    const ag_record_schema *schema;
+    ag_word_8 *buf;
+    ag_size len;
+    ag_size cap;
+} ag_record_builder;
+
+
+    /* gets the width of a field type, or zero for an unknown type */
+static inline ag_word_32
+ag__record_width__(int type)
+{
+    static const ag_word_8 width[] = {0, 1, 1, 2, 4, 8, 1, 2, 4, 8, 4, 8, 8};
+
+    return type > 0 && type <= AG_RECORD_STRING ? width[type] : 0;
+}
+
+
+    /* rounds a size up to a multiple of a power of two */
+static inline ag_size
+ag__record_align__(ag_size n, ag_size a)
+{
+    return (n + a - 1) & ~(a - 1);
+}
+
+
+/**
+ * Initialise schema.
+ *
+ * The @c ag_record_schema_init() function initialises a schema @p s with the
+ * identifier @p id and version @p version, whose @p n fields have the types @p
+ * types. Each field is placed after the previous one, at the next multiple of
+ * its width, or of four bytes for strings; a later version of the schema must
+ * therefore keep the types of the earlier version as a prefix of its own.
+ *
+ * @param s Schema to initialise.
+ * @param id Identifier of the record type.
+ * @param version Version of the schema.
+ * @param types Types of the fields, as @c AG_RECORD_BOOL and the like.
+ * @param n Number of fields, at most @c AG_RECORD_FIELDS.
+ *
+ * @return AG_ERNO_NULL if the schema has been initialised.
+ * @return AG_ERNO_HANDLE if @p s or @p types is a null pointer.
+ * @return AG_ERNO_RANGE if @p n exceeds @c AG_RECORD_FIELDS.
+ * @return AG_ERNO_STATE if a type is unknown.
+ */
+static inline ag_erno
+ag_record_schema_init(ag_record_schema *s, ag_word_32 id, ag_word_16 version,
+        const int *types, ag_size n)
+{
+    ag_size off = AG_RECORD_HEADER, k;
+    ag_word_32 w;
+
+AG_TRY:
+    ag_assert_handle(s && types);
+    ag_assert_range(n <= AG_RECORD_FIELDS);
+
+    for (k = 0; k < n; k++) {
+        w = ag__record_width__(types[k]);
+        ag_assert_state(w);
+
+        off = ag__record_align__(off, types[k] == AG_RECORD_STRING ? 4 : w);
+        s->offset[k] = (ag_word_32) off;
+        s->type[k] = (ag_word_8) types[k];
+        off += w;
+    }
+
+    s->id = id;
+    s->fixed = (ag_word_32) off;
+    s->version = version;
+    s->n = (ag_word_16) n;
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Open record.
+ *
+ * The @c ag_record_open() function opens a view @p r of the record at the
+ * start of the buffer @p buf of @p len bytes, to be read through the schema
+ * @p s. The header of the record is checked against @p s, and the fields that
+ * both the record and @p s have, including the strings among them, are checked
+ * to lie within the record.
+ *
+ * The record may have been encoded with another version of the schema; the
+ * next record in the buffer, if any, starts @c ag_record_size() bytes later.
+ *
+ * @param r View to open.
+ * @param s Schema to read the record through.
+ * @param buf Buffer holding the record, aligned to eight bytes.
+ * @param len Length of @p buf.
+ *
+ * @return AG_ERNO_NULL if the record has been opened.
+ * @return AG_ERNO_HANDLE if @p r, @p s or @p buf is a null pointer.
+ * @return AG_ERNO_STATE if @p buf is misaligned, or if the record is not of
+ * the record type of @p s.
+ * @return AG_ERNO_RANGE if the record is truncated or malformed.
+ *
+ * @see ag_record_size()
+ */
+static inline ag_erno
+ag_record_open(ag_record *r, const ag_record_schema *s, const void *buf,
+        ag_size len)
+{
+    const ag_word_8 *p = (const ag_word_8 *) buf;
+    ag_word_32 hdr[3], ref[2];
+    ag_word_16 ver[2];
+    ag_size k, n;
+
+AG_TRY:
+    ag_assert_handle(r && s && buf);
+    ag_assert_state(!((ag_size) p & 7));
+    ag_assert_range(len >= AG_RECORD_HEADER);
+
+    memcpy(hdr, p, sizeof hdr);
+    memcpy(ver, p + sizeof hdr, sizeof ver);
+    ag_assert_state(hdr[0] == AG_RECORD_MAGIC && hdr[2] == s->id);
+    ag_assert_range(hdr[1] >= AG_RECORD_HEADER && hdr[1] <= len
+            && !(hdr[1] & 7));
+
+        /* only the fields known to both sides are ever read */
+    n = ver[1] < s->n ? ver[1] : s->n;
+    if (n)
+        ag_assert_range(s->offset[n - 1] + ag__record_width__(s->type[n - 1])
+                <= hdr[1]);
+
+    for (k = 0; k < n; k++) {
+        if (s->type[k] == AG_RECORD_STRING) {
+            memcpy(ref, p + s->offset[k], sizeof ref);
+            ag_assert_range(ref[0] ? ref[0] >= AG_RECORD_HEADER
+                    && ref[0] < hdr[1] && ref[1] < hdr[1] - ref[0]
+                    && !p[ref[0] + ref[1]] : !ref[1]);
+        }
+    }
+
+    r->base = p;
+    r->schema = s;
+    r->size = hdr[1];
+    r->version = ver[0];
+    r->n = (ag_word_16) n;
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Get record size.
+ *
+ * The @c ag_record_size() function gets the size of the record viewed by @p r,
+ * including its header and padding.
+ *
+ * @param r Record to query.
+ *
+ * @return Size of the record, a multiple of eight bytes.
+ */
+static inline ag_size
+ag_record_size(const ag_record *r)
+{
+    return r->size;
+}
+
+
+/**
+ * Get record version.
+ *
+ * The @c ag_record_version() function gets the version of the schema that the
+ * record viewed by @p r was encoded with.
+ *
+ * @param r Record to query.
+ *
+ * @return Schema version of the record.
+ */
+static inline ag_word_16
+ag_record_version(const ag_record *r)
+{
+    return r->version;
+}
+
+
+/**
+ * Check field presence.
+ *
+ * The @c ag_record_has() function checks whether the record viewed by @p r
+ * holds the field @p k, that is whether the field is known both to the schema
+ * that the record was encoded with and to the schema it is read through.
+ *
+ * @param r Record to query.
+ * @param k Index of the field.
+ *
+ * @return @c true if the record holds the field, or @c false otherwise.
+ */
+static inline ag_bool
+ag_record_has(const ag_record *r, ag_index k)
+{
+    return k < r->n;
+}
+
+
+/**
+ * Get Boolean field.
+ *
+ * The @c ag_record_get_bool() function gets the Boolean field @p k of
+ * the record viewed by @p r, read in place. A field that the record lacks
+ * reads as @c false.
+ *
+ * @param r Record to read.
+ * @param k Index of the field, which must be of type @c AG_RECORD_BOOL.
+ *
+ * @return Value of the field.
+ */
+static inline ag_bool
+ag_record_get_bool(const ag_record *r, ag_index k)
+{
+    return k < r->n && r->base[r->schema->offset[k]];
+}
+
+
+/**
+ * Get 8-bit unsigned integer field.
+ *
+ * The @c ag_record_get_word_8() function gets the 8-bit unsigned integer field
+ * @p k of the record viewed by @p r, read in place. A field that the record
+ * lacks reads as zero.
+ *
+ * @param r Record to read.
+ * @param k Index of the field, which must be of type @c AG_RECORD_WORD_8.
+ *
+ * @return Value of the field.
+ */
+static inline ag_word_8
+ag_record_get_word_8(const ag_record *r, ag_index k)
+{
+    ag_word_8 v = 0;
+
+    if (ag_likely (k < r->n))
+        memcpy(&v, r->base + r->schema->offset[k], sizeof v);
+
+    return v;
+}
+
+
+/**
+ * Get 16-bit unsigned integer field.
+ *
+ * The @c ag_record_get_word_16() function gets the 16-bit unsigned integer
+ * field @p k of the record viewed by @p r, read in place. A field that the
+ * record lacks reads as zero.
+ *
+ * @param r Record to read.
+ * @param k Index of the field, which must be of type @c AG_RECORD_WORD_16.
+ *
+ * @return Value of the field.
+ */
+static inline ag_word_16
+ag_record_get_word_16(const ag_record *r, ag_index k)
+{
+    ag_word_16 v = 0;
+
+    if (ag_likely (k < r->n))
+        memcpy(&v, r->base + r->schema->offset[k], sizeof v);
+
+    return v;
+}
+
+
+/**
+ * Get 32-bit unsigned integer field.
+ *
+ * The @c ag_record_get_word_32() function gets the 32-bit unsigned integer
+ * field @p k of the record viewed by @p r, read in place. A field that the
+ * record lacks reads as zero.
+ *
+ * @param r Record to read.
+ * @param k Index of the field, which must be of type @c AG_RECORD_WORD_32.
+ *
+ * @return Value of the field.
+ */
+static inline ag_word_32
+ag_record_get_word_32(const ag_record *r, ag_index k)
+{
+    ag_word_32 v = 0;
+
+    if (ag_likely (k < r->n))
+        memcpy(&v, r->base + r->schema->offset[k], sizeof v);
+
+    return v;
+}
+
+
+/**
+ * Get 64-bit unsigned integer field.
+ *
+ * The @c ag_record_get_word_64() function gets the 64-bit unsigned integer
+ * field @p k of the record viewed by @p r, read in place. A field that the
+ * record lacks reads as zero.
+ *
+ * @param r Record to read.
+ * @param k Index of the field, which must be of type @c AG_RECORD_WORD_64.
+ *
+ * @return Value of the field.
+ */
+static inline ag_word_64
+ag_record_get_word_64(const ag_record *r, ag_index k)
+{
+    ag_word_64 v = 0;
+
+    if (ag_likely (k < r->n))
+        memcpy(&v, r->base + r->schema->offset[k], sizeof v);
+
+    return v;
+}
+
+
+/**
+ * Get 8-bit signed integer field.
+ *
+ * The @c ag_record_get_int_8() function gets the 8-bit signed integer field @p
+ * k of the record viewed by @p r, read in place. A field that the record lacks
+ * reads as zero.
+ *
+ * @param r Record to read.
+ * @param k Index of the field, which must be of type @c AG_RECORD_INT_8.
+ *
+ * @return Value of the field.
+ */
+static inline ag_int_8
+ag_record_get_int_8(const ag_record *r, ag_index k)
+{
+    ag_int_8 v = 0;
+
+    if (ag_likely (k < r->n))
+        memcpy(&v, r->base + r->schema->offset[k], sizeof v);
+
+    return v;
+}
+
+
+/**
+ * Get 16-bit signed integer field.
+ *
+ * The @c ag_record_get_int_16() function gets the 16-bit signed integer field
+ * @p k of the record viewed by @p r, read in place. A field that the record
+ * lacks reads as zero.
+ *
+ * @param r Record to read.
+ * @param k Index of the field, which must be of type @c AG_RECORD_INT_16.
+ *
+ * @return Value of the field.
+ */
+static inline ag_int_16
+ag_record_get_int_16(const ag_record *r, ag_index k)
+{
+    ag_int_16 v = 0;
+
+    if (ag_likely (k < r->n))
+        memcpy(&v, r->base + r->schema->offset[k], sizeof v);
+
+    return v;
+}
+
+
+/**
+ * Get 32-bit signed integer field.
+ *
+ * The @c ag_record_get_int_32() function gets the 32-bit signed integer field
+ * @p k of the record viewed by @p r, read in place. A field that the record
+ * lacks reads as zero.
+ *
+ * @param r Record to read.
+ * @param k Index of the field, which must be of type @c AG_RECORD_INT_32.
+ *
+ * @return Value of the field.
+ */
+static inline ag_int_32
+ag_record_get_int_32(const ag_record *r, ag_index k)
+{
+    ag_int_32 v = 0;
+
+    if (ag_likely (k < r->n))
+        memcpy(&v, r->base + r->schema->offset[k], sizeof v);
+
+    return v;
+}
+
+
+/**
+ * Get 64-bit signed integer field.
+ *
+ * The @c ag_record_get_int_64() function gets the 64-bit signed integer field
+ * @p k of the record viewed by @p r, read in place. A field that the record
+ * lacks reads as zero.
+ *
+ * @param r Record to read.
+ * @param k Index of the field, which must be of type @c AG_RECORD_INT_64.
+ *
+ * @return Value of the field.
+ */
+static inline ag_int_64
+ag_record_get_int_64(const ag_record *r, ag_index k)
+{
+    ag_int_64 v = 0;
+
+    if (ag_likely (k < r->n))
+        memcpy(&v, r->base + r->schema->offset[k], sizeof v);
+
+    return v;
+}
+
+
+/**
+ * Get 32-bit floating point field.
+ *
+ * The @c ag_record_get_float_32() function gets the 32-bit floating point field
+ * @p k of the record viewed by @p r, read in place. A field that the record
+ * lacks reads as zero.
+ *
+ * @param r Record to read.
+ * @param k Index of the field, which must be of type @c AG_RECORD_FLOAT_32.
+ *
+ * @return Value of the field.
+ */
+static inline ag_float_32
+ag_record_get_float_32(const ag_record *r, ag_index k)
+{
+    ag_float_32 v = 0;
+
+    if (ag_likely (k < r->n))
+        memcpy(&v, r->base + r->schema->offset[k], sizeof v);
+
+    return v;
+}
+
+
+/**
+ * Get 64-bit floating point field.
+ *
+ * The @c ag_record_get_float_64() function gets the 64-bit floating point field
+ * @p k of the record viewed by @p r, read in place. A field that the record
+ * lacks reads as zero.
+ *
+ * @param r Record to read.
+ * @param k Index of the field, which must be of type @c AG_RECORD_FLOAT_64.
+ *
+ * @return Value of the field.
+ */
+static inline ag_float_64
+ag_record_get_float_64(const ag_record *r, ag_index k)
+{
+    ag_float_64 v = 0;
+
+    if (ag_likely (k < r->n))
+        memcpy(&v, r->base + r->schema->offset[k], sizeof v);
+
+    return v;
+}
+
+
+/**
+ * Get string field.
+ *
+ * The @c ag_record_get_string() function gets a view of the string field @p k
+ * of the record viewed by @p r, in place. The string is followed by a null
+ * byte, and so may also be used as a null-terminated string. A field that the
+ * record lacks reads as an empty string.
+ *
+ * @param r Record to read.
+ * @param k Index of the field, which must be a string field.
+ *
+ * @return View of the string.
+ */
+static inline ag_string_view
+ag_record_get_string(const ag_record *r, ag_index k)
+{
+    ag_string_view v = {"", 0};
+    ag_word_32 ref[2];
+
+    if (ag_likely (k < r->n)) {
+        memcpy(ref, r->base + r->schema->offset[k], sizeof ref);
+        if (ref[0]) {
+            v.str = (const ag_string *) r->base + ref[0];
+            v.len = ref[1];
+        }
+    }
+
+    return v;
+}
+
+
+/**
+ * Create builder.
+ *
+ * The @c ag_record_builder_create() function creates a builder @p b that
+ * encodes records of the schema @p s, which must remain valid while the
+ * builder is used. The builder starts with an empty record, all of whose
+ * fields are zero or empty strings.
+ *
+ * @param b Builder to create.
+ * @param s Schema of the records.
+ *
+ * @return AG_ERNO_NULL if the builder has been created.
+ * @return AG_ERNO_HANDLE if @p b or @p s is a null pointer.
+ * @return AG_ERNO_MEMORY if the builder could not be allocated.
+ *
+ * @see ag_record_builder_destroy()
+ */
+static inline ag_erno
+ag_record_builder_create(ag_record_builder **b, const ag_record_schema *s)
+{
+    ag_record_builder *rb = NULL;
+
+AG_TRY:
+    ag_assert_handle(b && s);
+
+    rb = (ag_record_builder *) malloc(sizeof *rb);
+    ag_assert(rb, AG_ERNO_MEMORY);
+
+    rb->schema = s;
+    rb->len = ag__record_align__(s->fixed, 8);
+    rb->cap = rb->len * 2;
+    rb->buf = (ag_word_8 *) calloc(1, rb->cap);
+    ag_assert(rb->buf, AG_ERNO_MEMORY);
+
+    *b = rb;
+
+AG_CATCH:
+    free(rb);
+
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Destroy builder.
+ *
+ * The @c ag_record_builder_destroy() function releases a builder @p b, along
+ * with the record it has encoded.
+ *
+ * @param b Builder to destroy; may be a null pointer.
+ *
+ * @see ag_record_builder_create()
+ */
+static inline void
+ag_record_builder_destroy(ag_record_builder *b)
+{
+    if (b) {
+        free(b->buf);
+        free(b);
+    }
+}
+
+
+/**
+ * Reset builder.
+ *
+ * The @c ag_record_builder_reset() function discards the record encoded by a
+ * builder @p b, and starts an empty record.
+ *
+ * @param b Builder to reset.
+ */
+static inline void
+ag_record_builder_reset(ag_record_builder *b)
+{
+    b->len = ag__record_align__(b->schema->fixed, 8);
+    memset(b->buf, 0, b->len);
+}
+
+
+    /* gets the address of a field of the record being built, checking that
+     * the field has the given type */
+static inline ag_erno
+ag__record_slot__(ag_record_builder *b, ag_index k, int type, void **p)
+{
+AG_TRY:
+    ag_assert_handle(b);
+    ag_assert_range(k < b->schema->n);
+    ag_assert_state(b->schema->type[k] == type);
+
+    *p = b->buf + b->schema->offset[k];
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Set Boolean field.
+ *
+ * The @c ag_record_set_bool() function sets the Boolean field @p k of
+ * the record being built by @p b to @p v.
+ *
+ * @param b Builder to set.
+ * @param k Index of the field.
+ * @param v Value to set.
+ *
+ * @return AG_ERNO_NULL if the field has been set.
+ * @return AG_ERNO_HANDLE if @p b is a null pointer.
+ * @return AG_ERNO_RANGE if @p k is not a field of the schema.
+ * @return AG_ERNO_STATE if the field is not of type @c AG_RECORD_BOOL.
+ */
+static inline ag_erno
+ag_record_set_bool(ag_record_builder *b, ag_index k, ag_bool v)
+{
+    void *p;
+    ag_erno e;
+
+    if (!(e = ag__record_slot__(b, k, AG_RECORD_BOOL, &p)))
+        memcpy(p, &v, sizeof v);
+
+    return e;
+}
+
+
+/**
+ * Set 8-bit unsigned integer field.
+ *
+ * The @c ag_record_set_word_8() function sets the 8-bit unsigned integer field
+ * @p k of the record being built by @p b to @p v.
+ *
+ * @param b Builder to set.
+ * @param k Index of the field.
+ * @param v Value to set.
+ *
+ * @return AG_ERNO_NULL if the field has been set.
+ * @return AG_ERNO_HANDLE if @p b is a null pointer.
+ * @return AG_ERNO_RANGE if @p k is not a field of the schema.
+ * @return AG_ERNO_STATE if the field is not of type @c AG_RECORD_WORD_8.
+ */
+static inline ag_erno
+ag_record_set_word_8(ag_record_builder *b, ag_index k, ag_word_8 v)
+{
+    void *p;
+    ag_erno e;
+
+    if (!(e = ag__record_slot__(b, k, AG_RECORD_WORD_8, &p)))
+        memcpy(p, &v, sizeof v);
+
+    return e;
+}
+
+
+/**
+ * Set 16-bit unsigned integer field.
+ *
+ * The @c ag_record_set_word_16() function sets the 16-bit unsigned integer
+ * field @p k of the record being built by @p b to @p v.
+ *
+ * @param b Builder to set.
+ * @param k Index of the field.
+ * @param v Value to set.
+ *
+ * @return AG_ERNO_NULL if the field has been set.
+ * @return AG_ERNO_HANDLE if @p b is a null pointer.
+ * @return AG_ERNO_RANGE if @p k is not a field of the schema.
+ * @return AG_ERNO_STATE if the field is not of type @c AG_RECORD_WORD_16.
+ */
+static inline ag_erno
+ag_record_set_word_16(ag_record_builder *b, ag_index k, ag_word_16 v)
+{
+    void *p;
+    ag_erno e;
+
+    if (!(e = ag__record_slot__(b, k, AG_RECORD_WORD_16, &p)))
+        memcpy(p, &v, sizeof v);
+
+    return e;
+}
+
+
+/**
+ * Set 32-bit unsigned integer field.
+ *
+ * The @c ag_record_set_word_32() function sets the 32-bit unsigned integer
+ * field @p k of the record being built by @p b to @p v.
+ *
+ * @param b Builder to set.
+ * @param k Index of the field.
+ * @param v Value to set.
+ *
+ * @return AG_ERNO_NULL if the field has been set.
+ * @return AG_ERNO_HANDLE if @p b is a null pointer.
+ * @return AG_ERNO_RANGE if @p k is not a field of the schema.
+ * @return AG_ERNO_STATE if the field is not of type @c AG_RECORD_WORD_32.
+ */
+static inline ag_erno
+ag_record_set_word_32(ag_record_builder *b, ag_index k, ag_word_32 v)
+{
+    void *p;
+    ag_erno e;
+
+    if (!(e = ag__record_slot__(b, k, AG_RECORD_WORD_32, &p)))
+        memcpy(p, &v, sizeof v);
+
+    return e;
+}
+
+
+/**
+ * Set 64-bit unsigned integer field.
+ *
+ * The @c ag_record_set_word_64() function sets the 64-bit unsigned integer
+ * field @p k of the record being built by @p b to @p v.
+ *
+ * @param b Builder to set.
+ * @param k Index of the field.
+ * @param v Value to set.
+ *
+ * @return AG_ERNO_NULL if the field has been set.
+ * @return AG_ERNO_HANDLE if @p b is a null pointer.
+ * @return AG_ERNO_RANGE if @p k is not a field of the schema.
+ * @return AG_ERNO_STATE if the field is not of type @c AG_RECORD_WORD_64.
+ */
+static inline ag_erno
+ag_record_set_word_64(ag_record_builder *b, ag_index k, ag_word_64 v)
+{
+    void *p;
+    ag_erno e;
+
+    if (!(e = ag__record_slot__(b, k, AG_RECORD_WORD_64, &p)))
+        memcpy(p, &v, sizeof v);
+
+    return e;
+}
+
+
+/**
+ * Set 8-bit signed integer field.
+ *
+ * The @c ag_record_set_int_8() function sets the 8-bit signed integer field @p
+ * k of the record being built by @p b to @p v.
+ *
+ * @param b Builder to set.
+ * @param k Index of the field.
+ * @param v Value to set.
+ *
+ * @return AG_ERNO_NULL if the field has been set.
+ * @return AG_ERNO_HANDLE if @p b is a null pointer.
+ * @return AG_ERNO_RANGE if @p k is not a field of the schema.
+ * @return AG_ERNO_STATE if the field is not of type @c AG_RECORD_INT_8.
+ */
+static inline ag_erno
+ag_record_set_int_8(ag_record_builder *b, ag_index k, ag_int_8 v)
+{
+    void *p;
+    ag_erno e;
+
+    if (!(e = ag__record_slot__(b, k, AG_RECORD_INT_8, &p)))
+        memcpy(p, &v, sizeof v);
+
+    return e;
+}
+
+
+/**
+ * Set 16-bit signed integer field.
+ *
+ * The @c ag_record_set_int_16() function sets the 16-bit signed integer field
+ * @p k of the record being built by @p b to @p v.
+ *
+ * @param b Builder to set.
+ * @param k Index of the field.
+ * @param v Value to set.
+ *
+ * @return AG_ERNO_NULL if the field has been set.
+ * @return AG_ERNO_HANDLE if @p b is a null pointer.
+ * @return AG_ERNO_RANGE if @p k is not a field of the schema.
+ * @return AG_ERNO_STATE if the field is not of type @c AG_RECORD_INT_16.
+ */
+static inline ag_erno
+ag_record_set_int_16(ag_record_builder *b, ag_index k, ag_int_16 v)
+{
+    void *p;
+    ag_erno e;
+
+    if (!(e = ag__record_slot__(b, k, AG_RECORD_INT_16, &p)))
+        memcpy(p, &v, sizeof v);
+
+    return e;
+}
+
+
+/**
+ * Set 32-bit signed integer field.
+ *
+ * The @c ag_record_set_int_32() function sets the 32-bit signed integer field
+ * @p k of the record being built by @p b to @p v.
+ *
+ * @param b Builder to set.
+ * @param k Index of the field.
+ * @param v Value to set.
+ *
+ * @return AG_ERNO_NULL if the field has been set.
+ * @return AG_ERNO_HANDLE if @p b is a null pointer.
+ * @return AG_ERNO_RANGE if @p k is not a field of the schema.
+ * @return AG_ERNO_STATE if the field is not of type @c AG_RECORD_INT_32.
+ */
+static inline ag_erno
+ag_record_set_int_32(ag_record_builder *b, ag_index k, ag_int_32 v)
+{
+    void *p;
+    ag_erno e;
+
+    if (!(e = ag__record_slot__(b, k, AG_RECORD_INT_32, &p)))
+        memcpy(p, &v, sizeof v);
+
+    return e;
+}
+
+
+/**
+ * Set 64-bit signed integer field.
+ *
+ * The @c ag_record_set_int_64() function sets the 64-bit signed integer field
+ * @p k of the record being built by @p b to @p v.
+ *
+ * @param b Builder to set.
+ * @param k Index of the field.
+ * @param v Value to set.
+ *
+ * @return AG_ERNO_NULL if the field has been set.
+ * @return AG_ERNO_HANDLE if @p b is a null pointer.
+ * @return AG_ERNO_RANGE if @p k is not a field of the schema.
+ * @return AG_ERNO_STATE if the field is not of type @c AG_RECORD_INT_64.
+ */
+static inline ag_erno
+ag_record_set_int_64(ag_record_builder *b, ag_index k, ag_int_64 v)
+{
+    void *p;
+    ag_erno e;
+
+    if (!(e = ag__record_slot__(b, k, AG_RECORD_INT_64, &p)))
+        memcpy(p, &v, sizeof v);
+
+    return e;
+}
+
+
+/**
+ * Set 32-bit floating point field.
+ *
+ * The @c ag_record_set_float_32() function sets the 32-bit floating point field
+ * @p k of the record being built by @p b to @p v.
+ *
+ * @param b Builder to set.
+ * @param k Index of the field.
+ * @param v Value to set.
+ *
+ * @return AG_ERNO_NULL if the field has been set.
+ * @return AG_ERNO_HANDLE if @p b is a null pointer.
+ * @return AG_ERNO_RANGE if @p k is not a field of the schema.
+ * @return AG_ERNO_STATE if the field is not of type @c AG_RECORD_FLOAT_32.
+ */
+static inline ag_erno
+ag_record_set_float_32(ag_record_builder *b, ag_index k, ag_float_32 v)
+{
+    void *p;
+    ag_erno e;
+
+    if (!(e = ag__record_slot__(b, k, AG_RECORD_FLOAT_32, &p)))
+        memcpy(p, &v, sizeof v);
+
+    return e;
+}
+
+
+/**
+ * Set 64-bit floating point field.
+ *
+ * The @c ag_record_set_float_64() function sets the 64-bit floating point field
+ * @p k of the record being built by @p b to @p v.
+ *
+ * @param b Builder to set.
+ * @param k Index of the field.
+ * @param v Value to set.
+ *
+ * @return AG_ERNO_NULL if the field has been set.
+ * @return AG_ERNO_HANDLE if @p b is a null pointer.
+ * @return AG_ERNO_RANGE if @p k is not a field of the schema.
+ * @return AG_ERNO_STATE if the field is not of type @c AG_RECORD_FLOAT_64.
+ */
+static inline ag_erno
+ag_record_set_float_64(ag_record_builder *b, ag_index k, ag_float_64 v)
+{
+    void *p;
+    ag_erno e;
+
+    if (!(e = ag__record_slot__(b, k, AG_RECORD_FLOAT_64, &p)))
+        memcpy(p, &v, sizeof v);
+
+    return e;
+}
+
+
+/**
+ * Set string field.
+ *
+ * The @c ag_record_set_string() function sets the string field @p k of the
+ * record being built by @p b to the @p len bytes at @p s, which are copied
+ * into the record along with a terminating null byte. Setting a string field
+ * again leaves the earlier string in the record as dead space.
+ *
+ * @param b Builder to set.
+ * @param k Index of the field.
+ * @param s String to set; may be a null pointer if @p len is zero.
+ * @param len Length of @p s.
+ *
+ * @return AG_ERNO_NULL if the field has been set.
+ * @return AG_ERNO_HANDLE if @p b is a null pointer.
+ * @return AG_ERNO_RANGE if @p k is not a field of the schema, or if the record
+ * would exceed 4 GiB.
+ * @return AG_ERNO_STATE if the field is not of type @c AG_RECORD_STRING.
+ * @return AG_ERNO_MEMORY if the buffer could not be grown.
+ */
+static inline ag_erno
+ag_record_set_string(ag_record_builder *b, ag_index k, const ag_string *s,
+        ag_size len)
+{
+    ag_word_8 *buf;
+    ag_word_32 ref[2];
+    ag_size cap;
+    void *p;
+
+AG_TRY:
+    ag_try(ag__record_slot__(b, k, AG_RECORD_STRING, &p));
+    ag_assert_range(len < 0xfffffff0 - b->len);
+
+        /* room is kept for the padding added when the record is finished */
+    if (b->cap - b->len < len + 8) {
+        for (cap = b->cap * 2; cap - b->len < len + 8; cap *= 2);
+
+        buf = (ag_word_8 *) realloc(b->buf, cap);
+        ag_assert(buf, AG_ERNO_MEMORY);
+
+        b->buf = buf;
+        b->cap = cap;
+    }
+
+    ref[0] = (ag_word_32) b->len;
+    ref[1] = (ag_word_32) len;
+    memcpy(b->buf + b->schema->offset[k], ref, sizeof ref);
+
+    if (len)
+        memcpy(b->buf + b->len, s, len);
+    b->buf[b->len + len] = '\0';
+    b->len += len + 1;
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Finish record.
+ *
+ * The @c ag_record_builder_finish() function completes the record being built
+ * by @p b, writing its header and padding, and gets the encoded bytes. The
+ * bytes remain valid until the builder is next set, reset or destroyed, and
+ * may be sent or written as they are. Finishing the record again after more
+ * fields are set yields the updated record.
+ *
+ * @param b Builder to finish.
+ * @param data Set to the encoded record.
+ * @param len Set to the length of the encoded record.
+ *
+ * @return AG_ERNO_NULL if the record has been finished.
+ * @return AG_ERNO_HANDLE if @p b, @p data or @p len is a null pointer.
+ */
+static inline ag_erno
+ag_record_builder_finish(ag_record_builder *b, const void **data,
+        ag_size *len)
+{
+    ag_word_32 hdr[3];
+    ag_word_16 ver[2];
+    ag_size n;
+
+AG_TRY:
+    ag_assert_handle(b && data && len);
+
+    n = ag__record_align__(b->len, 8);
+    memset(b->buf + b->len, 0, n - b->len);
+
+    hdr[0] = AG_RECORD_MAGIC;
+    hdr[1] = (ag_word_32) n;
+    hdr[2] = b->schema->id;
+    ver[0] = b->schema->version;
+    ver[1] = b->schema->n;
+    memcpy(b->buf, hdr, sizeof hdr);
+    memcpy(b->buf + sizeof hdr, ver, sizeof ver);
+
+    *data = b->buf;
+    *len = n;
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * @example record.h
+ * This is an example showing how to code against the Argent Core Record
+ * Module interface.
+ * @}
+ */
+
+
+#endif /* !defined ARGENT_CORE_RECORD */
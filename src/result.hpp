@@ -0,0 +1,540 @@
+#if !defined ARGENT_CORE_RESULT
+#define ARGENT_CORE_RESULT
+
+
+/**************************************************************************//**
+ * @defgroup result Argent Core Result Module
+ * C++ result type interoperable with error codes.
+ *
+ * The Result Module provides the @c ag::result<T> class template for C++17
+ * client code. A result holds either a value of type @c T or an @c ag_erno
+ * error code, so that C++ code can report errors the same way as C code that
+ * uses the Error Handling Module, without resorting to exceptions.
+ *
+ * A result is marked @c [[nodiscard]] so that errors cannot be silently
+ * ignored, and it is trivially copyable whenever @c T is, which allows small
+ * results to be returned in registers. Results may be chained through the @c
+ * map(), @c and_then() and @c or_else() member functions, and converted to and
+ * from the error codes used by the @c AG_TRY family of macros.
+ * @{
+ */
+
+
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "core.h"
+
+
+namespace ag {
+
+
+/**
+ * Error tag.
+ *
+ * The @c ag::error structure wraps an @c ag_erno error code so that a failed
+ * @c ag::result<T> can be constructed unambiguously, even when @c T is itself
+ * constructible from an integer.
+ *
+ * @see ag::fail()
+ */
+struct error {
+    ag_erno erno;
+};
+
+
+/**
+ * Make error tag.
+ *
+ * The @c ag::fail() function wraps an error code @p e in an @c ag::error tag,
+ * which can be returned from a function that returns an @c ag::result<T>.
+ *
+ * @param e Error code; must not be @c AG_ERNO_NULL.
+ *
+ * @return Error tag wrapping @p e.
+ */
+constexpr error
+fail(ag_erno e) noexcept
+{
+    return error {e};
+}
+
+
+template <typename T> class result;
+
+
+namespace detail {
+
+
+    /* trivially copyable types are stored in a union with defaulted special
+     * members, so that the result itself remains trivially copyable */
+template <typename T, bool = std::is_trivially_copyable_v<T>
+        && std::is_trivially_destructible_v<T>>
+struct storage {
+    union {
+        char none;
+        T val;
+    };
+    ag_erno erno;
+
+    constexpr storage(ag_erno e) noexcept : none(), erno(e) {}
+
+    template <typename... A> constexpr
+    storage(std::in_place_t, A &&...a) : val(std::forward<A>(a)...),
+            erno(AG_ERNO_NULL) {}
+};
+
+
+    /* other types need their lifetime managed explicitly */
+template <typename T>
+struct storage<T, false> {
+    union {
+        char none;
+        T val;
+    };
+    ag_erno erno;
+
+    storage(ag_erno e) noexcept : none(), erno(e) {}
+
+    template <typename... A>
+    storage(std::in_place_t, A &&...a) : val(std::forward<A>(a)...),
+            erno(AG_ERNO_NULL) {}
+
+    storage(const storage &s) : none(), erno(s.erno)
+    {
+        if (!erno)
+            new (&val) T(s.val);
+    }
+
+    storage(storage &&s) noexcept(std::is_nothrow_move_constructible_v<T>)
+            : none(), erno(s.erno)
+    {
+        if (!erno)
+            new (&val) T(std::move(s.val));
+    }
+
+        /* a value is only destroyed once its replacement exists, so that a
+         * throwing copy or move leaves this storage as it was */
+    storage &
+    operator=(const storage &s)
+    {
+        if (this != &s) {
+            if (!erno && !s.erno)
+                val = s.val;
+            else if (!s.erno) {
+                new (&val) T(s.val);
+                erno = AG_ERNO_NULL;
+            } else {
+                if (!erno)
+                    val.~T();
+                erno = s.erno;
+            }
+        }
+
+        return *this;
+    }
+
+    storage &
+    operator=(storage &&s) noexcept(std::is_nothrow_move_constructible_v<T>
+            && std::is_nothrow_move_assignable_v<T>)
+    {
+        if (this != &s) {
+            if (!erno && !s.erno)
+                val = std::move(s.val);
+            else if (!s.erno) {
+                new (&val) T(std::move(s.val));
+                erno = AG_ERNO_NULL;
+            } else {
+                if (!erno)
+                    val.~T();
+                erno = s.erno;
+            }
+        }
+
+        return *this;
+    }
+
+    ~storage()
+    {
+        if (!erno)
+            val.~T();
+    }
+};
+
+
+template <typename R>
+struct is_result : std::false_type {};
+
+template <typename T>
+struct is_result<result<T>> : std::true_type {};
+
+
+} /* namespace detail */
+
+
+/**
+ * Value or error code.
+ *
+ * The @c ag::result<T> class template holds either a value of type @c T, or an
+ * @c ag_erno error code other than @c AG_ERNO_NULL. The value accessors do
+ * @b not check whether the result holds a value; this must be verified first
+ * through @c ok() or the conversion to @c bool.
+ *
+ * @tparam T Type of value held on success.
+ *
+ * @see ag::fail()
+ * @see ag::result<void>
+ */
+template <typename T>
+class [[nodiscard]] result {
+    static_assert(!std::is_reference_v<T>, "ag::result<T&> is not supported");
+
+    detail::storage<T> s_;
+
+public:
+    using value_type = T;
+
+    /**
+     * Construct successful result from value @p v.
+     */
+    constexpr result(const T &v) : s_(std::in_place, v) {}
+
+    /**
+     * Construct successful result by moving value @p v.
+     */
+    constexpr result(T &&v) : s_(std::in_place, std::move(v)) {}
+
+    /**
+     * Construct successful result in place from arguments @p a.
+     */
+    template <typename... A> constexpr explicit
+    result(std::in_place_t, A &&...a) : s_(std::in_place,
+            std::forward<A>(a)...) {}
+
+    /**
+     * Construct failed result from error tag @p e; a tag wrapping @c
+     * AG_ERNO_NULL, which cannot stand for a value, yields @c AG_ERNO_STATE.
+     */
+    constexpr result(error e) noexcept : s_(e.erno ? e.erno
+            : AG_ERNO_STATE) {}
+
+    /**
+     * Check whether result holds a value.
+     */
+    constexpr bool
+    ok() const noexcept
+    {
+        return ag_likely (!s_.erno);
+    }
+
+    /**
+     * Check whether result holds a value.
+     */
+    constexpr explicit
+    operator bool() const noexcept
+    {
+        return ok();
+    }
+
+    /**
+     * Get error code; @c AG_ERNO_NULL if the result holds a value.
+     */
+    constexpr ag_erno
+    erno() const noexcept
+    {
+        return s_.erno;
+    }
+
+    /**
+     * Get value held; the result must be @c ok().
+     */
+    constexpr T &
+    value() & noexcept
+    {
+        return s_.val;
+    }
+
+    /**
+     * Get value held; the result must be @c ok().
+     */
+    constexpr const T &
+    value() const & noexcept
+    {
+        return s_.val;
+    }
+
+    /**
+     * Move out value held; the result must be @c ok().
+     */
+    constexpr T &&
+    value() && noexcept
+    {
+        return std::move(s_.val);
+    }
+
+    constexpr T &operator*() & noexcept { return s_.val; }
+    constexpr const T &operator*() const & noexcept { return s_.val; }
+    constexpr T &&operator*() && noexcept { return std::move(s_.val); }
+    constexpr T *operator->() noexcept { return &s_.val; }
+    constexpr const T *operator->() const noexcept { return &s_.val; }
+
+    /**
+     * Get value held, or @p d if the result holds an error code.
+     */
+    template <typename U> constexpr T
+    value_or(U &&d) const &
+    {
+        return ok() ? s_.val : static_cast<T>(std::forward<U>(d));
+    }
+
+    /**
+     * Transform value.
+     *
+     * Applies @p f to the value held and returns its return value wrapped in
+     * a result; an error code is passed through unchanged.
+     */
+    template <typename F> constexpr auto
+    map(F &&f) const &
+    {
+        using U = std::invoke_result_t<F, const T &>;
+
+        if (ag_unlikely (!ok()))
+            return result<U>(fail(s_.erno));
+
+        if constexpr (std::is_void_v<U>) {
+            std::forward<F>(f)(s_.val);
+            return result<U>();
+        } else
+            return result<U>(std::forward<F>(f)(s_.val));
+    }
+
+    /**
+     * Chain fallible operation.
+     *
+     * Applies @p f, which must itself return a result, to the value held; an
+     * error code is passed through unchanged.
+     */
+    template <typename F> constexpr auto
+    and_then(F &&f) const &
+    {
+        using R = std::invoke_result_t<F, const T &>;
+        static_assert(detail::is_result<R>::value,
+                "and_then() requires a function returning ag::result");
+
+        if (ag_unlikely (!ok()))
+            return R(fail(s_.erno));
+
+        return std::forward<F>(f)(s_.val);
+    }
+
+    /**
+     * Recover from error.
+     *
+     * Applies @p f to the error code held, which must return a result of the
+     * same type; a value is passed through unchanged.
+     */
+    template <typename F> constexpr result
+    or_else(F &&f) const &
+    {
+        if (ag_likely (ok()))
+            return *this;
+
+        return std::forward<F>(f)(s_.erno);
+    }
+
+    /**
+     * Recover from error, moving out a value held.
+     */
+    template <typename F> constexpr result
+    or_else(F &&f) &&
+    {
+        if (ag_likely (ok()))
+            return std::move(*this);
+
+        return std::forward<F>(f)(s_.erno);
+    }
+};
+
+
+/**
+ * Error code only.
+ *
+ * The @c ag::result<void> specialisation holds only an @c ag_erno error code,
+ * and is the C++ counterpart of a C function returning @c ag_erno.
+ *
+ * @see ag::check()
+ */
+template <>
+class [[nodiscard]] result<void> {
+    ag_erno erno_;
+
+public:
+    using value_type = void;
+
+    /**
+     * Construct successful result.
+     */
+    constexpr result() noexcept : erno_(AG_ERNO_NULL) {}
+
+    /**
+     * Construct failed result from error tag @p e.
+     */
+    constexpr result(error e) noexcept : erno_(e.erno) {}
+
+    constexpr bool ok() const noexcept { return ag_likely (!erno_); }
+    constexpr explicit operator bool() const noexcept { return ok(); }
+    constexpr ag_erno erno() const noexcept { return erno_; }
+
+    template <typename F> constexpr auto
+    map(F &&f) const
+    {
+        using U = std::invoke_result_t<F>;
+
+        if (ag_unlikely (!ok()))
+            return result<U>(fail(erno_));
+
+        if constexpr (std::is_void_v<U>) {
+            std::forward<F>(f)();
+            return result<U>();
+        } else
+            return result<U>(std::forward<F>(f)());
+    }
+
+    template <typename F> constexpr auto
+    and_then(F &&f) const
+    {
+        using R = std::invoke_result_t<F>;
+        static_assert(detail::is_result<R>::value,
+                "and_then() requires a function returning ag::result");
+
+        if (ag_unlikely (!ok()))
+            return R(fail(erno_));
+
+        return std::forward<F>(f)();
+    }
+
+    template <typename F> constexpr result
+    or_else(F &&f) const
+    {
+        if (ag_likely (ok()))
+            return *this;
+
+        return std::forward<F>(f)(erno_);
+    }
+};
+
+
+/**
+ * Adapt error code to result.
+ *
+ * The @c ag::check() function converts the error code @p e returned by a C
+ * function, or by @c ag_erno_get() at the end of an @c AG_FINALLY block, into
+ * an @c ag::result<void>.
+ *
+ * @param e Error code to adapt.
+ *
+ * @return Result holding @p e.
+ */
+constexpr result<void>
+check(ag_erno e) noexcept
+{
+    return e ? result<void>(fail(e)) : result<void>();
+}
+
+
+/**
+ * Adapt error code and value to result.
+ *
+ * The @c ag::check() function converts the error code @p e along with the
+ * value @p v produced on success into an @c ag::result<T>.
+ *
+ * @param e Error code to adapt.
+ * @param v Value to hold if @p e is @c AG_ERNO_NULL.
+ *
+ * @return Result holding either @p v or @p e.
+ */
+template <typename T> constexpr result<std::decay_t<T>>
+check(ag_erno e, T &&v)
+{
+    if (ag_unlikely (e))
+        return fail(e);
+
+    return result<std::decay_t<T>>(std::forward<T>(v));
+}
+
+
+/**
+ * Call C function with output parameter.
+ *
+ * The @c ag::call() function calls a C function @p f that returns an @c
+ * ag_erno and writes its output through a trailing pointer parameter of type
+ * @c T*, and adapts the call into an @c ag::result<T>. The arguments @p a are
+ * passed ahead of the output pointer.
+ *
+ * @tparam T Type of output value; must be default constructible.
+ *
+ * @param f C function to call.
+ * @param a Arguments to pass to @p f.
+ *
+ * @return Result holding either the output value or the error code.
+ */
+template <typename T, typename F, typename... A> result<T>
+call(F &&f, A &&...a)
+{
+    T out {};
+    ag_erno e = std::forward<F>(f)(std::forward<A>(a)..., &out);
+
+    if (ag_unlikely (e))
+        return fail(e);
+
+    return result<T>(std::move(out));
+}
+
+
+static_assert(std::is_trivially_copyable_v<result<ag_word>>);
+static_assert(std::is_trivially_copyable_v<result<void>>);
+static_assert(sizeof (result<void>) == sizeof (ag_erno));
+
+
+} /* namespace ag */
+
+
+/**
+ * Validate result postcondition.
+ *
+ * The @c ag_try_result() macro is the @c ag::result<T> counterpart of @c
+ * ag_try(). It evaluates the result @p r, and if it holds an error code then
+ * the error code is raised in the current context and control jumps to the
+ * adjacent @c AG_CATCH block; otherwise the value held is assigned to @p v.
+ * The value is moved out of @p r if it is an rvalue, and copied otherwise.
+ *
+ * @param r Result being evaluated.
+ * @param v Variable to receive the value held by @p r.
+ *
+ * @warning This macro can only be called within an @c AG_TRY block; it should
+ * @b never be called within an @c AG_CATCH or @c AG_FINALLY block as it may
+ * lead to an infinite loop.
+ *
+ * @see AG_TRY
+ * @see ag_try()
+ */
+#define ag_try_result(r, v)                                    \
+do {                                                           \
+    decltype(auto) ag__result__ = (r);                         \
+    if (ag_unlikely (ag__erno__ = ag__result__.erno())) {      \
+        AG__ERNO_PROPAGATED__ (ag__erno__);                    \
+        goto AG__CATCH__;                                      \
+    }                                                          \
+    (v) = *std::forward<decltype(ag__result__)>(ag__result__); \
+} while (0)
+
+
+/**
+ * @example result.hpp
+ * This is an example showing how to code against the Argent Core Result
+ * Module interface.
+ * @}
+ */
+
+
+#endif /* !defined ARGENT_CORE_RESULT */
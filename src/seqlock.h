@@ -0,0 +1,287 @@
+#if !defined ARGENT_CORE_SEQLOCK
+#define ARGENT_CORE_SEQLOCK
+
+
+/**************************************************************************//**
+ * @defgroup seqlock Argent Core Seqlock Module
+ * Sequence locks for read-mostly records.
+ *
+ * The Seqlock Module provides sequence locks, which guard small records that
+ * are read far more often than they are written, such as configuration
+ * snapshots or clocks. Readers never write to the lock, so that any number of
+ * them may read the record concurrently without the cache line of the lock
+ * bouncing between processors. Instead, readers check that the sequence
+ * number of the lock did not change while they were reading, and retry if it
+ * did.
+ *
+ * Writers exclude each other through the sequence number itself, and are
+ * never held back by readers. A writer thus makes progress even under heavy
+ * read load, though readers may retry repeatedly under heavy write load.
+ *
+ * Since a reader may observe a record while it is being written, the record
+ * must be copied out before it is used, and must not contain pointers that
+ * are followed before the read is validated. The copy functions of this
+ * module perform such copies without data races.
+ * @{
+ */
+
+
+#include <string.h>
+#include "atomic.h"
+
+
+/**
+ * Sequence lock.
+ *
+ * The @c ag_seqlock type is a sequence lock, whose sequence number is odd
+ * while a writer holds the lock and even otherwise.
+ *
+ * @see AG_SEQLOCK_INIT
+ * @see ag_seqlock_read_begin()
+ * @see ag_seqlock_write_begin()
+ */
+typedef struct ag_seqlock {
+    ag_word_32 seq;
+} ag_seqlock;
+
+
+/**
+ * Static sequence lock initialiser.
+ *
+ * The @c AG_SEQLOCK_INIT symbolic constant initialises an @c ag_seqlock object
+ * in its released state.
+ */
+#define AG_SEQLOCK_INIT {0}
+
+
+/**
+ * Begin read.
+ *
+ * The @c ag_seqlock_read_begin() function begins a read of the record guarded
+ * by a sequence lock @p l, waiting for any writer in progress to finish.
+ *
+ * @param l Sequence lock.
+ *
+ * @return Sequence number to pass to @c ag_seqlock_read_retry().
+ *
+ * @see ag_seqlock_read_retry()
+ */
+static inline ag_word_32
+ag_seqlock_read_begin(const ag_seqlock *l)
+{
+    ag_word_32 seq;
+
+    while (ag_unlikely ((seq = ag_atomic_word_32_load_explicit(&l->seq,
+            AG_ATOMIC_ACQUIRE)) & 1))
+        ag_atomic_pause();
+
+    return seq;
+}
+
+
+/**
+ * Validate read.
+ *
+ * The @c ag_seqlock_read_retry() function checks whether the record guarded
+ * by a sequence lock @p l may have been written since the read that returned
+ * the sequence number @p seq began, in which case the values read must be
+ * discarded and the read retried.
+ *
+ * @param l Sequence lock.
+ * @param seq Sequence number returned by @c ag_seqlock_read_begin().
+ *
+ * @return @c true if the read must be retried.
+ *
+ * @see ag_seqlock_read_begin()
+ */
+static inline ag_bool
+ag_seqlock_read_retry(const ag_seqlock *l, ag_word_32 seq)
+{
+    ag_atomic_fence(AG_ATOMIC_ACQUIRE);
+    return ag_unlikely (ag_atomic_word_32_load_explicit(&l->seq,
+            AG_ATOMIC_RELAXED) != seq);
+}
+
+
+/**
+ * Begin write.
+ *
+ * The @c ag_seqlock_write_begin() function acquires a sequence lock @p l for
+ * writing the record that it guards, waiting for any other writer to finish.
+ *
+ * @param l Sequence lock.
+ *
+ * @see ag_seqlock_write_end()
+ */
+static inline void
+ag_seqlock_write_begin(ag_seqlock *l)
+{
+    ag_word_32 seq = ag_atomic_word_32_load_explicit(&l->seq,
+            AG_ATOMIC_RELAXED);
+
+    for (;;) {
+        if (!(seq & 1) && ag_atomic_word_32_cas_weak_explicit(&l->seq, &seq,
+                seq + 1, AG_ATOMIC_RELAXED, AG_ATOMIC_RELAXED))
+            break;
+
+        ag_atomic_pause();
+        seq = ag_atomic_word_32_load_explicit(&l->seq, AG_ATOMIC_RELAXED);
+    }
+
+        /* the odd sequence number must be visible before any write to the
+         * record, and the record must not be read before the lock is held */
+    ag_atomic_fence(AG_ATOMIC_ACQ_REL);
+}
+
+
+/**
+ * End write.
+ *
+ * The @c ag_seqlock_write_end() function releases a sequence lock @p l that
+ * was acquired through @c ag_seqlock_write_begin(), publishing the writes made
+ * to the record that it guards.
+ *
+ * @param l Sequence lock.
+ *
+ * @see ag_seqlock_write_begin()
+ */
+static inline void
+ag_seqlock_write_end(ag_seqlock *l)
+{
+    ag_word_32 seq = ag_atomic_word_32_load_explicit(&l->seq,
+            AG_ATOMIC_RELAXED);
+
+    ag_atomic_word_32_store_explicit(&l->seq, seq + 1, AG_ATOMIC_RELEASE);
+}
+
+
+/**
+ * Copy record out.
+ *
+ * The @c ag_seqlock_load() function copies @p size bytes of a record at @p src
+ * guarded by a sequence lock to @p dst, through relaxed atomic loads so that
+ * a concurrent write is not a data race. The copy must still be validated
+ * through @c ag_seqlock_read_retry().
+ *
+ * @param dst Destination buffer.
+ * @param src Record guarded by sequence lock.
+ * @param size Number of bytes to copy.
+ *
+ * @see ag_seqlock_read()
+ */
+static inline void
+ag_seqlock_load(void *dst, const void *src, ag_size size)
+{
+    unsigned char *d = (unsigned char *) dst;
+    const unsigned char *s = (const unsigned char *) src;
+    ag_word w;
+
+    if (!((ag_word) s % sizeof w)) {
+        for (; size >= sizeof w; size -= sizeof w) {
+            w = ag_atomic_word_load_explicit((const ag_word *) s,
+                    AG_ATOMIC_RELAXED);
+            memcpy(d, &w, sizeof w);
+            d += sizeof w;
+            s += sizeof w;
+        }
+    }
+
+    for (; size; size--)
+        *d++ = __atomic_load_n(s++, AG_ATOMIC_RELAXED);
+}
+
+
+/**
+ * Copy record in.
+ *
+ * The @c ag_seqlock_store() function copies @p size bytes at @p src into a
+ * record at @p dst guarded by a sequence lock, through relaxed atomic stores
+ * so that a concurrent read is not a data race. The calling thread must hold
+ * the lock for writing.
+ *
+ * @param dst Record guarded by sequence lock.
+ * @param src Source buffer.
+ * @param size Number of bytes to copy.
+ *
+ * @see ag_seqlock_write()
+ */
+static inline void
+ag_seqlock_store(void *dst, const void *src, ag_size size)
+{
+    unsigned char *d = (unsigned char *) dst;
+    const unsigned char *s = (const unsigned char *) src;
+    ag_word w;
+
+    if (!((ag_word) d % sizeof w)) {
+        for (; size >= sizeof w; size -= sizeof w) {
+            memcpy(&w, s, sizeof w);
+            ag_atomic_word_store_explicit((ag_word *) d, w,
+                    AG_ATOMIC_RELAXED);
+            d += sizeof w;
+            s += sizeof w;
+        }
+    }
+
+    for (; size; size--)
+        __atomic_store_n(d++, *s++, AG_ATOMIC_RELAXED);
+}
+
+
+/**
+ * Read record.
+ *
+ * The @c ag_seqlock_read() function reads a consistent copy of the @p size
+ * byte record at @p src guarded by a sequence lock @p l into @p dst, retrying
+ * until no write has overlapped the copy.
+ *
+ * @param l Sequence lock.
+ * @param dst Destination buffer.
+ * @param src Record guarded by @p l.
+ * @param size Size of record in bytes.
+ *
+ * @see ag_seqlock_write()
+ */
+static inline void
+ag_seqlock_read(const ag_seqlock *l, void *dst, const void *src,
+        ag_size size)
+{
+    ag_word_32 seq;
+
+    do {
+        seq = ag_seqlock_read_begin(l);
+        ag_seqlock_load(dst, src, size);
+    } while (ag_seqlock_read_retry(l, seq));
+}
+
+
+/**
+ * Write record.
+ *
+ * The @c ag_seqlock_write() function replaces the @p size byte record at @p
+ * dst guarded by a sequence lock @p l with the contents of @p src.
+ *
+ * @param l Sequence lock.
+ * @param dst Record guarded by @p l.
+ * @param src Source buffer.
+ * @param size Size of record in bytes.
+ *
+ * @see ag_seqlock_read()
+ */
+static inline void
+ag_seqlock_write(ag_seqlock *l, void *dst, const void *src, ag_size size)
+{
+    ag_seqlock_write_begin(l);
+    ag_seqlock_store(dst, src, size);
+    ag_seqlock_write_end(l);
+}
+
+
+/**
+ * @example seqlock.h
+ * This is an example showing how to code against the Argent Core Seqlock
+ * Module interface.
+ * @}
+ */
+
+
+#endif /* !defined ARGENT_CORE_SEQLOCK */
@@ -0,0 +1,320 @@
+#if !defined ARGENT_CORE_SIMD
+#define ARGENT_CORE_SIMD
+
+
+/**************************************************************************//**
+ * @defgroup simd Argent Core SIMD Module
+ * Portable byte classification.
+ *
+ * The SIMD Module classifies the bytes of 64-byte blocks with vector
+ * instructions, producing a 64-bit mask in which each bit flags whether the
+ * corresponding byte matches. Scanners built over these masks locate
+ * delimiters, quotes and other characters of interest for a whole block at a
+ * time, and then visit them with bit operations instead of testing each byte.
+ *
+ * Blocks are classified with AVX2 or SSE2 instructions on x86-64, and with
+ * NEON instructions on aarch64, according to the instruction sets enabled at
+ * compile time; other architectures fall back to a portable loop, which the
+ * compiler may vectorise itself. The prefix XOR of a mask, which turns a mask
+ * of quotes into a mask of quoted regions, uses carry-less multiplication
+ * where it is available.
+ * @{
+ */
+
+
+#include <string.h>
+#include "core.h"
+
+#if defined __AVX2__
+#   include <immintrin.h>
+#elif defined __SSE2__
+#   include <emmintrin.h>
+#elif defined __ARM_NEON
+#   include <arm_neon.h>
+#endif
+
+#if defined __PCLMUL__
+#   include <wmmintrin.h>
+#endif
+
+
+/**
+ * Block size.
+ *
+ * The @c AG_SIMD_BLOCK symbolic constant is the number of bytes classified at
+ * a time, which is also the number of bits in a mask.
+ */
+#define AG_SIMD_BLOCK 64
+
+
+/**
+ * Byte mask.
+ *
+ * The @c ag_simd_mask type holds one bit for each byte of a block, the lowest
+ * bit corresponding to the first byte.
+ */
+typedef ag_word_64 ag_simd_mask;
+
+
+/**
+ * Loaded block.
+ *
+ * The @c ag_simd_block type holds a block of bytes loaded into vector
+ * registers through @c ag_simd_load(), so that it may be classified several
+ * times without being loaded again.
+ *
+ * @see ag_simd_load()
+ */
+typedef struct ag_simd_block {
+#if defined __AVX2__
+    __m256i v[2];
+#elif defined __SSE2__
+    __m128i v[4];
+#elif defined __ARM_NEON
+    uint8x16_t v[4];
+#else
+    ag_word_8 v[AG_SIMD_BLOCK];
+#endif
+} ag_simd_block;
+
+
+#if defined __ARM_NEON && !defined __AVX2__ && !defined __SSE2__
+    /* gathers the top bit of each byte of four comparison results, as NEON
+     * has no equivalent of the x86 movemask instructions */
+static inline ag_simd_mask
+ag__simd_movemask__(uint8x16_t c0, uint8x16_t c1, uint8x16_t c2,
+        uint8x16_t c3)
+{
+    static const ag_word_8 bits[16] = {1, 2, 4, 8, 16, 32, 64, 128,
+            1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t b = vld1q_u8(bits);
+    uint8x16_t s0 = vpaddq_u8(vandq_u8(c0, b), vandq_u8(c1, b));
+    uint8x16_t s1 = vpaddq_u8(vandq_u8(c2, b), vandq_u8(c3, b));
+
+    s0 = vpaddq_u8(s0, s1);
+    s0 = vpaddq_u8(s0, s0);
+
+    return vgetq_lane_u64(vreinterpretq_u64_u8(s0), 0);
+}
+#endif
+
+
+/**
+ * Load block.
+ *
+ * The @c ag_simd_load() function loads the @c AG_SIMD_BLOCK bytes at @p p
+ * into a block @p b. The bytes need not be aligned, but all of them must be
+ * readable.
+ *
+ * @param b Block to load into.
+ * @param p Bytes to load.
+ *
+ * @see ag_simd_load_partial()
+ */
+static inline void
+ag_simd_load(ag_simd_block *b, const void *p)
+{
+#if defined __AVX2__
+    b->v[0] = _mm256_loadu_si256((const __m256i *) p);
+    b->v[1] = _mm256_loadu_si256((const __m256i *) p + 1);
+#elif defined __SSE2__
+    b->v[0] = _mm_loadu_si128((const __m128i *) p);
+    b->v[1] = _mm_loadu_si128((const __m128i *) p + 1);
+    b->v[2] = _mm_loadu_si128((const __m128i *) p + 2);
+    b->v[3] = _mm_loadu_si128((const __m128i *) p + 3);
+#elif defined __ARM_NEON
+    b->v[0] = vld1q_u8((const ag_word_8 *) p);
+    b->v[1] = vld1q_u8((const ag_word_8 *) p + 16);
+    b->v[2] = vld1q_u8((const ag_word_8 *) p + 32);
+    b->v[3] = vld1q_u8((const ag_word_8 *) p + 48);
+#else
+    memcpy(b->v, p, AG_SIMD_BLOCK);
+#endif
+}
+
+
+/**
+ * Load partial block.
+ *
+ * The @c ag_simd_load_partial() function loads the @p n bytes at @p p into a
+ * block @p b, padding the block with @p pad bytes. It is used for the last
+ * block of data that cannot be read past its end.
+ *
+ * @param b Block to load into.
+ * @param p Bytes to load.
+ * @param n Number of bytes to load, at most @c AG_SIMD_BLOCK.
+ * @param pad Padding byte.
+ *
+ * @see ag_simd_load()
+ */
+static inline void
+ag_simd_load_partial(ag_simd_block *b, const void *p, ag_size n, int pad)
+{
+    ag_word_8 tmp[AG_SIMD_BLOCK];
+
+    memset(tmp, pad, sizeof tmp);
+    memcpy(tmp, p, n);
+    ag_simd_load(b, tmp);
+}
+
+
+/**
+ * Match byte.
+ *
+ * The @c ag_simd_eq() function flags the bytes of a block @p b that are equal
+ * to @p c.
+ *
+ * @param b Block to classify.
+ * @param c Byte to match.
+ *
+ * @return Mask of matching bytes.
+ */
+static inline ag_simd_mask
+ag_simd_eq(const ag_simd_block *b, ag_word_8 c)
+{
+#if defined __AVX2__
+    const __m256i k = _mm256_set1_epi8((char) c);
+
+    return (ag_simd_mask) (ag_word_32) _mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(b->v[0], k))
+            | (ag_simd_mask) (ag_word_32) _mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(b->v[1], k)) << 32;
+#elif defined __SSE2__
+    const __m128i k = _mm_set1_epi8((char) c);
+
+    return (ag_simd_mask) (ag_word_16) _mm_movemask_epi8(
+            _mm_cmpeq_epi8(b->v[0], k))
+            | (ag_simd_mask) (ag_word_16) _mm_movemask_epi8(
+            _mm_cmpeq_epi8(b->v[1], k)) << 16
+            | (ag_simd_mask) (ag_word_16) _mm_movemask_epi8(
+            _mm_cmpeq_epi8(b->v[2], k)) << 32
+            | (ag_simd_mask) (ag_word_16) _mm_movemask_epi8(
+            _mm_cmpeq_epi8(b->v[3], k)) << 48;
+#elif defined __ARM_NEON
+    const uint8x16_t k = vdupq_n_u8(c);
+
+    return ag__simd_movemask__(vceqq_u8(b->v[0], k), vceqq_u8(b->v[1], k),
+            vceqq_u8(b->v[2], k), vceqq_u8(b->v[3], k));
+#else
+    ag_simd_mask m = 0;
+    ag_index i;
+
+    for (i = 0; i < AG_SIMD_BLOCK; i++)
+        m |= (ag_simd_mask) (b->v[i] == c) << i;
+
+    return m;
+#endif
+}
+
+
+/**
+ * Match bytes below.
+ *
+ * The @c ag_simd_lt() function flags the bytes of a block @p b that are less
+ * than @p c, compared as unsigned values.
+ *
+ * @param b Block to classify.
+ * @param c Bound, exclusive.
+ *
+ * @return Mask of matching bytes.
+ */
+static inline ag_simd_mask
+ag_simd_lt(const ag_simd_block *b, ag_word_8 c)
+{
+        /* x86 has no unsigned byte comparison, but v < c exactly when the
+         * larger of v and c differs from v */
+#if defined __AVX2__
+    const __m256i k = _mm256_set1_epi8((char) c);
+
+    return ~((ag_simd_mask) (ag_word_32) _mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_max_epu8(b->v[0], k), b->v[0]))
+            | (ag_simd_mask) (ag_word_32) _mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_max_epu8(b->v[1], k), b->v[1])) << 32);
+#elif defined __SSE2__
+    const __m128i k = _mm_set1_epi8((char) c);
+
+    return ~((ag_simd_mask) (ag_word_16) _mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_max_epu8(b->v[0], k), b->v[0]))
+            | (ag_simd_mask) (ag_word_16) _mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_max_epu8(b->v[1], k), b->v[1])) << 16
+            | (ag_simd_mask) (ag_word_16) _mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_max_epu8(b->v[2], k), b->v[2])) << 32
+            | (ag_simd_mask) (ag_word_16) _mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_max_epu8(b->v[3], k), b->v[3])) << 48);
+#elif defined __ARM_NEON
+    const uint8x16_t k = vdupq_n_u8(c);
+
+    return ag__simd_movemask__(vcltq_u8(b->v[0], k), vcltq_u8(b->v[1], k),
+            vcltq_u8(b->v[2], k), vcltq_u8(b->v[3], k));
+#else
+    ag_simd_mask m = 0;
+    ag_index i;
+
+    for (i = 0; i < AG_SIMD_BLOCK; i++)
+        m |= (ag_simd_mask) (b->v[i] < c) << i;
+
+    return m;
+#endif
+}
+
+
+/**
+ * Compute prefix XOR.
+ *
+ * The @c ag_simd_prefix_xor() function computes the prefix XOR of a mask @p
+ * m, in which each bit is the XOR of itself and all lower bits of @p m. Given
+ * a mask of quote characters, the result flags the bytes from each opening
+ * quote up to, but excluding, its closing quote.
+ *
+ * @param m Mask to scan.
+ *
+ * @return Prefix XOR of @p m.
+ */
+static inline ag_pure ag_simd_mask
+ag_simd_prefix_xor(ag_simd_mask m)
+{
+#if defined __PCLMUL__
+    return (ag_simd_mask) _mm_cvtsi128_si64(_mm_clmulepi64_si128(
+            _mm_set_epi64x(0, (long long) m), _mm_set1_epi8(-1), 0));
+#else
+    m ^= m << 1;
+    m ^= m << 2;
+    m ^= m << 4;
+    m ^= m << 8;
+    m ^= m << 16;
+    m ^= m << 32;
+
+    return m;
+#endif
+}
+
+
+/**
+ * Pop next match.
+ *
+ * The @c ag_simd_next() function gets the index of the lowest bit set in the
+ * mask @p m, and clears that bit.
+ *
+ * @param m Mask to pop, which must not be zero.
+ *
+ * @return Index of the lowest bit set in @p m.
+ */
+static inline ag_index
+ag_simd_next(ag_simd_mask *m)
+{
+    ag_index i = (ag_index) __builtin_ctzll(*m);
+
+    *m &= *m - 1;
+    return i;
+}
+
+
+/**
+ * @example simd.h
+ * This is an example showing how to code against the Argent Core SIMD Module
+ * interface.
+ * @}
+ */
+
+
+#endif /* !defined ARGENT_CORE_SIMD */
@@ -0,0 +1,342 @@
+#if !defined ARGENT_CORE_SYNC
+#define ARGENT_CORE_SYNC
+
+
+/**************************************************************************//**
+ * @defgroup sync Argent Core Sync Module
+ * Barriers, latches and once-initialisation.
+ *
+ * The Sync Module provides a reusable barrier, a countdown latch and a
+ * once-initialiser, built over the Futex Module. Each of them spins for a
+ * while before sleeping, so that threads meeting at the end of short parallel
+ * phases are released without a round trip through the scheduler, and only
+ * makes a system call to wake threads that actually went to sleep.
+ *
+ * The once-initialiser is meant for lazily initialised globals. Once the
+ * initialisation is complete, checking it costs a single acquire load, so
+ * that it may be used on every access to the global.
+ *
+ * @note This module is specific to Linux, and requires the GNU C dialect or
+ * @c _GNU_SOURCE to be defined.
+ * @{
+ */
+
+
+#include "futex.h"
+
+
+/**
+ * Spin count.
+ *
+ * The @c AG_SYNC_SPIN symbolic constant sets the number of times that barrier
+ * and latch waiters poll their state before sleeping. It is larger than @c
+ * AG_FUTEX_SPIN, as these waits are expected to last as long as the slowest
+ * thread takes to finish its share of a phase. The default may be overridden
+ * by defining this constant before including this header.
+ */
+#if !defined AG_SYNC_SPIN
+#   define AG_SYNC_SPIN 2000
+#endif
+
+
+/**
+ * Barrier.
+ *
+ * The @c ag_barrier type is a reusable barrier, at which a fixed number of
+ * threads wait for each other before proceeding. The barrier resets itself
+ * once all threads have arrived, so that it may be used for successive
+ * phases.
+ *
+ * @see AG_BARRIER_INIT
+ * @see ag_barrier_wait()
+ */
+typedef struct ag_barrier {
+    ag_word_32 arrived;
+    ag_word_32 seq;
+    ag_word_32 sleepers;
+    ag_word_32 n;
+} ag_barrier;
+
+
+/**
+ * Static barrier initialiser.
+ *
+ * The @c AG_BARRIER_INIT() macro initialises an @c ag_barrier object for @p n
+ * threads.
+ *
+ * @param n Number of threads, greater than zero.
+ */
+#define AG_BARRIER_INIT(n) {0, 0, 0, (n)}
+
+
+/**
+ * Wait at barrier.
+ *
+ * The @c ag_barrier_wait() function waits until all threads of a barrier @p b
+ * have arrived at it, spinning for a while before sleeping. All writes made by
+ * the threads before arriving are visible to all of them once they proceed.
+ *
+ * @param b Barrier to wait at.
+ *
+ * @return @c true for exactly one of the threads, which may perform work on
+ * behalf of all of them, and @c false for the others.
+ */
+static inline ag_bool
+ag_barrier_wait(ag_barrier *b)
+{
+    ag_word_32 seq = ag_atomic_word_32_load_explicit(&b->seq,
+            AG_ATOMIC_ACQUIRE);
+    ag_index i;
+
+    if (ag_atomic_word_32_add_fetch_explicit(&b->arrived, 1,
+            AG_ATOMIC_ACQ_REL) == b->n) {
+        ag_atomic_word_32_store_explicit(&b->arrived, 0, AG_ATOMIC_RELAXED);
+        (void) ag_atomic_word_32_fetch_add_explicit(&b->seq, 1,
+                AG_ATOMIC_SEQ_CST);
+
+        if (ag_atomic_word_32_load_explicit(&b->sleepers, AG_ATOMIC_SEQ_CST))
+            ag_futex_wake(&b->seq, INT_MAX);
+        return true;
+    }
+
+    for (i = 0; i < AG_SYNC_SPIN; i++) {
+        if (ag_atomic_word_32_load_explicit(&b->seq, AG_ATOMIC_ACQUIRE)
+                != seq)
+            return false;
+        ag_atomic_pause();
+    }
+
+        /* a waiter registers as a sleeper before checking the sequence in
+         * the kernel, so that the last thread to arrive either sees it or
+         * has already moved the sequence on */
+    (void) ag_atomic_word_32_fetch_add_explicit(&b->sleepers, 1,
+            AG_ATOMIC_SEQ_CST);
+    while (ag_atomic_word_32_load_explicit(&b->seq, AG_ATOMIC_ACQUIRE)
+            == seq)
+        ag_futex_wait(&b->seq, seq);
+    (void) ag_atomic_word_32_fetch_sub_explicit(&b->sleepers, 1,
+            AG_ATOMIC_RELAXED);
+
+    return false;
+}
+
+
+/**
+ * Countdown latch.
+ *
+ * The @c ag_latch type is a single-use latch, which threads wait on until its
+ * count reaches zero. The count is held in the lower 31 bits of a single word,
+ * and the highest bit flags that threads may be sleeping on the latch.
+ *
+ * @see AG_LATCH_INIT
+ * @see ag_latch_wait()
+ */
+typedef ag_word_32 ag_latch;
+
+
+/**
+ * Static latch initialiser.
+ *
+ * The @c AG_LATCH_INIT() macro initialises an @c ag_latch object with a count
+ * @p n.
+ *
+ * @param n Initial count, less than 2^31.
+ */
+#define AG_LATCH_INIT(n) ((ag_latch) (n))
+
+
+    /* flags that threads may be sleeping on a latch */
+#define AG__LATCH_WAITERS__ ((ag_word_32) 1 << 31)
+
+
+/**
+ * Count down latch.
+ *
+ * The @c ag_latch_count_down() function decreases the count of a latch @p l by
+ * @p n, releasing its waiters if the count reaches zero. Writes made before
+ * counting down are visible to the waiters once they are released.
+ *
+ * @param l Latch to count down.
+ * @param n Amount to count down by, at most the remaining count.
+ *
+ * @see ag_latch_wait()
+ */
+static inline void
+ag_latch_count_down(ag_latch *l, ag_word_32 n)
+{
+    ag_word_32 v = ag_atomic_word_32_sub_fetch_explicit(l, n,
+            AG_ATOMIC_ACQ_REL);
+
+    if (v == AG__LATCH_WAITERS__)
+        ag_futex_wake(l, INT_MAX);
+}
+
+
+/**
+ * Try to wait on latch.
+ *
+ * The @c ag_latch_try_wait() function checks whether the count of a latch @p l
+ * has reached zero, without waiting.
+ *
+ * @param l Latch to check.
+ *
+ * @return @c true if the count of @p l is zero.
+ */
+static inline ag_bool
+ag_latch_try_wait(ag_latch *l)
+{
+    return !(ag_atomic_word_32_load_explicit(l, AG_ATOMIC_ACQUIRE)
+            & ~AG__LATCH_WAITERS__);
+}
+
+
+/**
+ * Wait on latch.
+ *
+ * The @c ag_latch_wait() function waits until the count of a latch @p l
+ * reaches zero, spinning for a while before sleeping.
+ *
+ * @param l Latch to wait on.
+ *
+ * @see ag_latch_count_down()
+ */
+static inline void
+ag_latch_wait(ag_latch *l)
+{
+    ag_word_32 v;
+    ag_index i;
+
+    for (i = 0; i < AG_SYNC_SPIN; i++) {
+        if (ag_likely (ag_latch_try_wait(l)))
+            return;
+        ag_atomic_pause();
+    }
+
+    for (;;) {
+        v = ag_atomic_word_32_load_explicit(l, AG_ATOMIC_ACQUIRE);
+        if (!(v & ~AG__LATCH_WAITERS__))
+            return;
+
+        if ((v & AG__LATCH_WAITERS__) || ag_atomic_word_32_cas_explicit(l,
+                &v, v | AG__LATCH_WAITERS__, AG_ATOMIC_ACQUIRE,
+                AG_ATOMIC_ACQUIRE))
+            ag_futex_wait(l, v | AG__LATCH_WAITERS__);
+    }
+}
+
+
+/**
+ * Once-initialiser.
+ *
+ * The @c ag_once type tracks whether a one-time initialisation has completed,
+ * in a single word.
+ *
+ * @see AG_ONCE_INIT
+ * @see ag_once_call()
+ */
+typedef ag_word_32 ag_once;
+
+
+/**
+ * Static once-initialiser initialiser.
+ *
+ * The @c AG_ONCE_INIT symbolic constant initialises an @c ag_once object in
+ * its uninitialised state.
+ */
+#define AG_ONCE_INIT 0
+
+
+/**
+ * Once function.
+ *
+ * The @c ag_once_fn type is the signature of a one-time initialisation
+ * function.
+ *
+ * @param arg Argument passed to @c ag_once_call().
+ *
+ * @return AG_ERNO_NULL if the initialisation has completed, or an error code
+ * to have it attempted again by a later call.
+ *
+ * @see ag_once_call()
+ */
+typedef ag_erno (*ag_once_fn)(void *arg);
+
+
+    /* once states; a thread waiting for the initialisation to complete marks
+     * it as running with waiters, so that completion only issues a wake-up
+     * when needed */
+#define AG__ONCE_NONE__ 0
+#define AG__ONCE_RUNNING__ 1
+#define AG__ONCE_WAITED__ 2
+#define AG__ONCE_DONE__ 3
+
+
+static inline ag_cold ag_erno
+ag__once_slow__(ag_once *o, ag_once_fn fn, void *arg)
+{
+    ag_word_32 v;
+    ag_erno e;
+
+    for (;;) {
+        v = AG__ONCE_NONE__;
+        if (ag_atomic_word_32_cas_explicit(o, &v, AG__ONCE_RUNNING__,
+                AG_ATOMIC_ACQUIRE, AG_ATOMIC_ACQUIRE)) {
+            e = fn(arg);
+
+                /* a failed initialisation hands over to a waiter, if any */
+            v = ag_atomic_word_32_exchange_explicit(o, e ? AG__ONCE_NONE__
+                    : AG__ONCE_DONE__, AG_ATOMIC_RELEASE);
+            if (v == AG__ONCE_WAITED__)
+                ag_futex_wake(o, INT_MAX);
+            return e;
+        }
+
+        if (v == AG__ONCE_DONE__)
+            return AG_ERNO_NULL;
+
+        if (v == AG__ONCE_WAITED__ || ag_atomic_word_32_cas_explicit(o, &v,
+                AG__ONCE_WAITED__, AG_ATOMIC_ACQUIRE, AG_ATOMIC_ACQUIRE))
+            ag_futex_wait(o, AG__ONCE_WAITED__);
+    }
+}
+
+
+/**
+ * Run once.
+ *
+ * The @c ag_once_call() function calls @p fn with the argument @p arg, unless
+ * an earlier call through the once-initialiser @p o has completed. Threads
+ * calling this function while @p fn is running wait for it to complete, and
+ * all writes made by @p fn are visible to them once this function returns.
+ * Once @p fn has completed, this function costs a single acquire load.
+ *
+ * If @p fn returns an error code, then the initialisation is considered not to
+ * have taken place, and is attempted again by the next call.
+ *
+ * @param o Once-initialiser.
+ * @param fn Initialisation function.
+ * @param arg Argument passed to @p fn.
+ *
+ * @return AG_ERNO_NULL if the initialisation has completed.
+ * @return The error code returned by @p fn if it failed in this call.
+ */
+static inline ag_erno
+ag_once_call(ag_once *o, ag_once_fn fn, void *arg)
+{
+    if (ag_likely (ag_atomic_word_32_load_explicit(o, AG_ATOMIC_ACQUIRE)
+            == AG__ONCE_DONE__))
+        return AG_ERNO_NULL;
+
+    return ag__once_slow__(o, fn, arg);
+}
+
+
+/**
+ * @example sync.h
+ * This is an example showing how to code against the Argent Core Sync Module
+ * interface.
+ * @}
+ */
+
+
+#endif /* !defined ARGENT_CORE_SYNC */
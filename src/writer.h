@@ -0,0 +1,427 @@
+#if !defined ARGENT_CORE_WRITER
+#define ARGENT_CORE_WRITER
+
+
+/**************************************************************************//**
+ * @defgroup writer Argent Core Writer Module
+ * Buffered vectored output.
+ *
+ * The Writer Module provides a buffered output stream over a file descriptor,
+ * which gathers the fragments of a response or record and sends all of them
+ * through a single @c writev() or @c pwritev() system call, instead of one
+ * call per fragment.
+ *
+ * Small fragments are copied into the buffer of the writer, and consecutive
+ * copies share a single I/O vector. Large fragments may instead be added by
+ * reference, in which case they are gathered directly from the memory of the
+ * caller when the writer is flushed, without being copied; referenced memory
+ * must therefore remain valid and unchanged until the next flush. The writer
+ * flushes itself whenever its buffer or I/O vectors run out.
+ *
+ * A writer either writes at the current position of its file descriptor, as
+ * is required for sockets and pipes, or at an explicit offset set through @c
+ * ag_writer_seek(), in which case the file position is left untouched.
+ *
+ * @note This module is specific to Linux, and requires the GNU C dialect or
+ * @c _GNU_SOURCE to be defined.
+ *
+ * @warning Writers are meant for blocking file descriptors. If a flush fails,
+ * the output pending in the writer is discarded, and an unspecified part of it
+ * may have been written.
+ * @{
+ */
+
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include "core.h"
+
+
+/**
+ * Default buffer size.
+ *
+ * The @c AG_WRITER_SIZE symbolic constant sets the size of the buffer of
+ * writers created with a zero size. The default may be overridden by defining
+ * this constant before including this header.
+ *
+ * @see ag_writer_create()
+ */
+#if !defined AG_WRITER_SIZE
+#   define AG_WRITER_SIZE 16384
+#endif
+
+
+/**
+ * I/O vector count.
+ *
+ * The @c AG_WRITER_IOV symbolic constant sets the number of I/O vectors that a
+ * writer gathers into a single flush; it must not exceed @c IOV_MAX. The
+ * default may be overridden by defining this constant before including this
+ * header.
+ */
+#if !defined AG_WRITER_IOV
+#   define AG_WRITER_IOV 64
+#endif
+
+
+/**
+ * Reference threshold.
+ *
+ * The @c AG_WRITER_COPY symbolic constant sets the size below which fragments
+ * added by reference are copied into the buffer instead, as copying them is
+ * cheaper than spending an I/O vector on them. The default may be overridden
+ * by defining this constant before including this header.
+ *
+ * @see ag_writer_ref()
+ */
+#if !defined AG_WRITER_COPY
+#   define AG_WRITER_COPY 256
+#endif
+
+
+/**
+ * Buffered writer.
+ *
+ * The @c ag_writer type is a buffered output stream over a file descriptor.
+ * Writers are created through @c ag_writer_create().
+ *
+ * @see ag_writer_create()
+ */
+typedef struct ag_writer {
+    struct iovec iov[AG_WRITER_IOV];
+    ag_size niov;
+    ag_string *buf;
+    ag_size used;
+    ag_size size;
+    off_t off;
+    int fd;
+} ag_writer;
+
+
+    /* appends an I/O vector, extending the last one if the fragment directly
+     * follows it; there must be room for a new vector */
+static inline void
+ag__writer_push__(ag_writer *w, const void *data, ag_size len)
+{
+    struct iovec *last;
+
+    if (w->niov) {
+        last = w->iov + w->niov - 1;
+        if ((const char *) last->iov_base + last->iov_len
+                == (const char *) data) {
+            last->iov_len += len;
+            return;
+        }
+    }
+
+    w->iov[w->niov].iov_base = (void *) data;
+    w->iov[w->niov].iov_len = len;
+    w->niov++;
+}
+
+
+/**
+ * Create writer.
+ *
+ * The @c ag_writer_create() function creates a writer @p w over the file
+ * descriptor @p fd, with a buffer of @p size bytes. The writer initially
+ * writes at the current position of @p fd, and does not take ownership of it.
+ *
+ * @param w Writer to create.
+ * @param fd File descriptor to write to.
+ * @param size Buffer size, or zero for @c AG_WRITER_SIZE.
+ *
+ * @return AG_ERNO_NULL if the writer has been created.
+ * @return AG_ERNO_HANDLE if @p w is a null pointer.
+ * @return AG_ERNO_STATE if @p fd is negative.
+ * @return AG_ERNO_MEMORY if the writer could not be allocated.
+ *
+ * @see ag_writer_destroy()
+ */
+static inline ag_erno
+ag_writer_create(ag_writer **w, int fd, ag_size size)
+{
+    ag_writer *wr;
+
+AG_TRY:
+    ag_assert_handle(w);
+    ag_assert_state(fd >= 0);
+
+    if (!size)
+        size = AG_WRITER_SIZE;
+
+        /* the buffer follows the writer in the same allocation */
+    wr = (ag_writer *) malloc(sizeof *wr + size);
+    ag_assert(wr, AG_ERNO_MEMORY);
+
+    wr->niov = 0;
+    wr->buf = (ag_string *) (wr + 1);
+    wr->used = 0;
+    wr->size = size;
+    wr->off = -1;
+    wr->fd = fd;
+
+    *w = wr;
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Destroy writer.
+ *
+ * The @c ag_writer_destroy() function releases a writer @p w, discarding any
+ * pending output; the writer should be flushed beforehand. The file descriptor
+ * of the writer is not closed.
+ *
+ * @param w Writer to destroy; may be a null pointer.
+ *
+ * @see ag_writer_create()
+ * @see ag_writer_flush()
+ */
+static inline void
+ag_writer_destroy(ag_writer *w)
+{
+    free(w);
+}
+
+
+/**
+ * Get pending output size.
+ *
+ * The @c ag_writer_pending() function gets the number of bytes gathered by a
+ * writer @p w and not yet flushed.
+ *
+ * @param w Writer to query.
+ *
+ * @return Number of pending bytes.
+ */
+static inline ag_size
+ag_writer_pending(const ag_writer *w)
+{
+    ag_size n = 0;
+    ag_index i;
+
+    for (i = 0; i < w->niov; i++)
+        n += w->iov[i].iov_len;
+
+    return n;
+}
+
+
+/**
+ * Flush writer.
+ *
+ * The @c ag_writer_flush() function writes all output pending in a writer @p
+ * w through a single @c writev() or @c pwritev() call, repeating the call only
+ * to complete a partial write or after an interruption by a signal.
+ *
+ * @param w Writer to flush.
+ *
+ * @return AG_ERNO_NULL if the pending output has been written.
+ * @return AG_ERNO_HANDLE if @p w is a null pointer.
+ * @return AG_ERNO_SYSTEM if the output could not be written; @c errno is set
+ * to the cause of failure, and the pending output is discarded.
+ */
+static inline ag_erno
+ag_writer_flush(ag_writer *w)
+{
+    struct iovec *iov;
+    ag_size n;
+    ssize_t r;
+
+AG_TRY:
+    ag_assert_handle(w);
+
+    iov = w->iov;
+    n = w->niov;
+    w->niov = 0;
+    w->used = 0;
+
+    while (n) {
+        if (w->off >= 0)
+            r = pwritev(w->fd, iov, (int) n, w->off);
+        else
+            r = writev(w->fd, iov, (int) n);
+
+        if (ag_unlikely (r < 0)) {
+            ag_assert(errno == EINTR, AG_ERNO_SYSTEM);
+            continue;
+        }
+
+        if (w->off >= 0)
+            w->off += r;
+
+            /* a partial write resumes from the first unwritten byte */
+        while (n && (ag_size) r >= iov->iov_len) {
+            r -= (ssize_t) iov->iov_len;
+            iov++;
+            n--;
+        }
+
+        if (n) {
+            iov->iov_base = (char *) iov->iov_base + r;
+            iov->iov_len -= (ag_size) r;
+        }
+    }
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Set write offset.
+ *
+ * The @c ag_writer_seek() function flushes a writer @p w, and then has it
+ * write at the offset @p off of its file through @c pwritev(), or at the
+ * current file position through @c writev() if @p off is negative.
+ *
+ * @param w Writer to reposition.
+ * @param off File offset, or -1.
+ *
+ * @return AG_ERNO_NULL if the writer has been repositioned.
+ * @return AG_ERNO_HANDLE if @p w is a null pointer.
+ * @return AG_ERNO_SYSTEM if the pending output could not be written.
+ */
+static inline ag_erno
+ag_writer_seek(ag_writer *w, off_t off)
+{
+AG_TRY:
+    ag_assert_handle(w);
+    ag_try(ag_writer_flush(w));
+
+    w->off = off < 0 ? -1 : off;
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Write data.
+ *
+ * The @c ag_writer_write() function writes @p len bytes from @p data to a
+ * writer @p w. The data is copied into the buffer of the writer, flushing it
+ * first if the data does not fit. Data larger than the whole buffer is instead
+ * flushed directly along with the pending output, without being copied.
+ *
+ * @param w Writer to write to.
+ * @param data Data to write.
+ * @param len Length of @p data in bytes.
+ *
+ * @return AG_ERNO_NULL if the data has been written or buffered.
+ * @return AG_ERNO_HANDLE if @p w or @p data is a null pointer.
+ * @return AG_ERNO_SYSTEM if a flush failed.
+ *
+ * @see ag_writer_ref()
+ */
+static inline ag_erno
+ag_writer_write(ag_writer *w, const void *data, ag_size len)
+{
+AG_TRY:
+    ag_assert_handle(w && (data || !len));
+
+    if (ag_unlikely (len > w->size)) {
+        if (w->niov == AG_WRITER_IOV)
+            ag_try(ag_writer_flush(w));
+        ag__writer_push__(w, data, len);
+        ag_try(ag_writer_flush(w));
+    } else if (len) {
+        if (len > w->size - w->used || w->niov == AG_WRITER_IOV)
+            ag_try(ag_writer_flush(w));
+
+        memcpy(w->buf + w->used, data, len);
+        ag__writer_push__(w, w->buf + w->used, len);
+        w->used += len;
+    }
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Write string.
+ *
+ * The @c ag_writer_string() function writes a null-terminated string @p s,
+ * without its terminator, to a writer @p w.
+ *
+ * @param w Writer to write to.
+ * @param s String to write.
+ *
+ * @return AG_ERNO_NULL if the string has been written or buffered.
+ * @return AG_ERNO_HANDLE if @p w or @p s is a null pointer.
+ * @return AG_ERNO_SYSTEM if a flush failed.
+ *
+ * @see ag_writer_write()
+ */
+static inline ag_erno
+ag_writer_string(ag_writer *w, const ag_string *s)
+{
+AG_TRY:
+    ag_assert_handle(s);
+    ag_try(ag_writer_write(w, s, strlen(s)));
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * Write reference.
+ *
+ * The @c ag_writer_ref() function adds @p len bytes at @p data to a writer @p
+ * w by reference, so that they are gathered from @p data when the writer is
+ * next flushed instead of being copied. Fragments smaller than @c
+ * AG_WRITER_COPY are copied as through @c ag_writer_write().
+ *
+ * @param w Writer to write to.
+ * @param data Data to reference, which must remain valid and unchanged until
+ * the writer is next flushed.
+ * @param len Length of @p data in bytes.
+ *
+ * @return AG_ERNO_NULL if the reference has been added.
+ * @return AG_ERNO_HANDLE if @p w or @p data is a null pointer.
+ * @return AG_ERNO_SYSTEM if a flush failed.
+ *
+ * @see ag_writer_write()
+ */
+static inline ag_erno
+ag_writer_ref(ag_writer *w, const void *data, ag_size len)
+{
+AG_TRY:
+    ag_assert_handle(w && (data || !len));
+
+    if (len < AG_WRITER_COPY)
+        ag_try(ag_writer_write(w, data, len));
+    else {
+        if (w->niov == AG_WRITER_IOV)
+            ag_try(ag_writer_flush(w));
+        ag__writer_push__(w, data, len);
+    }
+
+AG_CATCH:
+AG_FINALLY:
+    return ag_erno_get();
+}
+
+
+/**
+ * @example writer.h
+ * This is an example showing how to code against the Argent Core Writer
+ * Module interface.
+ * @}
+ */
+
+
+#endif /* !defined ARGENT_CORE_WRITER */